@@ -0,0 +1,325 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "AssetPack.h"
+
+#include <fstream>
+#include <algorithm>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Pack layout, all numbers 32bit little endian:
+// "GPAK", version, file count, then for every file the name length, name,
+// offset (from the start of the pack) and size, followed by the file data
+
+#define PACK_MAGIC "GPAK"
+#define PACK_VERSION 1
+
+static void writeUint32(ofstream& file, const Uint32& value)
+{
+	char bytes[4] = {(char)(value & 0xFF),(char)((value >> 8) & 0xFF),(char)((value >> 16) & 0xFF),(char)((value >> 24) & 0xFF)};
+	file.write(bytes,4);
+}
+
+static bool readUint32(const char* data, const size_t& size, size_t& pos, Uint32& value)
+{
+	if (pos + 4 > size)
+		return false;
+	const unsigned char* bytes = (const unsigned char*)data + pos;
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+	pos += 4;
+	return true;
+}
+
+AssetPack* AssetPack::self = NULL;
+
+AssetPack::AssetPack()
+{
+	//
+}
+
+AssetPack::~AssetPack()
+{
+	for (vector<Pack>::iterator I = packs.begin(); I != packs.end(); ++I)
+		unmap(*I);
+	packs.clear();
+}
+
+AssetPack* AssetPack::GetSingleton()
+{
+	if (not self)
+		self = new AssetPack();
+	return self;
+}
+
+bool AssetPack::mount(CRstring filename)
+{
+	if (isMounted(filename))
+		return true;
+
+	Pack pack;
+	pack.filename = filename;
+	pack.data = NULL;
+	pack.size = 0;
+	#ifdef _WIN32
+	pack.file = INVALID_HANDLE_VALUE;
+	pack.mapping = NULL;
+	#endif
+
+	struct stat info;
+	if (stat(filename.c_str(),&info) != 0 || info.st_size <= 0)
+		return false;
+	pack.modified = info.st_mtime;
+	pack.size = info.st_size;
+
+#ifdef _WIN32
+	pack.file = CreateFile(filename.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if (pack.file == INVALID_HANDLE_VALUE)
+		return false;
+	pack.mapping = CreateFileMapping(pack.file,NULL,PAGE_READONLY,0,0,NULL);
+	if (pack.mapping)
+		pack.data = (const char*)MapViewOfFile(pack.mapping,FILE_MAP_READ,0,0,0);
+#else
+	int file = open(filename.c_str(),O_RDONLY);
+	if (file < 0)
+		return false;
+	void* data = mmap(NULL,pack.size,PROT_READ,MAP_PRIVATE,file,0);
+	close(file); // the mapping stays valid
+	if (data != MAP_FAILED)
+		pack.data = (const char*)data;
+#endif
+
+	if (not pack.data || not readIndex(pack))
+	{
+		printf("ERROR: Could not mount asset pack \"%s\"\n",filename.c_str());
+		unmap(pack);
+		return false;
+	}
+
+	printf("Mounted asset pack \"%s\" with %i files\n",filename.c_str(),pack.index.size());
+	packs.push_back(pack);
+	return true;
+}
+
+void AssetPack::unmount(CRstring filename)
+{
+	for (vector<Pack>::iterator I = packs.begin(); I != packs.end(); ++I)
+	{
+		if (I->filename == filename)
+		{
+			unmap(*I);
+			packs.erase(I);
+			return;
+		}
+	}
+}
+
+bool AssetPack::isMounted(CRstring filename) const
+{
+	for (vector<Pack>::const_iterator I = packs.begin(); I != packs.end(); ++I)
+	{
+		if (I->filename == filename)
+			return true;
+	}
+	return false;
+}
+
+bool AssetPack::find(CRstring filename, const char*& data, size_t& size) const
+{
+	time_t modified;
+	return find(filename,data,size,modified);
+}
+
+bool AssetPack::find(CRstring filename, const char*& data, size_t& size, time_t& modified) const
+{
+	for (vector<Pack>::const_reverse_iterator I = packs.rbegin(); I != packs.rend(); ++I)
+	{
+		map<string,Entry>::const_iterator entry = I->index.find(filename);
+		if (entry != I->index.end())
+		{
+			data = I->data + entry->second.offset;
+			size = entry->second.size;
+			modified = I->modified;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AssetPack::contains(CRstring filename) const
+{
+	const char* data;
+	size_t size;
+	return find(filename,data,size);
+}
+
+SDL_RWops* AssetPack::openRW(CRstring filename) const
+{
+	const char* data;
+	size_t size;
+	if (not find(filename,data,size))
+		return NULL;
+	return SDL_RWFromConstMem(data,size);
+}
+
+istream* AssetPack::openStream(CRstring filename) const
+{
+	const char* data;
+	size_t size;
+	if (find(filename,data,size))
+		return new AssetStream(data,size);
+	return new ifstream(filename.c_str());
+}
+
+bool AssetPack::getListing(CRstring path, CRstring extension, vector<string>& files) const
+{
+	string suffix = "." + extension;
+	for (vector<Pack>::const_iterator I = packs.begin(); I != packs.end(); ++I)
+	{
+		// the index is sorted, so all files in the folder follow each other
+		for (map<string,Entry>::const_iterator entry = I->index.lower_bound(path);
+				entry != I->index.end() && entry->first.compare(0,path.length(),path) == 0; ++entry)
+		{
+			string name = entry->first.substr(path.length());
+			if (name.find('/') != string::npos || name.length() <= suffix.length() ||
+					name.compare(name.length() - suffix.length(),suffix.length(),suffix) != 0)
+				continue;
+			vector<string>::iterator pos = lower_bound(files.begin(),files.end(),name);
+			if (pos == files.end() || *pos != name)
+				files.insert(pos,name);
+		}
+	}
+	return not files.empty();
+}
+
+bool AssetPack::create(CRstring filename, const vector<string>& files)
+{
+	vector<Entry> entries(files.size());
+	Uint32 offset = 12;
+	for (vector<string>::const_iterator I = files.begin(); I != files.end(); ++I)
+		offset += 12 + I->length();
+
+	for (int I = 0; I < (int)files.size(); ++I)
+	{
+		struct stat info;
+		if (stat(files[I].c_str(),&info) != 0)
+		{
+			printf("ERROR: Could not read file \"%s\" for packing!\n",files[I].c_str());
+			return false;
+		}
+		entries[I].offset = offset;
+		entries[I].size = info.st_size;
+		offset += info.st_size;
+	}
+
+	ofstream pack(filename.c_str(),ios::out | ios::binary | ios::trunc);
+	if (pack.fail())
+	{
+		printf("ERROR: Could not open pack file \"%s\" for writing!\n",filename.c_str());
+		return false;
+	}
+
+	pack.write(PACK_MAGIC,4);
+	writeUint32(pack,PACK_VERSION);
+	writeUint32(pack,files.size());
+	for (int I = 0; I < (int)files.size(); ++I)
+	{
+		writeUint32(pack,files[I].length());
+		pack.write(files[I].data(),files[I].length());
+		writeUint32(pack,entries[I].offset);
+		writeUint32(pack,entries[I].size);
+	}
+	for (int I = 0; I < (int)files.size(); ++I)
+	{
+		ifstream file(files[I].c_str(),ios::in | ios::binary);
+		vector<char> buffer(entries[I].size);
+		if (entries[I].size > 0)
+			file.read(&buffer[0],entries[I].size);
+		if (file.fail())
+		{
+			printf("ERROR: Could not read file \"%s\" for packing!\n",files[I].c_str());
+			return false;
+		}
+		if (entries[I].size > 0)
+			pack.write(&buffer[0],entries[I].size);
+	}
+	pack.close();
+
+	printf("Packed %i files into \"%s\" (%i bytes)\n",files.size(),filename.c_str(),offset);
+	return true;
+}
+
+/// ---private------------------------------------------------------------------
+
+bool AssetPack::readIndex(Pack& pack) const
+{
+	size_t pos = 4;
+	Uint32 version, count;
+	if (pack.size < 4 || memcmp(pack.data,PACK_MAGIC,4) != 0 ||
+			not readUint32(pack.data,pack.size,pos,version) || version != PACK_VERSION ||
+			not readUint32(pack.data,pack.size,pos,count))
+		return false;
+
+	for (Uint32 I = 0; I < count; ++I)
+	{
+		Uint32 length;
+		Entry entry;
+		if (not readUint32(pack.data,pack.size,pos,length) || pos + length > pack.size)
+			return false;
+		string name(pack.data + pos,length);
+		pos += length;
+		if (not readUint32(pack.data,pack.size,pos,entry.offset) ||
+				not readUint32(pack.data,pack.size,pos,entry.size) ||
+				(size_t)entry.offset + entry.size > pack.size)
+			return false;
+		pack.index[name] = entry;
+	}
+	return true;
+}
+
+void AssetPack::unmap(Pack& pack) const
+{
+#ifdef _WIN32
+	if (pack.data)
+		UnmapViewOfFile(pack.data);
+	if (pack.mapping)
+		CloseHandle(pack.mapping);
+	if (pack.file != INVALID_HANDLE_VALUE)
+		CloseHandle(pack.file);
+	pack.mapping = NULL;
+	pack.file = INVALID_HANDLE_VALUE;
+#else
+	if (pack.data)
+		munmap((void*)pack.data,pack.size);
+#endif
+	pack.data = NULL;
+	pack.index.clear();
+}
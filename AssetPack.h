@@ -0,0 +1,135 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <SDL/SDL.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <istream>
+#include <time.h>
+
+#include "PenjinTypes.h"
+
+#define ASSET_PACK AssetPack::GetSingleton()
+
+// loaded on startup if present
+#define ASSET_PACK_FILE "assets.pak"
+// loaded when starting a chapter from the chapter's folder if present
+#define CHAPTER_PACK_FILE "chapter.pak"
+
+/**
+Serves files from packed archives instead of loose files on disk
+A pack is a single file with an index of the files it contains, it is mapped
+into memory once and files are read directly from there (no open or stat calls
+per file, which are slow on SD cards)
+Packs overlay each other, the last mounted pack is searched first, files not
+found in any pack are read from disk as usual
+File names are stored as passed to create, so lookups have to use the same
+relative paths the game uses for loose files (i.e. "images/general/icon.png")
+**/
+
+class AssetPack
+{
+private:
+	AssetPack();
+	static AssetPack* self;
+public:
+	~AssetPack();
+	static AssetPack* GetSingleton();
+
+	// returns false if the file does not exist or is not a valid pack
+	// mount and unmount are not thread safe, all threads which might be
+	// reading from packs (workers, prefetch) have to be finished before
+	bool mount(CRstring filename);
+	void unmount(CRstring filename);
+	bool isMounted(CRstring filename) const;
+
+	// returns false if the file is not in any pack, the data stays valid until
+	// the pack is unmounted
+	bool find(CRstring filename, const char*& data, size_t& size) const;
+	bool find(CRstring filename, const char*& data, size_t& size, time_t& modified) const;
+	bool contains(CRstring filename) const;
+
+	// returns a SDL_RWops reading from the pack or NULL if the file is not in a pack
+	SDL_RWops* openRW(CRstring filename) const;
+	// opens a file from a pack or disk (check fail() for errors), delete after use
+	istream* openStream(CRstring filename) const;
+
+	// lists the names of the files in the passed folder (not sub-folders) with
+	// the passed extension in all mounted packs, returns false if there are none
+	bool getListing(CRstring path, CRstring extension, vector<string>& files) const;
+
+	// writes a new pack containing the passed files, returns false on error
+	static bool create(CRstring filename, const vector<string>& files);
+
+private:
+	struct Entry
+	{
+		Uint32 offset;
+		Uint32 size;
+	};
+	struct Pack
+	{
+		string filename;
+		time_t modified;
+		const char* data;
+		size_t size;
+		#ifdef _WIN32
+		void* file;
+		void* mapping;
+		#endif
+		map<string,Entry> index;
+	};
+
+	bool readIndex(Pack& pack) const;
+	void unmap(Pack& pack) const;
+
+	vector<Pack> packs;
+};
+
+/**
+Read-only stream on memory (used for files in packs, without copying them)
+**/
+
+class AssetStream : public istream
+{
+public:
+	AssetStream(const char* data, const size_t& size) : istream(NULL), buffer(data,size) {rdbuf(&buffer);}
+private:
+	class Buffer : public streambuf
+	{
+	public:
+		Buffer(const char* data, const size_t& size)
+		{
+			char* begin = const_cast<char*>(data);
+			setg(begin,begin,begin + size);
+		}
+	};
+	Buffer buffer;
+};
+
+#endif // ASSETPACK_H
@@ -55,12 +55,12 @@ bool BasePlayer::load(list<PARAMETER_TYPE >& params)
 		imageOverwrite = "images/player/black_big.png";
 	}
 
-	if (startingState[0] == 0 || startingState == "default")
+	if (startingState == STATE_NONE || startingState == ssDefault)
 	{
 		if (takesControl)
-			startingState = "wave";
+			startingState = ssWave;
 		else
-			startingState = "stand";
+			startingState = ssStand;
 	}
 	setSpriteState(startingState,true);
 
@@ -73,7 +73,7 @@ void BasePlayer::resetTemporary()
 
 	if (currentSprite->getLoops() == -1 || currentSprite->hasFinished())
 	{
-		setSpriteState("stand");
+		setSpriteState(ssStand);
 	}
 }
 
@@ -81,42 +81,42 @@ void BasePlayer::update()
 {
 	if (collisionInfo.correction.y < 0) // on the ground
 	{
-		if (currentState == "stand")
+		if (currentState == ssStand)
 		{
 			if (velocity.x < 0.0f)
-				setSpriteState("runleft");
+				setSpriteState(ssRunLeft);
 			else if (velocity.x > 0.0f)
-				setSpriteState("runright");
+				setSpriteState(ssRunRight);
 		}
 	}
 	else // air
 	{
 		if ( fallCounter > 0 )
 			--fallCounter;
-		if (currentState == "stand")
+		if (currentState == ssStand)
 		{
 			if (fallCounter == 0)
 			{
 				if (direction < 0)
-					setSpriteState("fallleft");
+					setSpriteState(ssFallLeft);
 				else
-					setSpriteState("fallright");
+					setSpriteState(ssFallRight);
 			}
 			else
 			{
 				if (isJumping)
 				{
 					if (direction < 0)
-						setSpriteState("flyleft");
+						setSpriteState(ssFlyLeft);
 					else
-						setSpriteState("flyright");
+						setSpriteState(ssFlyRight);
 				}
 				else
 				{
 					if (velocity.x < 0.0f)
-						setSpriteState("runleft");
+						setSpriteState(ssRunLeft);
 					else if (velocity.x > 0.0f)
-						setSpriteState("runright");
+						setSpriteState(ssRunRight);
 				}
 			}
 		}
@@ -159,8 +159,8 @@ void BasePlayer::control(SimpleJoy* input)
 	{
 		if ((direction > 0 || velocity.x == 0.0f) && ((int)velocity.y == 0))
 		{
-			setSpriteState("turnleft",true);
-			states["runleft"]->rewind(); // reset running anim to match end of turn
+			setSpriteState(ssTurnLeft,true);
+			states.get(ssRunLeft)->rewind(); // reset running anim to match end of turn
 		}
 		if (velocity.x > 0.0f)
 		{
@@ -177,8 +177,8 @@ void BasePlayer::control(SimpleJoy* input)
 	{
 		if ((direction < 0 || velocity.x == 0.0f) && ((int)velocity.y == 0))
 		{
-			setSpriteState("turnright",true);
-			states["runright"]->rewind(); // reset running anim to match end of turn
+			setSpriteState(ssTurnRight,true);
+			states.get(ssRunRight)->rewind(); // reset running anim to match end of turn
 		}
 		if (velocity.x < 0.0f)
 		{
@@ -194,9 +194,9 @@ void BasePlayer::control(SimpleJoy* input)
 	else
 	{
 		activelyMoving = false;
-		if (canJump && currentState != "wave")
+		if (canJump && currentState != ssWave)
 		{
-			setSpriteState("stand");
+			setSpriteState(ssStand);
 		}
 		if ((int)collisionInfo.correction.y != 0)
 		{
@@ -218,9 +218,9 @@ void BasePlayer::control(SimpleJoy* input)
 		canJump = false;
 		isJumping = true;
 		if (direction < 0)
-			setSpriteState("jumpleft",true);
+			setSpriteState(ssJumpLeft,true);
 		else
-			setSpriteState("jumpright",true);
+			setSpriteState(ssJumpRight,true);
 		fallCounter = JUMP_TO_FALL_FRAMES;
 	}
 	if (!(input->isB() || input->isY()))
@@ -28,13 +28,15 @@
 #include "Level.h"
 #include "ControlUnit.h"
 
+const KeywordTable BaseTrigger::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("size",BaseUnit::upSize)
+	.add("enabled",bpEnabled)
+	.add("action",bpAction)
+	.add("activator",bpActivator)
+	.add("autoreenable",bpAutoReEnable);
+
 BaseTrigger::BaseTrigger( Level *newParent ) : BaseUnit( newParent )
 {
-	stringToProp["size"] = BaseUnit::upSize;
-	stringToProp["enabled"] = bpEnabled;
-	stringToProp["action"] = bpAction;
-	stringToProp["activator"] = bpActivator;
-	stringToProp["autoreenable"] = bpAutoReEnable;
 	size.x = 32;
 	size.y = 32;
 	collisionColours.insert(Colour(BLACK).getIntColour());
@@ -75,6 +75,8 @@ protected:
 		bpAutoReEnable,
 		bpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 private:
 
 };
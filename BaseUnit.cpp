@@ -28,61 +28,63 @@
 #include "Random.h"
 
 #include "Level.h"
-#include "GreySurfaceCache.h"
 #include "MusicCache.h"
 #include "MyGame.h"
 
-map<string,int> BaseUnit::stringToFlag;
-map<string,int> BaseUnit::stringToProp;
-map<string,int> BaseUnit::stringToOrder;
-
-BaseUnit::BaseUnit(Level* newParent)
-{
-	// set-up conversion maps
-	stringToFlag["nomapcollision"] = ufNoMapCollision;
-	stringToFlag["nounitcollision"] = ufNoUnitCollision;
-	stringToFlag["nogravity"] = ufNoGravity;
-	stringToFlag["invincible"] = ufInvincible;
-	stringToFlag["missionobjective"] = ufMissionObjective;
-	stringToFlag["noupdate"] = ufNoUpdate;
-	stringToFlag["norender"] = ufNoRender;
-	stringToFlag["disregardboundaries"] = ufDisregardBoundaries;
-	stringToFlag["alwaysontop"] = ufAlwaysOnTop;
-
-	stringToProp["class"] = upClass;
-	stringToProp["startingstate"] = upStartingState;
-	stringToProp["position"] = upPosition;
-	stringToProp["velocity"] = upVelocity;
-	stringToProp["flags"] = upFlags;
-	stringToProp["collision"] = upCollision;
-	stringToProp["imageoverwrite"] = upImageOverwrite;
-	stringToProp["tiles"] = upTilesheet;
-	stringToProp["framerate"] = upFramerate;
-	stringToProp["loops"] = upLoops;
-	stringToProp["transparentcolor"] = upTransCol;
-	stringToProp["transparentcolour"] = upTransCol;
-	stringToProp["colour"] = upColour;
-	stringToProp["color"] = upColour;
-	stringToProp["health"] = upHealth;
-	stringToProp["id"] = upID;
-	stringToProp["order"] = upOrder;
-	stringToProp["size"] = upSize;
-	stringToProp["target"] = upTarget;
-	stringToProp["collisionmode"] = upCollisionMode;
-	stringToProp["state"] = upState;
-
-	stringToOrder["idle"] = okIdle;
-	stringToOrder["position"] = okPosition;
-	stringToOrder["repeat"] = okRepeat;
-	stringToOrder["colour"] = okColour;
-	stringToOrder["color"] = okColour;
-	stringToOrder["explode"] = okExplode;
-	stringToOrder["remove"] = okRemove;
-	stringToOrder["increment"] = okIncrement;
-	stringToOrder["parameter"] = okParameter;
-	stringToOrder["sound"] = okSound;
-	stringToOrder["state"] = okState;
-
+const KeywordTable BaseUnit::stringToFlag = KeywordTable()
+	.add("nomapcollision",ufNoMapCollision)
+	.add("nounitcollision",ufNoUnitCollision)
+	.add("nogravity",ufNoGravity)
+	.add("invincible",ufInvincible)
+	.add("missionobjective",ufMissionObjective)
+	.add("noupdate",ufNoUpdate)
+	.add("norender",ufNoRender)
+	.add("disregardboundaries",ufDisregardBoundaries)
+	.add("alwaysontop",ufAlwaysOnTop);
+
+const KeywordTable BaseUnit::stringToProp = KeywordTable()
+	.add("class",upClass)
+	.add("startingstate",upStartingState)
+	.add("position",upPosition)
+	.add("velocity",upVelocity)
+	.add("flags",upFlags)
+	.add("collision",upCollision)
+	.add("imageoverwrite",upImageOverwrite)
+	.add("tiles",upTilesheet)
+	.add("framerate",upFramerate)
+	.add("loops",upLoops)
+	.add("transparentcolor",upTransCol)
+	.add("transparentcolour",upTransCol)
+	.add("colour",upColour)
+	.add("color",upColour)
+	.add("health",upHealth)
+	.add("id",upID)
+	.add("order",upOrder)
+	.add("size",upSize)
+	.add("target",upTarget)
+	.add("collisionmode",upCollisionMode)
+	.add("state",upState);
+
+const KeywordTable BaseUnit::stringToOrder = KeywordTable()
+	.add("idle",okIdle)
+	.add("position",okPosition)
+	.add("repeat",okRepeat)
+	.add("colour",okColour)
+	.add("color",okColour)
+	.add("explode",okExplode)
+	.add("remove",okRemove)
+	.add("increment",okIncrement)
+	.add("parameter",okParameter)
+	.add("sound",okSound)
+	.add("state",okState);
+
+BaseUnit::BaseUnit(Level* newParent) :
+	body(newParent ? newParent->bodies.allocate() : new UnitBody()),
+	position(body->position),
+	velocity(body->velocity),
+	acceleration(body->acceleration),
+	flags(body->flags)
+{
 	currentSprite = NULL;
 	position = Vector2df(0.0f,0.0f);
 	startingPosition = Vector2df(0.0f,0.0f);
@@ -100,8 +102,8 @@ BaseUnit::BaseUnit(Level* newParent)
 	loops = 0;
 	transCol = MAGENTA;
 	col = WHITE;
-	currentState = "";
-	startingState = "";
+	currentState = STATE_NONE;
+	startingState = STATE_NONE;
 	direction = 0;
 	isPlayer = false;
 	orderRunning = false;
@@ -110,24 +112,32 @@ BaseUnit::BaseUnit(Level* newParent)
 	unitCollisionMode = 2;
 	initOrders = true;
 	isTeleporting = false;
+	maskPaletteSize = -1;
+	maskColourID = -1;
+	maskDirty = true;
 }
 
-BaseUnit::BaseUnit(const BaseUnit& source)
+BaseUnit::BaseUnit(const BaseUnit& source) :
+	body(source.parent ? source.parent->bodies.allocate() : new UnitBody()),
+	position(body->position),
+	velocity(body->velocity),
+	acceleration(body->acceleration),
+	flags(body->flags)
 {
-	//
+	parent = source.parent; // the body has to be released to the same level
 }
 
 BaseUnit::~BaseUnit()
 {
 	collisionInfo.clear();
 	collisionColours.clear();
-	for (map<string,AnimatedSprite*>::iterator iter = states.begin(); iter != states.end(); ++iter)
-	{
-		delete iter->second;
-	}
 	states.clear();
 	orderList.clear();
 	parameters.clear();
+	if (parent)
+		parent->bodies.release(body);
+	else
+		delete body;
 }
 
 /// ---public-------------------------------------------------------------------
@@ -176,8 +186,9 @@ bool BaseUnit::load(list<PARAMETER_TYPE >& params)
 			temp->setFrameRate(framerate);
 			temp->setTransparentColour(transCol);
 			temp->setLooping(loops);
-			states["default"] = temp;
-			startingState = "default";
+			states.set(ssDefault,temp);
+			opacitySpans.clear();
+			startingState = ssDefault;
 		}
 		setSpriteState(startingState,true);
 	}
@@ -193,7 +204,7 @@ bool BaseUnit::processParameter(const PARAMETER_TYPE& value)
 {
 	bool parsed = true;
 
-	switch (stringToProp[value.first])
+	switch (getPropKeys()[value.first])
 	{
 	case upClass:
 	{
@@ -202,7 +213,7 @@ bool BaseUnit::processParameter(const PARAMETER_TYPE& value)
 	}
 	case upStartingState:
 	{
-		startingState = value.second;
+		startingState = StateNames::intern(value.second);
 		break;
 	}
 	case upPosition:
@@ -252,6 +263,7 @@ bool BaseUnit::processParameter(const PARAMETER_TYPE& value)
 	case upCollision:
 	{
 		collisionColours.clear();
+		maskDirty = true;
 		vector<string> token;
 		StringUtility::tokenize(value.second,token,DELIMIT_STRING);
 		for (vector<string>::const_iterator col = token.begin(); col != token.end(); ++col)
@@ -313,9 +325,11 @@ bool BaseUnit::processParameter(const PARAMETER_TYPE& value)
 		if (params.size() < 2)
 		{
 			Order temp;
-			temp.key = stringToOrder[params.front()];
+			temp.key = getOrderKeys()[params.front()];
 			temp.ticks = 1;
 			temp.randomTicks = -1;
+			temp.state = STATE_NONE;
+			temp.fallbackState = ssDefault;
 			orderList.push_back(temp);
 		}
 		else
@@ -325,8 +339,17 @@ bool BaseUnit::processParameter(const PARAMETER_TYPE& value)
 			if (temp.ticks <= 0)
 				temp.ticks = 1;
 			pIsRandomTime(params[1], temp.randomTicks);
-			temp.key = stringToOrder[params.front()];
+			temp.key = getOrderKeys()[params.front()];
 			temp.params.insert(temp.params.begin(), params.begin()+1, params.end());
+			// state,name[,reset[,fallback]]
+			temp.state = STATE_NONE;
+			temp.fallbackState = ssDefault;
+			if (temp.key == okState)
+			{
+				temp.state = StateNames::intern(temp.params[0]);
+				if (temp.params.size() > 2)
+					temp.fallbackState = StateNames::intern(temp.params[2]);
+			}
 			orderList.push_back(temp);
 		}
 		break;
@@ -388,11 +411,8 @@ void BaseUnit::reset()
 	acceleration[0] = Vector2df(0,0);
 	acceleration[1] = Vector2df(0,0);
 	collisionInfo.clear();
-	for (map<string,AnimatedSprite*>::iterator iter = states.begin(); iter != states.end(); ++iter)
-	{
-		delete iter->second;
-	}
 	states.clear();
+	opacitySpans.clear();
 	orderList.clear();
 	toBeRemoved = false;
 	load(parameters);
@@ -420,7 +440,7 @@ void BaseUnit::resetTemporary()
 
 SDL_Surface* BaseUnit::getSurface(CRstring filename, CRbool optimize) const
 {
-	return SURFACE_CACHE->loadSurface(filename,parent->chapterPath,optimize);
+	return parent->getSurface(filename,optimize);
 }
 
 int BaseUnit::getHeight() const
@@ -538,31 +558,83 @@ void BaseUnit::render(SDL_Surface* surf)
 #endif
 }
 
-AnimatedSprite* BaseUnit::setSpriteState(CRstring newState, CRbool reset, CRstring fallbackState)
+void BaseUnit::renderCollision(CollisionMap* const map, SDL_Surface* const surf)
+{
+	if (not currentSprite)
+		return;
+
+	// the unit's colour is registered on loading, a colour changed by orders
+	// maps to COLOUR_ID_NONE unless some unit checks against it anyway
+	Uint8 colourID = map->getColourID(col);
+	int posX = floor(position.x);
+	int posY = floor(position.y);
+	const vector<SDL_Rect>& spans = getOpacitySpans();
+	for (vector<SDL_Rect>::const_iterator I = spans.begin(); I != spans.end(); ++I)
+	{
+		SDL_Rect rect = {posX + I->x, posY + I->y, I->w, I->h};
+		map->fillRect(rect,colourID);
+	}
+}
+
+const vector<SDL_Rect>& BaseUnit::getOpacitySpans()
 {
-	map<string,AnimatedSprite*>::const_iterator state = states.find(newState);
-	if (state != states.end()) // set to desired state
+	pair<AnimatedSprite*,int> key(currentSprite,currentSprite->getCurrentFrame());
+	map<pair<AnimatedSprite*,int>,vector<SDL_Rect> >::iterator iter = opacitySpans.find(key);
+	if (iter != opacitySpans.end())
+		return iter->second;
+
+	vector<SDL_Rect>& spans = opacitySpans[key];
+	Colour none = currentSprite->getTransparentColour();
+	Colour pix = MAGENTA;
+	int width = currentSprite->getWidth();
+	int height = currentSprite->getHeight();
+	for (int Y = 0; Y < height; ++Y)
 	{
-		currentSprite = state->second;
+		int start = -1;
+		for (int X = 0; X <= width; ++X)
+		{
+			bool opaque = false;
+			if (X < width)
+			{
+				pix = currentSprite->getPixel(X,Y);
+				opaque = (pix != none);
+			}
+			if (opaque && start < 0)
+				start = X;
+			else if (not opaque && start >= 0)
+			{
+				SDL_Rect span = {start,Y,X - start,1};
+				spans.push_back(span);
+				start = -1;
+			}
+		}
+	}
+	return spans;
+}
+
+AnimatedSprite* BaseUnit::setSpriteState(CRint newState, CRbool reset, CRint fallbackState)
+{
+	if (states.has(newState)) // set to desired state
+	{
+		currentSprite = states.get(newState);
 		currentState = newState;
 	}
-	else if (fallbackState[0] != 0) // set to fallback or keep the current one
+	else if (fallbackState != STATE_NONE) // set to fallback or keep the current one
 	{
-		state = states.find(fallbackState);
-		if (state != states.end())
+		if (states.has(fallbackState))
 		{
-			currentSprite = state->second;
+			currentSprite = states.get(fallbackState);
 			currentState = fallbackState;
 		}
 		else
 		{
 			printf("Unrecognized sprite state \"%s\" and fallback \"%s\" on unit with id \"%s\"\n",
-				   newState.c_str(),fallbackState.c_str(),id.c_str());
+				   StateNames::getName(newState).c_str(),StateNames::getName(fallbackState).c_str(),id.c_str());
 		}
 	}
 	else
 		printf("Unrecognized sprite state \"%s\" on unit with id \"%s\"\n",
-			   newState.c_str(),id.c_str());
+			   StateNames::getName(newState).c_str(),id.c_str());
 	if (reset && currentSprite)
 		currentSprite->rewind();
 	return currentSprite;
@@ -594,6 +666,26 @@ bool BaseUnit::checkCollisionColour(const Colour& col) const
 	return false;
 }
 
+void BaseUnit::updateCollisionMask(const CollisionMap* const map) const
+{
+	// only the colour's ID can change the result, so fading through unknown
+	// colours does not trigger a rebuild every tick
+	const int colourID = map->getColourID(col);
+	if (not maskDirty && maskPaletteSize == map->getPaletteSize() && maskColourID == colourID)
+		return;
+
+	// use the (virtual) colour check, so child classes with special rules work, too
+	collisionMask.clear();
+	for (int I = COLOUR_ID_NONE + 1; I < map->getPaletteSize(); ++I)
+	{
+		if (checkCollisionColour(map->getColour(I)))
+			collisionMask.set(I);
+	}
+	maskPaletteSize = map->getPaletteSize();
+	maskColourID = colourID;
+	maskDirty = false;
+}
+
 bool BaseUnit::hitUnitCheck(const BaseUnit* const caller) const
 {
 	switch (unitCollisionMode)
@@ -684,7 +776,7 @@ string BaseUnit::debugInfo()
 		result += (*I).unit->id + ",";
 	result += "\n";
 	result += "F: " + StringUtility::intToString(flags.flags) + "\n" +
-			  "S: " + currentState;
+			  "S: " + StateNames::getName(currentState);
 	if (currentSprite)
 		result += " (" + StringUtility::intToString(currentSprite->getCurrentFrame()) + ")\n";
 	else
@@ -787,9 +879,11 @@ void BaseUnit::loadState(SDL_Surface* surf, State state)
 	temp->setFrameRate(state.fps);
 	temp->setLooping(state.loops);
 	temp->setPlayMode(state.mode);
-	if (states.find(state.name) != states.end())
+	int stateID = StateNames::intern(state.name);
+	if (states.has(stateID))
 		printf("Warning: State \"%s\" already present in unit with id %s, will be overridden.", state.name.c_str(), id.c_str());
-	states[state.name] = temp;
+	states.set(stateID,temp);
+	opacitySpans.clear();
 }
 
 
@@ -890,6 +984,7 @@ bool BaseUnit::processOrder(Order& next)
 	}
 	case okState:
 	{
+		// the state names have been interned on loading
 		switch (next.params.size())
 		{
 		case 0:
@@ -897,13 +992,10 @@ bool BaseUnit::processOrder(Order& next)
 					StringUtility::combine(next.params).c_str(), id.c_str(), currentOrder + 1);
 			break;
 		case 1:
-			setSpriteState(next.params.front());
-			break;
-		case 2:
-			setSpriteState(next.params[0], StringUtility::stringToBool(next.params[1]));
+			setSpriteState(next.state);
 			break;
 		default:
-			setSpriteState(next.params[0], StringUtility::stringToBool(next.params[1]), next.params[2]);
+			setSpriteState(next.state, StringUtility::stringToBool(next.params[1]), next.fallbackState);
 		}
 		break;
 	}
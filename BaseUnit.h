@@ -36,7 +36,11 @@
 #include "SimpleDirection.h"
 #include "Colour.h"
 #include "CollisionObject.h"
+#include "CollisionMap.h"
 #include "SimpleFlags.h"
+#include "UnitBody.h"
+#include "SpriteStates.h"
+#include "KeywordTable.h"
 #include "GFX.h"
 #include "AnimatedSprite.h"
 #include "Vector3df.h"
@@ -68,7 +72,8 @@ public:
 	// return true if the data has been successfully processed, false otherwise
 	virtual bool processParameter(const PARAMETER_TYPE& value);
 
-	// resets the unit to its initial state (right after loading)
+	// resets the unit to its initial state (right after loading) by processing
+	// its parameters again, there is no snapshot of unit state
 	virtual void reset();
 	// restarts the order system
 	void resetOrder(const bool &clear=false);
@@ -89,17 +94,25 @@ public:
 	virtual void updateScreenPosition(const Vector2di& offset);
 	virtual void render() {render(GFX::getVideoSurface());}
 	virtual void render(SDL_Surface* surf);
+	// updates the collision map after the unit has been rendered to the collision
+	// surface, by default the opaque pixels of the current frame are set to the
+	// unit's colour ID
+	virtual void renderCollision(CollisionMap* const map, SDL_Surface* const surf);
 
-	// sets the currently displayed sprite to a state linked in the map
+	// sets the currently displayed sprite to a state (ID from StateNames) in states
 	// sets to fallbackState if newState is not found, does not set anything if that is not found either
+	// pass STATE_NONE as fallbackState to keep the current sprite in that case
 	// if reset is true the new sprite will be set to the first frame before returning
 	// returns the new currentSprite
-	AnimatedSprite* setSpriteState(CRstring newState, CRbool reset=false, CRstring fallbackState="default");
+	AnimatedSprite* setSpriteState(CRint newState, CRbool reset=false, CRint fallbackState=ssDefault);
 
 	// called after a collision check with the map
 	virtual void hitMap(const Vector2df& correctionOverride);
 	// checks whether the unit collides with the passed colour
 	virtual bool checkCollisionColour(const Colour& col) const;
+	// rebuilds collisionMask from checkCollisionColour if the palette of the
+	// passed map or the unit's colours have changed since the last call
+	void updateCollisionMask(const CollisionMap* const map) const;
 	// called when a collision with another unit occurs, checks whether this unit
 	// wants to be affected by the other
 	virtual bool hitUnitCheck(const BaseUnit* const caller) const;
@@ -113,23 +126,29 @@ public:
 	virtual string debugInfo();
 	#endif
 
-	Vector2df position;
+	// the physics state, owned by the parent level's body pool (the references
+	// below point into it)
+	UnitBody* const body;
+	Vector2df& position;
 	Vector2df startingPosition;
-	Vector2df velocity; // velocity caused by the unit's movement
-	Vector2df acceleration[2]; // 0 - increment, 1 - maximum
+	Vector2df& velocity; // velocity caused by the unit's movement
+	Vector2df (&acceleration)[2]; // 0 - increment, 1 - maximum
 	int direction; // the direction the unit is facing (used for sprite orientation)
 	set<int> collisionColours;
+	// collisionColours (and own colour) as bits over the level's colour IDs,
+	// cached state, see updateCollisionMask
+	mutable CollisionMask collisionMask;
 	CollisionObject collisionInfo; // contains colliding pixels, correction, etc.
 	unsigned int unitCollisionMode; // 0 - never collide (be affected by other units),
 									// 1 - always, 2 - yes, but check collision colours
-	SimpleFlags flags;
+	SimpleFlags& flags;
 	Colour col; // the colour of this unit
 
 
 	// this is only a "working" pointer, it will not get deleted
 	AnimatedSprite* currentSprite;
-	string currentState;
-	string startingState;
+	int currentState; // state ID, see StateNames
+	int startingState;
 
 	bool toBeRemoved; // if true, this unit will be deleted by Level on the next tick
 	Level* parent; // the unit is currently owned by this Level class
@@ -140,6 +159,9 @@ public:
 	string id;
 
 	bool orderRunning; // is this unit currently executing orders?
+	// position in the order list, saved and restored by RewindBuffer
+	void getOrderCursor(int& order, int& timer) const {order = currentOrder; timer = orderTimer;}
+	void setOrderCursor(CRint order, CRint timer) {currentOrder = order; orderTimer = timer;}
 
 	enum UnitFlag
 	{
@@ -155,8 +177,7 @@ public:
 		ufEOL=512
 	};
 	// converts a string from a level file to a usable flag
-	// you can simply add unit-specific flags in child classes
-	static map<string,int> stringToFlag;
+	static const KeywordTable stringToFlag;
 
 	// Copy of the parameters this unit was loaded with
 	list<PARAMETER_TYPE > parameters;
@@ -196,12 +217,14 @@ protected:
 		upEOL // end of list value, starting point for child classes' lists
 	};
 	// converts a string from a level file to a propIdent usable in a switch statement
-	// simply add unit-specific props in child classes' constructors
-	static map<string,int> stringToProp;
+	// child classes define their own table (with this one as parent) for
+	// unit-specific props and return it from getPropKeys
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 
-	// Store all the sprites in here along with an unique string for identifing
+	// Store all the sprites in here indexed by their state ID (see StateNames)
 	// These sprites WILL get deleted on destruction of the unit
-	map<string,AnimatedSprite*> states;
+	SpriteStateList states;
 	struct State
 	{
 		string name;
@@ -212,6 +235,11 @@ protected:
 		PlayMode mode;
 	};
 	vector<State> stateParams;
+	// opaque pixels of each sprite frame as one pixel high spans relative to the
+	// sprite, built on first use so renderCollision does not read the surface
+	// every tick, has to be cleared whenever a sprite in states is replaced
+	map<pair<AnimatedSprite*,int>,vector<SDL_Rect> > opacitySpans;
+	const vector<SDL_Rect>& getOpacitySpans();
 
 	virtual void loadState(SDL_Surface *surf, State state);
 
@@ -222,6 +250,8 @@ protected:
 		int ticks;
 		int randomTicks;
 		vector<string> params; // consists of several items, mostly time and something like position, speed, etc.
+		int state; // interned state names of okState orders
+		int fallbackState;
 	};
 	enum OrderKey
 	{
@@ -246,7 +276,9 @@ protected:
 	// this is just working around the limitations of frame-based movement
 	// Lesson: Don't use frame-based movement in your games, if you can avoid it
 	virtual bool finishOrder(const Order& curr);
-	static map<string,int> stringToOrder;
+	// same as stringToProp for orders
+	static const KeywordTable stringToOrder;
+	virtual const KeywordTable& getOrderKeys() const {return stringToOrder;}
 	vector<Order> orderList;
 	int currentOrder;
 	int orderTimer;
@@ -264,6 +296,11 @@ protected:
 	// Used for big position changes after Level::load
 	Vector2df teleportPosition;
 	bool isTeleporting;
+
+	// state of the palette and unit when collisionMask was last built
+	mutable int maskPaletteSize;
+	mutable int maskColourID;
+	mutable bool maskDirty; // set when collisionColours changes
 private:
 };
 
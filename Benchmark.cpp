@@ -1,11 +1,19 @@
 #include "Benchmark.h"
 
+// defaults, used if the level file does not specify a scenario
 #define GRAPH_UPDATE 1000
+#define PHASE_DURATION 10000
+#define SPAWN_RATE 4
+#define EXPLOSION_RATE 4
 
 #define LEFT_REGION SDL_Rect left = {50,50,250,200}
 #define RIGHT_REGION SDL_Rect right = {500,50,250,200}
 
+#define KERNEL_BENCHMARK_STEPS 1000000 // particle updates per run of the kernel benchmark
+
 #include <limits.h>
+#include <string.h>
+#include <fstream>
 
 /*
 	Greyout - a colourful platformer about love
@@ -35,16 +43,138 @@
 #include "ControlUnit.h"
 #include "LevelLoader.h"
 #include "MyGame.h"
+#include "Physics.h"
+#include "StringUtility.h"
+#include "Random.h"
+#include "Timing.h"
+
+// average time per tick
+static double perTick(const Uint64& time, CRint ticks)
+{
+	return (double)time / (double)max(ticks,1);
+}
+
+// escapes quotes and backslashes (windows paths) for use in a JSON string
+static string jsonEscape(const string& text)
+{
+	string result;
+	for (string::const_iterator I = text.begin(); I != text.end(); ++I)
+	{
+		if (*I == '"' || *I == '\\')
+			result += '\\';
+		result += *I;
+	}
+	return result;
+}
+
+// a particle the way it was stored before ParticlePool, one heap object with
+// its own copy of the collision mask, used as the kernel benchmark's baseline
+struct KernelParticle
+{
+	Vector2df position;
+	Vector2df velocity;
+	Uint8 colourID;
+	CollisionMask collisionMask;
+};
+
+// the previous per-object particle tick: gravity, map collision, movement
+static void kernelParticleStep(const CollisionMap* const colMap, KernelParticle* const particle)
+{
+	particle->velocity.x = min(max(particle->velocity.x + PHYSICS->gravity.x,-PHYSICS->maximum.x),PHYSICS->maximum.x);
+	particle->velocity.y = min(max(particle->velocity.y + PHYSICS->gravity.y,-PHYSICS->maximum.y),PHYSICS->maximum.y);
+
+	Vector2df correction(0,0);
+	Vector2di pixelCorrection(NumberUtility::sign(particle->velocity.x) * -1,NumberUtility::sign(particle->velocity.y) * -1);
+	const Vector2df& pos = particle->position;
+	const Vector2df& vel = particle->velocity;
+	Uint8 id;
+	if (pixelCorrection.x != 0)
+	{
+		while (abs(correction.x) < abs(vel.x))
+		{
+			float x = pos.x + vel.x + correction.x;
+			if (x < 0 || pos.y < 0 || x >= colMap->getWidth() || pos.y >= colMap->getHeight())
+				break;
+			id = colMap->getID(x,pos.y);
+			if ((id != COLOUR_ID_NONE && id == particle->colourID) || particle->collisionMask.test(id))
+				correction.x += pixelCorrection.x;
+			else
+				break;
+		}
+	}
+	if (pixelCorrection.y != 0)
+	{
+		while (abs(correction.y) < abs(vel.y))
+		{
+			float y = pos.y + vel.y + correction.y;
+			if (pos.x < 0 || y < 0 || pos.x >= colMap->getWidth() || y >= colMap->getHeight())
+				break;
+			id = colMap->getID(pos.x,y);
+			if ((id != COLOUR_ID_NONE && id == particle->colourID) || particle->collisionMask.test(id))
+				correction.y += pixelCorrection.y;
+			else
+				break;
+		}
+	}
 
+	if (abs(correction.x) > abs(correction.y))
+		particle->velocity.x *= -1;
+	else if (correction.y != 0)
+		particle->velocity.y *= -0.5;
+
+	particle->position += particle->velocity;
+}
 
 Benchmark::Benchmark() : Level()
 {
-	phases[0] = 0;
-	phases[1] = 10000;
-	phases[2] = 20000;
+	stringToProp["phases"] = bpPhases;
+	stringToProp["spawnrate"] = bpSpawnRate;
+	stringToProp["explosionrate"] = bpExplosionRate;
+	stringToProp["spawnclass"] = bpSpawnClass;
+	stringToProp["spawnparameter"] = bpSpawnParameter;
+	stringToProp["spawnregions"] = bpSpawnRegions;
+	stringToProp["interval"] = bpInterval;
+	stringToProp["particledensity"] = bpParticleDensity;
+	stringToProp["fixedticks"] = bpFixedTicks;
+	stringToProp["seed"] = bpSeed;
+	stringToProp["output"] = bpOutput;
+	stringToProp["kernelbenchmark"] = bpKernelBenchmark;
+
+	// default scenario: spawn boxes, then explode them
+	Phase phase;
+	memset(&phase,0,sizeof(phase));
+	phase.duration = PHASE_DURATION;
+	phase.spawnRate = SPAWN_RATE;
+	phases.push_back(phase);
+	phase.spawnRate = 0;
+	phase.explosionRate = EXPLOSION_RATE;
+	phases.push_back(phase);
+
+	spawnParams.push_back(make_pair("class","pushablebox"));
+	spawnParams.push_back(make_pair("collision","0"));
+	spawnParams.push_back(make_pair("size","24,24"));
+	spawnParams.push_back(make_pair("health","2"));
+	LEFT_REGION;
+	RIGHT_REGION;
+	spawnRegions.push_back(left);
+	spawnRegions.push_back(right);
+
+	interval = GRAPH_UPDATE;
+	particleDensity = -1;
+	oldParticleDensity = -1;
+	fixedTicks = false;
+	seed = -1;
+	outputFile = "";
+	kernelBenchmark = false;
+
 	currentPhase = 0;
-	secondIndex.push_back(0);
-	fpsCount = 0;
+	finished = false;
+	phaseStart = 0;
+	phaseStartMicro = 0;
+	nextInterval = 0;
+	intervalTicks = 0;
+	intervalStart = 0;
+	collisionStart = 0;
 	boxCount = 0;
 	particleCount = 0;
 }
@@ -52,22 +182,173 @@ Benchmark::Benchmark() : Level()
 Benchmark::~Benchmark()
 {
 	fpsData.clear();
-	secondIndex.clear();
+	if (oldParticleDensity >= 0)
+		ENGINE->settings->setParticleDensity(oldParticleDensity);
 	ENGINE->setFrameRate(FRAME_RATE);
 }
 
+bool Benchmark::processParameter(const PARAMETER_TYPE& value)
+{
+	if (Level::processParameter(value))
+		return true;
+
+	bool parsed = true;
+
+	switch (stringToProp[value.first])
+	{
+	case bpPhases:
+	{
+		vector<string> token;
+		StringUtility::tokenize(value.second,token,DELIMIT_STRING);
+		if (token.empty())
+		{
+			parsed = false;
+			break;
+		}
+		Phase phase;
+		memset(&phase,0,sizeof(phase));
+		phases.resize(token.size(),phase);
+		for (int I = 0; I < token.size(); ++I)
+			phases[I].duration = StringUtility::stringToInt(token[I]);
+		break;
+	}
+	case bpSpawnRate:
+	case bpExplosionRate:
+	{
+		vector<string> token;
+		StringUtility::tokenize(value.second,token,DELIMIT_STRING);
+		for (int I = 0; I < min(token.size(),phases.size()); ++I)
+		{
+			if (stringToProp[value.first] == bpSpawnRate)
+				phases[I].spawnRate = StringUtility::stringToInt(token[I]);
+			else
+				phases[I].explosionRate = StringUtility::stringToInt(token[I]);
+		}
+		// rates for phases not listed stay at their default
+		break;
+	}
+	case bpSpawnClass:
+	{
+		spawnParams.front().second = value.second;
+		break;
+	}
+	case bpSpawnParameter:
+	{
+		// key:value, replaces an earlier value for the same key
+		int pos = value.second.find(':');
+		if (pos == string::npos)
+		{
+			parsed = false;
+			break;
+		}
+		PARAMETER_TYPE param = make_pair(value.second.substr(0,pos),value.second.substr(pos+1));
+		list<PARAMETER_TYPE >::iterator I;
+		for (I = spawnParams.begin(); I != spawnParams.end(); ++I)
+		{
+			if (I->first == param.first)
+			{
+				I->second = param.second;
+				break;
+			}
+		}
+		if (I == spawnParams.end())
+			spawnParams.push_back(param);
+		break;
+	}
+	case bpSpawnRegions:
+	{
+		vector<string> token;
+		StringUtility::tokenize(value.second,token,DELIMIT_STRING);
+		if (token.size() % 4 != 0)
+		{
+			parsed = false;
+			break;
+		}
+		spawnRegions.clear();
+		for (int I = 0; I < token.size(); I += 4)
+		{
+			SDL_Rect region;
+			region.x = StringUtility::stringToInt(token[I]);
+			region.y = StringUtility::stringToInt(token[I+1]);
+			region.w = StringUtility::stringToInt(token[I+2]);
+			region.h = StringUtility::stringToInt(token[I+3]);
+			spawnRegions.push_back(region);
+		}
+		break;
+	}
+	case bpInterval:
+	{
+		interval = max(StringUtility::stringToInt(value.second),1);
+		break;
+	}
+	case bpParticleDensity:
+	{
+		particleDensity = StringUtility::stringToInt(value.second);
+		// keep the original setting when reloading on reset
+		if (oldParticleDensity < 0)
+			oldParticleDensity = ENGINE->settings->getParticleDensity();
+		ENGINE->settings->setParticleDensity(particleDensity);
+		break;
+	}
+	case bpFixedTicks:
+	{
+		fixedTicks = StringUtility::stringToBool(value.second);
+		break;
+	}
+	case bpSeed:
+	{
+		seed = StringUtility::stringToInt(value.second);
+		break;
+	}
+	case bpOutput:
+	{
+		outputFile = value.second;
+		break;
+	}
+	case bpKernelBenchmark:
+	{
+		kernelBenchmark = StringUtility::stringToBool(value.second);
+		break;
+	}
+	default:
+		parsed = false;
+	}
+
+	return parsed;
+}
+
 void Benchmark::init()
 {
 	ENGINE->setFrameRate(1000);
-	second.init(GRAPH_UPDATE,MILLI_SECONDS,this,Benchmark::secondCallback);
-	second.setRewind(REWIND);
-	second.start();
-	counter.init(phases[currentPhase+1]-phases[currentPhase],MILLI_SECONDS,this,Benchmark::timerCallback);
-	counter.setRewind(STOP);
-	counter.start();
+	if (seed >= 0)
+	{
+		srand(seed);
+		Random::setSeed(seed);
+	}
+
+	for (vector<Phase>::iterator I = phases.begin(); I != phases.end(); ++I)
+	{
+		I->ticks = 0;
+		I->wallTime = 0;
+		I->updateTime = 0;
+		I->collisionTime = 0;
+		I->renderTime = 0;
+		I->flipTime = 0;
+		I->units = 0;
+		I->particles = 0;
+	}
+	currentPhase = 0;
+	finished = false;
+	fpsData.clear();
+	phaseStart = SDL_GetTicks();
+	phaseStartMicro = getMicroTicks();
+	intervalStart = phaseStartMicro;
+	nextInterval = interval;
+	intervalTicks = 0;
 
 	winCounter = 1;
 	SDL_BlitSurface(levelImage,NULL,collisionLayer,NULL);
+	initCollisionMap();
 	boxCount = 0;
 	particleCount = 0;
 }
@@ -90,10 +371,56 @@ void Benchmark::userInput()
 
 void Benchmark::update()
 {
+	if (finished)
+		return;
+
+	Phase& phase = phases[currentPhase];
+	if (phase.ticks > 0) // flip of the last frame of this phase
+		phase.flipTime += ENGINE->flipTime;
+
+	Uint64 start = getMicroTicks();
 	Level::update();
-	++fpsCount;
-	second.update();
-	counter.update();
+	phase.updateTime += getMicroTicks() - start;
+	++phase.ticks;
+	++intervalTicks;
+
+	int elapsed;
+	if (fixedTicks)
+		elapsed = phase.ticks * 1000 / FRAME_RATE;
+	else
+		elapsed = SDL_GetTicks() - phaseStart;
+	while (elapsed >= nextInterval && nextInterval <= phase.duration)
+	{
+		intervalUpdate();
+		nextInterval += interval;
+	}
+
+	if (elapsed >= phase.duration)
+	{
+		phase.wallTime = getMicroTicks() - phaseStartMicro;
+		phase.units = units.size();
+		++currentPhase;
+		if (currentPhase >= phases.size())
+		{
+			finished = true;
+			generateFPSData();
+			setNextState(STATE_MAIN);
+		}
+		else
+		{
+			phaseStart = SDL_GetTicks();
+			phaseStartMicro = getMicroTicks();
+			nextInterval = interval;
+		}
+	}
+}
+
+void Benchmark::render()
+{
+	Uint64 start = getMicroTicks();
+	Level::render();
+	if (not finished)
+		phases[currentPhase].renderTime += getMicroTicks() - start;
 }
 
 void Benchmark::pauseUpdate()
@@ -101,6 +428,19 @@ void Benchmark::pauseUpdate()
 	update();
 }
 
+/// ---protected---
+
+void Benchmark::onCollisionStart()
+{
+	collisionStart = getMicroTicks();
+}
+
+void Benchmark::onCollisionEnd()
+{
+	if (not finished)
+		phases[currentPhase].collisionTime += getMicroTicks() - collisionStart;
+}
+
 void Benchmark::generateFPSData()
 {
 	float minFPS = INT_MAX;
@@ -113,127 +453,231 @@ void Benchmark::generateFPSData()
 		maxFPS = max((*I),maxFPS);
 		averageFPS += (*I);
 	}
-	averageFPS /= fpsData.size();
+	if (fpsData.empty())
+		minFPS = 0;
+	else
+		averageFPS /= fpsData.size();
+
+	int duration = 0;
+	int ticks = 0;
+	for (vector<Phase>::const_iterator I = phases.begin(); I != phases.end(); ++I)
+	{
+		duration += I->duration;
+		ticks += I->ticks;
+	}
 
 	printf("----------\n");
 	printf("Benchmark results:\n");
 	printf("----------\n");
-	printf("Duration (ms): %i\n",phases[sizeof(phases)/sizeof(phases[0])-1]);
-	printf("Graph update (ms): %i\n",second.getLimit());
+	printf("Duration (ms): %i%s\n",duration,fixedTicks ? " (fixed ticks)" : "");
+	printf("Graph update (ms): %i\n",interval);
 	printf("FPS (min): %.2f\n",minFPS);
 	printf("FPS (max): %.2f\n",maxFPS);
 	printf("FPS (avg): %.2f\n",averageFPS);
 	printf("FPS Graph:");
-	for (int I = 0; I < secondIndex.size()-1; ++I)
-	{
-		averageFPS = 0;
-		for (int K = secondIndex[I]; K < secondIndex[I+1]; ++K)
-			averageFPS += fpsData[K];
-		averageFPS /= secondIndex[I+1] - secondIndex[I];
-		printf(" %.2f",averageFPS);
-	}
+	for (vector<float>::const_iterator I = fpsData.begin(); I != fpsData.end(); ++I)
+		printf(" %.2f",*I);
 	printf("\n");
-	fpsCount = 0;
-	for (int I = 0; I < fpsData.size(); ++I)
-		fpsCount += fpsData[I];
-	printf("Update cycles (#): %i\n",fpsCount);
+	printf("Update cycles (#): %i\n",ticks);
 	printf("Boxes total (#): %i\n",boxCount);
 	printf("Particles total (#): %i\n",particleCount);
 	printf("----------\n");
+	printf("Time per tick (us): update (collision), render, flip\n");
+	for (int I = 0; I < phases.size(); ++I)
+	{
+		printf("Phase %i: %.1f (%.1f), %.1f, %.1f\n",I,perTick(phases[I].updateTime,phases[I].ticks),
+				perTick(phases[I].collisionTime,phases[I].ticks),perTick(phases[I].renderTime,phases[I].ticks),
+				perTick(phases[I].flipTime,phases[I].ticks));
+	}
+	printf("----------\n");
+	if (outputFile[0] != 0)
+		writeResults();
+	if (kernelBenchmark)
+		particleKernelBenchmark();
 	printf("Benchmark finished successfully!\n");
 }
 
-void Benchmark::secondUpdate()
+void Benchmark::writeResults()
 {
-	fpsData.push_back(fpsCount);
-	fpsCount = 0;
-	secondIndex.push_back(fpsData.size());
+	ofstream file(outputFile.c_str());
+	if (file.fail())
+	{
+		printf("Failed to open file for write: \"%s\"\n",outputFile.c_str());
+		return;
+	}
+
+	const int FIELD_COUNT = 11;
+	const char* names[FIELD_COUNT] = {"phase","duration_ms","ticks","wall_ms","ticks_per_second",
+			"update_us","collision_us","render_us","flip_us","units","particles"};
+	bool json = outputFile.size() >= 5 && outputFile.substr(outputFile.size() - 5) == ".json";
 
-	switch (currentPhase)
+	if (json)
 	{
-	case 0:
-		spawnBox();
-		break;
-	case 1:
-		explodeBox();
-		break;
-	default:
-		break;
+		file << "{\n";
+		file << "\t\"level\": \"" << jsonEscape(levelFileName) << "\",\n";
+		file << "\t\"fixedticks\": " << (fixedTicks ? "true" : "false") << ",\n";
+		file << "\t\"seed\": " << seed << ",\n";
+		file << "\t\"phases\": [\n";
+	}
+	else
+	{
+		for (int I = 0; I < FIELD_COUNT; ++I)
+			file << (I > 0 ? "," : "") << names[I];
+		file << "\n";
 	}
-}
 
-void Benchmark::spawnBox()
-{
-	// spawn some boxes
-	LEFT_REGION;
-	list<PARAMETER_TYPE > params;
-	params.push_back(make_pair("class","pushablebox"));
-	params.push_back(make_pair("collision","0"));
-	params.push_back(make_pair("size","24,24"));
-	params.push_back(make_pair("health","2"));
-
-	BaseUnit* box = LEVEL_LOADER->createUnit(params,this);
-	box->position.x = rand() % (left.w) + left.x;
-	box->position.y = rand() % (left.h / 2) + left.y;
-	units.push_back(box);
-	boxCount++;
-	box = LEVEL_LOADER->createUnit(params,this);
-	box->position.x = rand() % (left.w) + left.x;
-	box->position.y = rand() % (left.h / 2) + left.y + (left.h / 2);
-	units.push_back(box);
-	boxCount++;
+	for (int I = 0; I < phases.size(); ++I)
+	{
+		const Phase& phase = phases[I];
+		double values[FIELD_COUNT] = {(double)I,(double)phase.duration,(double)phase.ticks,phase.wallTime / 1000.0,
+				phase.ticks * 1000000.0 / max(phase.wallTime,(Uint64)1),perTick(phase.updateTime,phase.ticks),
+				perTick(phase.collisionTime,phase.ticks),perTick(phase.renderTime,phase.ticks),
+				perTick(phase.flipTime,phase.ticks),(double)phase.units,(double)phase.particles};
+		if (json)
+		{
+			file << "\t\t{";
+			for (int K = 0; K < FIELD_COUNT; ++K)
+				file << (K > 0 ? ", " : "") << "\"" << names[K] << "\": " << values[K];
+			file << "}" << (I + 1 < phases.size() ? "," : "") << "\n";
+		}
+		else
+		{
+			for (int K = 0; K < FIELD_COUNT; ++K)
+				file << (K > 0 ? "," : "") << values[K];
+			file << "\n";
+		}
+	}
 
-	RIGHT_REGION;
-	box = LEVEL_LOADER->createUnit(params,this);
-	box->position.x = rand() % (right.w) + right.x;
-	box->position.y = rand() % (right.h / 2) + right.y;
-	units.push_back(box);
-	boxCount++;
-	box = LEVEL_LOADER->createUnit(params,this);
-	box->position.x = rand() % (right.w) + right.x;
-	box->position.y = rand() % (right.h / 2) + right.y + (right.h / 2);
-	units.push_back(box);
-	boxCount++;
+	if (json)
+		file << "\t]\n}\n";
+	file.close();
+	printf("Benchmark results written to \"%s\"\n",outputFile.c_str());
 }
 
-void Benchmark::explodeBox()
+void Benchmark::particleKernelBenchmark()
 {
-	int I = 0;
-	for (int K = 0; K < min((int)units.size(),4); ++K)
+	printf("Particle kernel (per-object vs. scalar vs. SIMD):\n");
+
+	// own map, so the level's palette is left untouched
+	CollisionMap scratch;
+	scratch.loadBase(levelImage);
+	CollisionMask mask;
+	Uint8 black = scratch.registerColour(Colour(BLACK));
+	mask.set(black);
+	mask.set(scratch.registerColour(Colour(WHITE)));
+
+	int counts[] = {10000,100000,1000000};
+	for (int I = 0; I < sizeof(counts) / sizeof(counts[0]); ++I)
 	{
-		int temp = effects.size();
-		do
+		int iterations = max(KERNEL_BENCHMARK_STEPS / counts[I],1);
+
+		// same random particles for all runs
+		ParticlePool pool;
+		pool.reserve(counts[I]);
+		int maskIndex = pool.addMask(mask);
+		vector<KernelParticle*> objects;
+		objects.reserve(counts[I]);
+		for (int K = 0; K < counts[I]; ++K)
 		{
-			I = rand() % units.size();
+			Vector2df pos(rand() % getWidth(),rand() % getHeight());
+			Vector2df vel((rand() % 200 - 100) / 20.0f,(rand() % 200 - 100) / 20.0f);
+			pool.add(pos,vel,Colour(BLACK),black,iterations + 1,maskIndex);
+			KernelParticle* temp = new KernelParticle;
+			temp->position = pos;
+			temp->velocity = vel;
+			temp->colourID = black;
+			temp->collisionMask = mask;
+			objects.push_back(temp);
 		}
-		while (units[I]->toBeRemoved);
-		units[I]->explode();
-		particleCount += effects.size() - temp;
+
+		int times[3];
+		int start = SDL_GetTicks();
+		for (int L = 0; L < iterations; ++L)
+		{
+			for (vector<KernelParticle*>::iterator P = objects.begin(); P != objects.end(); ++P)
+				kernelParticleStep(&scratch,*P);
+		}
+		times[0] = SDL_GetTicks() - start;
+
+		ParticlePool results[2];
+		for (int K = 0; K < 2; ++K)
+		{
+			PHYSICS->vectorise = (K == 1);
+			results[K] = pool;
+			start = SDL_GetTicks();
+			for (int L = 0; L < iterations; ++L)
+			{
+				PHYSICS->particlePhysics(&scratch,&results[K]);
+				results[K].update();
+			}
+			times[K + 1] = SDL_GetTicks() - start;
+		}
+		PHYSICS->vectorise = true;
+
+		bool match = (results[0].posX == results[1].posX && results[0].posY == results[1].posY &&
+					  results[0].velX == results[1].velX && results[0].velY == results[1].velY);
+		for (int K = 0; K < counts[I]; ++K)
+		{
+			match = match && objects[K]->position.x == results[0].posX[K] && objects[K]->position.y == results[0].posY[K];
+			delete objects[K];
+		}
+		printf("%i particles x %i: %i ms per-object, %i ms scalar (%.2fx), %i ms SIMD (%.2fx)%s\n",counts[I],iterations,
+			   times[0],times[1],(float)times[0] / max(times[1],1),times[2],(float)times[0] / max(times[2],1),
+			   match ? "" : " - RESULTS DIFFER!");
 	}
+	printf("----------\n");
 }
 
-void Benchmark::timerCallback(void* object)
+void Benchmark::intervalUpdate()
 {
-	Benchmark* self = (Benchmark*) object;
-	if (self->secondIndex.size() <= self->phases[self->currentPhase] / GRAPH_UPDATE)
+	Uint64 now = getMicroTicks();
+	fpsData.push_back(intervalTicks * 1000000.0f / max(now - intervalStart,(Uint64)1));
+	intervalTicks = 0;
+	intervalStart = now;
+
+	spawnUnits(phases[currentPhase].spawnRate);
+	explodeUnits(phases[currentPhase].explosionRate);
+}
+
+void Benchmark::spawnUnits(CRint count)
+{
+	if (spawnRegions.empty())
+		return;
+
+	for (int I = 0; I < count; ++I)
 	{
-		self->secondUpdate();
-		self->second.start(GRAPH_UPDATE);
+		BaseUnit* unit = LEVEL_LOADER->createUnit(spawnParams,this);
+		if (not unit)
+		{
+			printf("ERROR: Could not create benchmark unit of class \"%s\"\n",spawnParams.front().second.c_str());
+			return;
+		}
+		// spread evenly over the regions
+		const SDL_Rect& region = spawnRegions[boxCount % spawnRegions.size()];
+		unit->position.x = rand() % max((int)region.w,1) + region.x;
+		unit->position.y = rand() % max((int)region.h,1) + region.y;
+		units.push_back(unit);
+		boxCount++;
 	}
-	self->currentPhase++;
-	if (self->currentPhase >= sizeof(self->phases) / sizeof(self->phases[0]))
+}
+
+void Benchmark::explodeUnits(CRint count)
+{
+	vector<int> candidates;
+	for (int I = 0; I < units.size(); ++I)
 	{
-		self->generateFPSData();
-		self->setNextState(STATE_MAIN);
+		if (not units[I]->toBeRemoved)
+			candidates.push_back(I);
 	}
-	else
+
+	for (int K = 0; K < count && not candidates.empty(); ++K)
 	{
-		self->counter.start(self->phases[self->currentPhase+1] - self->phases[self->currentPhase]);
+		int pick = rand() % candidates.size();
+		int temp = particles.size();
+		units[candidates[pick]]->explode();
+		particleCount += particles.size() - temp;
+		phases[currentPhase].particles += particles.size() - temp;
+		candidates[pick] = candidates.back();
+		candidates.pop_back();
 	}
 }
-
-void Benchmark::secondCallback(void* object)
-{
-	Benchmark* self = (Benchmark*) object;
-	self->secondUpdate();
-}
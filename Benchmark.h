@@ -28,7 +28,23 @@
 #include <vector>
 
 #include "Level.h"
-#include "CountDown.h"
+
+/**
+Configurable benchmark level, the scenario is set in the level file:
+phases - duration of each phase in ms (comma-separated)
+spawnrate, explosionrate - units spawned/exploded per interval for each phase
+spawnclass - unit class to spawn, spawnparameter=key:value adds a parameter
+spawnregions - x,y,w,h of each region units get spawned in
+interval - length of a spawn/explosion/measurement interval in ms
+particledensity - overrides the particle density setting (0-3)
+fixedticks - if true time advances by 1000/FRAME_RATE ms per update instead of
+	by wall-clock time, so every run simulates exactly the same frames
+seed - seed for the random spawn positions
+output - results file, JSON if the name ends in .json, else CSV
+kernelbenchmark - if true the particle kernel is timed separately after the
+	scenario has finished (off by default, takes a few seconds)
+Update, collision, render and flip times are measured per phase
+**/
 
 class Benchmark : public Level
 {
@@ -36,30 +52,86 @@ class Benchmark : public Level
 		Benchmark();
 		virtual ~Benchmark();
 
+		virtual bool processParameter(const PARAMETER_TYPE& value);
+
 		virtual void init();
 		virtual void userInput();
 		virtual void update();
+		virtual void render();
 		virtual void pauseUpdate();
 	protected:
+		virtual void onCollisionStart();
+		virtual void onCollisionEnd();
+
 		virtual void generateFPSData();
-		virtual void secondUpdate();
-		virtual void spawnBox();
-		virtual void explodeBox();
-
-		vector<float> fpsData;
-		vector<int> secondIndex;
-		CountDown counter;
-		CountDown second;
-		int phases[3];
+		// writes the per-phase results to outputFile
+		virtual void writeResults();
+		// called every interval, records the FPS and spawns/explodes units
+		virtual void intervalUpdate();
+		virtual void spawnUnits(CRint count);
+		virtual void explodeUnits(CRint count);
+		// times Physics::particlePhysics with and without SIMD at different
+		// particle counts on a scratch copy of the level image, results are
+		// printed, only run if kernelBenchmark is set
+		virtual void particleKernelBenchmark();
+
+		enum BenchmarkProp
+		{
+			bpPhases=Level::lpEOL,
+			bpSpawnRate,
+			bpExplosionRate,
+			bpSpawnClass,
+			bpSpawnParameter,
+			bpSpawnRegions,
+			bpInterval,
+			bpParticleDensity,
+			bpFixedTicks,
+			bpSeed,
+			bpOutput,
+			bpKernelBenchmark,
+			bpEOL
+		};
+
+		struct Phase
+		{
+			// scenario
+			int duration; // ms
+			int spawnRate;
+			int explosionRate;
+			// results
+			int ticks;
+			Uint64 wallTime; // all times in microseconds
+			Uint64 updateTime; // includes collisionTime
+			Uint64 collisionTime;
+			Uint64 renderTime;
+			Uint64 flipTime;
+			int units; // at the end of the phase
+			int particles; // created during the phase
+		};
+		vector<Phase> phases;
 		int currentPhase;
+		bool finished;
+
+		list<PARAMETER_TYPE > spawnParams;
+		vector<SDL_Rect> spawnRegions;
+		int interval;
+		int particleDensity; // -1 to use the setting
+		int oldParticleDensity;
+		bool fixedTicks;
+		int seed;
+		string outputFile;
+		bool kernelBenchmark;
+
+		vector<float> fpsData; // one entry per interval
+		int phaseStart; // SDL_GetTicks at the start of the current phase
+		Uint64 phaseStartMicro;
+		int nextInterval; // ms into the current phase
+		int intervalTicks;
+		Uint64 intervalStart;
+		Uint64 collisionStart;
 		int boxCount;
 		int particleCount;
-		int fpsCount;
-	private:
-		static void timerCallback(void* object);
-		static void secondCallback(void* object);
 };
 
 
 #endif // BENCHMARK_H
-
@@ -26,10 +26,12 @@
 
 #include "Level.h"
 
+const KeywordTable CameraTrigger::stringToProp = KeywordTable(&BaseTrigger::stringToProp)
+	.add("destination",cpDestination)
+	.add("time",cpTime);
+
 CameraTrigger::CameraTrigger(Level* newParent) : BaseTrigger(newParent)
 {
-	stringToProp["destination"] = cpDestination;
-	stringToProp["time"] = cpTime;
 	time = 1000;
 	dest = Vector2df(0,0);
 	triggerCol = PURPLE;
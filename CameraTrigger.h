@@ -51,6 +51,8 @@ protected:
 		cpTime,
 		tpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 private:
 
 };
@@ -31,6 +31,7 @@
 #include "FileLister.h"
 
 #include "Savegame.h"
+#include "AssetPack.h"
 #include "fileTypeDefines.h"
 #include "gameDefines.h"
 
@@ -73,11 +74,12 @@ bool Chapter::loadFromFile(CRstring filename)
 	printf("Trying to open chapter file \"%s\"\n",filename.c_str());
 
 	string line;
-	ifstream file(filename.c_str());
+	istream* file = ASSET_PACK->openStream(filename);
 	int lineNumber = 0; // for error output
 
-	if (file.fail())
+	if (file->fail())
 	{
+		delete file;
 		errorString = "Failed to open file for read!";
 		return false;
 	}
@@ -86,7 +88,7 @@ bool Chapter::loadFromFile(CRstring filename)
 	path = filename.substr(0,filename.find_last_of('/')+1);
 
 	// parse file line by line
-	while (getline(file,line))
+	while (getline(*file,line))
 	{
 		++lineNumber;
 
@@ -111,20 +113,22 @@ bool Chapter::loadFromFile(CRstring filename)
 		}
 	}
 
-	if (file.is_open())
-		file.close();
+	delete file;
 
 	// Check whether levels have to be "auto detected"
 	if (autoDetect)
 	{
-		FileLister levelLister;
-		levelLister.addFilter("txt");
-		levelLister.setPath(path);
-
 		vector<string> files;
-		files = levelLister.getListing();
-		// delete first element which is the current folder
-		files.erase(files.begin());
+		if (not ASSET_PACK->getListing(path,"txt",files)) // not packed
+		{
+			FileLister levelLister;
+			levelLister.addFilter("txt");
+			levelLister.setPath(path);
+
+			files = levelLister.getListing();
+			// delete first element which is the current folder
+			files.erase(files.begin());
+		}
 		for (vector<string>::iterator I = files.begin(); I != files.end(); ++I)
 		{
 			// skip info.txt file and files already present
@@ -0,0 +1,107 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "CollisionGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+CollisionGrid::CollisionGrid()
+{
+	cellSize = COLLISION_GRID_CELL_SIZE;
+	cellsX = 0;
+	cellsY = 0;
+}
+
+CollisionGrid::~CollisionGrid()
+{
+	cells.clear();
+	usedCells.clear();
+}
+
+void CollisionGrid::init(const int& width, const int& height, const int& cellSize)
+{
+	this->cellSize = max(cellSize,1);
+	cellsX = max(width / this->cellSize + 1,1);
+	cellsY = max(height / this->cellSize + 1,1);
+	cells.clear();
+	cells.resize(cellsX * cellsY);
+	usedCells.clear();
+}
+
+void CollisionGrid::clear()
+{
+	for (vector<int>::const_iterator I = usedCells.begin(); I != usedCells.end(); ++I)
+		cells[*I].clear();
+	usedCells.clear();
+}
+
+void CollisionGrid::insert(const int& index, const Vector2df& pos, const Vector2df& size)
+{
+	int x1, y1, x2, y2;
+	getCells(pos,size,x1,y1,x2,y2);
+	for (int Y = y1; Y <= y2; ++Y)
+	{
+		for (int X = x1; X <= x2; ++X)
+		{
+			vector<int>& cell = cells[Y * cellsX + X];
+			if (cell.empty())
+				usedCells.push_back(Y * cellsX + X);
+			// the same unit might get inserted twice (wrapping), only store it once per cell
+			if (cell.empty() || cell.back() != index)
+				cell.push_back(index);
+		}
+	}
+}
+
+void CollisionGrid::query(const Vector2df& pos, const Vector2df& size, vector<int>& result, const int& minIndex) const
+{
+	int x1, y1, x2, y2;
+	getCells(pos,size,x1,y1,x2,y2);
+	for (int Y = y1; Y <= y2; ++Y)
+	{
+		for (int X = x1; X <= x2; ++X)
+		{
+			const vector<int>& cell = cells[Y * cellsX + X];
+			for (vector<int>::const_iterator I = cell.begin(); I != cell.end(); ++I)
+			{
+				if ((*I) > minIndex)
+					result.push_back(*I);
+			}
+		}
+	}
+	sort(result.begin(),result.end());
+	result.erase(unique(result.begin(),result.end()),result.end());
+}
+
+/// ---protected----------------------------------------------------------------
+
+void CollisionGrid::getCells(const Vector2df& pos, const Vector2df& size, int& x1, int& y1, int& x2, int& y2) const
+{
+	// clamping keeps overlapping rectangles overlapping, so nothing gets lost here
+	x1 = min(max((int)floor(pos.x / cellSize),0),cellsX - 1);
+	y1 = min(max((int)floor(pos.y / cellSize),0),cellsY - 1);
+	x2 = min(max((int)floor((pos.x + max(size.x,0.0f)) / cellSize),0),cellsX - 1);
+	y2 = min(max((int)floor((pos.y + max(size.y,0.0f)) / cellSize),0),cellsY - 1);
+}
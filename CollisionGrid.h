@@ -0,0 +1,70 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef COLLISIONGRID_H
+#define COLLISIONGRID_H
+
+#include <vector>
+
+#include "Vector2df.h"
+
+/**
+Uniform grid used as broadphase for unit collision checking
+Units are inserted by index with their bounding rectangle, queries return the
+indices of all units sharing at least one cell with the passed rectangle
+Rectangles outside the grid get clamped to the border cells, so wrapped positions
+can simply be inserted as a second rectangle
+**/
+
+#define COLLISION_GRID_CELL_SIZE 64
+
+class CollisionGrid
+{
+public:
+	CollisionGrid();
+	~CollisionGrid();
+
+	// sets the size of the grid (in pixels) and empties all cells
+	void init(const int& width, const int& height, const int& cellSize = COLLISION_GRID_CELL_SIZE);
+	// empties all cells, keeping the allocated memory
+	void clear();
+
+	void insert(const int& index, const Vector2df& pos, const Vector2df& size);
+	// appends the indices of all units sharing a cell with the passed rectangle
+	// to result, skipping indices smaller or equal than minIndex
+	// result will be sorted and free of duplicates
+	void query(const Vector2df& pos, const Vector2df& size, vector<int>& result, const int& minIndex = -1) const;
+
+protected:
+	// returns the cell range covered by the rectangle (inclusive)
+	void getCells(const Vector2df& pos, const Vector2df& size, int& x1, int& y1, int& x2, int& y2) const;
+
+	int cellSize;
+	int cellsX;
+	int cellsY;
+	vector<vector<int> > cells;
+	vector<int> usedCells; // only clear cells which contain something
+};
+
+#endif // COLLISIONGRID_H
@@ -0,0 +1,202 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "CollisionMap.h"
+
+#include <algorithm>
+
+CollisionMap::CollisionMap()
+{
+	width = 0;
+	height = 0;
+	overflow = false;
+	palette.push_back(Colour(0,0,0)); // COLOUR_ID_NONE, never returned as a collision colour
+}
+
+CollisionMap::~CollisionMap()
+{
+	clear();
+}
+
+void CollisionMap::clear()
+{
+	width = 0;
+	height = 0;
+	base.clear();
+	ids.clear();
+	colourToID.clear();
+	palette.resize(1);
+	overflow = false;
+}
+
+void CollisionMap::loadBase(SDL_Surface* const surface)
+{
+	width = surface->w;
+	height = surface->h;
+	base.resize(width * height);
+	SDL_Rect rect = {0,0,width,height};
+	readRect(surface,rect,base);
+	ids = base;
+}
+
+void CollisionMap::reset()
+{
+	ids = base;
+}
+
+Uint8 CollisionMap::registerColour(const Colour& col)
+{
+	map<int,Uint8>::const_iterator iter = colourToID.find(col.getIntColour());
+	if (iter != colourToID.end())
+		return iter->second;
+
+	if (palette.size() >= COLOUR_ID_COUNT)
+	{
+		if (not overflow)
+		{
+			printf("WARNING: Too many colours on collision map, further colours will not collide!\n");
+			overflow = true;
+		}
+		return COLOUR_ID_NONE;
+	}
+
+	Uint8 id = palette.size();
+	palette.push_back(col);
+	colourToID[col.getIntColour()] = id;
+	return id;
+}
+
+Uint8 CollisionMap::getColourID(const Colour& col) const
+{
+	map<int,Uint8>::const_iterator iter = colourToID.find(col.getIntColour());
+	if (iter != colourToID.end())
+		return iter->second;
+	return COLOUR_ID_NONE;
+}
+
+void CollisionMap::clearRect(SDL_Rect rect)
+{
+	if (not clipRect(rect))
+		return;
+
+	for (int Y = rect.y; Y < rect.y + rect.h; ++Y)
+	{
+		int offset = Y * width + rect.x;
+		copy(base.begin() + offset, base.begin() + offset + rect.w, ids.begin() + offset);
+	}
+}
+
+void CollisionMap::fillRect(SDL_Rect rect, const Uint8& id)
+{
+	if (not clipRect(rect))
+		return;
+
+	for (int Y = rect.y; Y < rect.y + rect.h; ++Y)
+	{
+		int offset = Y * width + rect.x;
+		fill(ids.begin() + offset, ids.begin() + offset + rect.w, id);
+	}
+}
+
+void CollisionMap::copyRect(SDL_Surface* const surface, SDL_Rect rect)
+{
+	if (clipRect(rect))
+		readRect(surface,rect,ids);
+}
+
+void CollisionMap::copyBaseRect(SDL_Surface* const surface, SDL_Rect rect)
+{
+	if (clipRect(rect))
+		readRect(surface,rect,base);
+}
+
+/// ---protected----------------------------------------------------------------
+
+bool CollisionMap::clipRect(SDL_Rect& rect) const
+{
+	int x1 = max((int)rect.x,0);
+	int y1 = max((int)rect.y,0);
+	int x2 = min((int)rect.x + rect.w,width);
+	int y2 = min((int)rect.y + rect.h,height);
+	if (x2 <= x1 || y2 <= y1)
+		return false;
+	rect.x = x1;
+	rect.y = y1;
+	rect.w = x2 - x1;
+	rect.h = y2 - y1;
+	return true;
+}
+
+void CollisionMap::readRect(SDL_Surface* const surface, const SDL_Rect& rect, vector<Uint8>& target)
+{
+	if (SDL_MUSTLOCK(surface))
+		SDL_LockSurface(surface);
+
+	const int bpp = surface->format->BytesPerPixel;
+	// levels mostly consist of big areas of the same colour, so cache the last lookup
+	Uint32 lastPixel = 0;
+	Uint8 lastID = COLOUR_ID_NONE;
+	bool cached = false;
+	Uint8 r,g,b;
+
+	for (int Y = rect.y; Y < rect.y + rect.h; ++Y)
+	{
+		Uint8* src = (Uint8*)surface->pixels + Y * surface->pitch + rect.x * bpp;
+		vector<Uint8>::iterator dst = target.begin() + Y * width + rect.x;
+		for (int X = 0; X < rect.w; ++X, src += bpp, ++dst)
+		{
+			Uint32 pixel;
+			switch (bpp)
+			{
+			case 1:
+				pixel = *src;
+				break;
+			case 2:
+				pixel = *(Uint16*)src;
+				break;
+			case 3:
+				if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
+					pixel = src[0] << 16 | src[1] << 8 | src[2];
+				else
+					pixel = src[0] | src[1] << 8 | src[2] << 16;
+				break;
+			default:
+				pixel = *(Uint32*)src;
+				break;
+			}
+
+			if (not cached || pixel != lastPixel)
+			{
+				SDL_GetRGB(pixel,surface->format,&r,&g,&b);
+				lastID = registerColour(Colour(r,g,b));
+				lastPixel = pixel;
+				cached = true;
+			}
+			(*dst) = lastID;
+		}
+	}
+
+	if (SDL_MUSTLOCK(surface))
+		SDL_UnlockSurface(surface);
+}
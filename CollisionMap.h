@@ -0,0 +1,111 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef COLLISIONMAP_H
+#define COLLISIONMAP_H
+
+#include <SDL/SDL.h>
+#include <vector>
+#include <map>
+#include <cstring>
+
+#include "Colour.h"
+
+/**
+Compact copy of the collision surface storing one colour ID per pixel
+The level image is converted once on load (base layer), units keep the working
+layer up to date by clearing and re-drawing only the rectangles they touch
+Physics queries this instead of reading pixels from the SDL surface
+**/
+
+#define COLOUR_ID_NONE 0 // colours which could not be mapped (never collide)
+#define COLOUR_ID_COUNT 256
+
+// one bit per colour ID, so units can test a colour with a single lookup
+struct CollisionMask
+{
+	Uint32 bits[COLOUR_ID_COUNT / 32];
+
+	CollisionMask() {clear();}
+	void clear() {memset(bits,0,sizeof(bits));}
+	inline void set(const Uint8& id) {bits[id >> 5] |= (1u << (id & 31));}
+	inline void reset(const Uint8& id) {bits[id >> 5] &= ~(1u << (id & 31));}
+	inline bool test(const Uint8& id) const {return (bits[id >> 5] & (1u << (id & 31))) != 0;}
+};
+
+class CollisionMap
+{
+public:
+	CollisionMap();
+	~CollisionMap();
+
+	// frees all data including the colour palette
+	void clear();
+
+	// converts the passed surface to colour IDs and stores it as base layer
+	// (usually the collision surface right after the level image was drawn to it)
+	void loadBase(SDL_Surface* const surface);
+	// copies the base layer over the working layer
+	void reset();
+
+	// returns the ID of the passed colour, adding it to the palette if required
+	// returns COLOUR_ID_NONE if the palette is full
+	Uint8 registerColour(const Colour& col);
+	// returns the ID of the passed colour or COLOUR_ID_NONE if it is unknown
+	Uint8 getColourID(const Colour& col) const;
+	const Colour& getColour(const Uint8& id) const {return palette[id];}
+	// number of used IDs including COLOUR_ID_NONE, only grows until clear is called
+	int getPaletteSize() const {return palette.size();}
+
+	// returns the colour ID at the passed position (no bounds checking!)
+	inline Uint8 getID(const int& x, const int& y) const {return ids[y * width + x];}
+	int getWidth() const {return width;}
+	int getHeight() const {return height;}
+
+	/// Dirty rectangle updates of the working layer, rects get clipped to the map
+	// restores the passed rect from the base layer
+	void clearRect(SDL_Rect rect);
+	// fills the passed rect with a single colour ID
+	void fillRect(SDL_Rect rect, const Uint8& id);
+	// reads the passed rect back from the surface
+	void copyRect(SDL_Surface* const surface, SDL_Rect rect);
+	// same as above, but updates the base layer (for permanent changes to the level image)
+	void copyBaseRect(SDL_Surface* const surface, SDL_Rect rect);
+
+protected:
+	// clips the rect to the map, returns false if nothing is left
+	bool clipRect(SDL_Rect& rect) const;
+	void readRect(SDL_Surface* const surface, const SDL_Rect& rect, vector<Uint8>& target);
+
+	int width;
+	int height;
+	vector<Uint8> base;
+	vector<Uint8> ids;
+
+	map<int,Uint8> colourToID;
+	vector<Colour> palette;
+	bool overflow; // palette full warning has been printed
+};
+
+#endif // COLLISIONMAP_H
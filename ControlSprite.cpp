@@ -49,10 +49,6 @@ bool ControlSprite::load(list<PARAMETER_TYPE >& params)
 	}
 	else // clear sprites loaded by BaseUnit
 	{
-		for (map<string,AnimatedSprite*>::iterator I = states.begin(); I != states.end(); ++I)
-		{
-			delete I->second;
-		}
 		states.clear();
 	}
 	SDL_Surface* surf = getSurface(imageOverwrite);
@@ -63,9 +59,9 @@ bool ControlSprite::load(list<PARAMETER_TYPE >& params)
 	#else
 	int initSkip = 0;
 	#endif
-	loadFrames(surf,initSkip++,1,false,"jump");
-	loadFrames(surf,initSkip++,1,false,"swap");
-	loadFrames(surf,initSkip++,1,false,"suicide");
+	loadFrames(surf,initSkip++,1,false,ssJump);
+	loadFrames(surf,initSkip++,1,false,ssSwap);
+	loadFrames(surf,initSkip++,1,false,ssSuicide);
 
 	setSpriteState(startingState,true);
 
@@ -77,13 +73,13 @@ bool ControlSprite::load(list<PARAMETER_TYPE >& params)
 
 ///---private---
 
-AnimatedSprite* ControlSprite::loadFrames(SDL_Surface* const surf, CRint skip, CRint num, CRbool loop, CRstring state)
+AnimatedSprite* ControlSprite::loadFrames(SDL_Surface* const surf, CRint skip, CRint num, CRbool loop, CRint state)
 {
 	AnimatedSprite* temp = new AnimatedSprite;
 	temp->loadFrames(surf,3,2,skip,num);
 	temp->setTransparentColour(MAGENTA);
 	temp->setFrameRate(DECI_SECONDS);
 	temp->setLooping(loop);
-	states[state] = temp;
+	states.set(state,temp);
 	return temp;
 }
@@ -38,7 +38,7 @@ public:
 protected:
 
 private:
-	AnimatedSprite* loadFrames(SDL_Surface* const surf, CRint skip, CRint num, CRbool loop, CRstring state);
+	AnimatedSprite* loadFrames(SDL_Surface* const surf, CRint skip, CRint num, CRbool loop, CRint state);
 
 };
 
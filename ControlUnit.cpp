@@ -24,12 +24,14 @@
 
 #include "ControlUnit.h"
 
+const KeywordTable ControlUnit::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("control",cpControl);
+
 ControlUnit::ControlUnit(Level* newParent) : BaseUnit(newParent)
 {
 	takesControl = true;
 	isPlayer = true;
-
-	stringToProp["control"] = cpControl;
+	body->simulated = false; // players get their physics applied by Level separately
 }
 
 ControlUnit::~ControlUnit()
@@ -52,6 +52,8 @@ protected:
 		cpControl=BaseUnit::upEOL,
 		cpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 };
 
 #endif
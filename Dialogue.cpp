@@ -32,6 +32,7 @@
 #include "fileTypeDefines.h"
 #include "BaseUnit.h"
 #include "Savegame.h"
+#include "AssetPack.h"
 
 #define DIALOGUE_HEIGHT 90
 #define DIALOGUE_SPACING 10
@@ -72,12 +73,13 @@ bool Dialogue::loadFromFile(CRstring filename)
 	printf("Trying to load strings file \"%s\"\n",filename.c_str());
 
 	string line;
-	ifstream file(filename.c_str());
+	istream* file = ASSET_PACK->openStream(filename);
 	int lineNumber = 0; // for error output
 	errorString = "";
 
-	if (file.fail())
+	if (file->fail())
 	{
+		delete file;
 		errorString = "Failed to open file for read!";
 		return false;
 	}
@@ -85,7 +87,7 @@ bool Dialogue::loadFromFile(CRstring filename)
 	clear();
 
 	// parse file line by line
-	while (getline(file,line))
+	while (getline(*file,line))
 	{
 		++lineNumber;
 
@@ -110,6 +112,8 @@ bool Dialogue::loadFromFile(CRstring filename)
 		}
 	}
 
+	delete file;
+
 	printf("Successfully loaded %i strings!\n",lines.size());
 	return true;
 }
@@ -148,6 +152,17 @@ void Dialogue::render()
 	}
 }
 
+bool Dialogue::getRect(SDL_Rect& rect) const
+{
+	if (queue.empty())
+		return false;
+	rect.x = 0;
+	rect.y = GFX::getYResolution() - DIALOGUE_HEIGHT;
+	rect.w = GFX::getXResolution();
+	rect.h = DIALOGUE_HEIGHT;
+	return true;
+}
+
 string Dialogue::getLine(CRstring key) const
 {
 	map<string,string>::const_iterator line = lines.find(key);
@@ -51,6 +51,8 @@ public:
 
 	void update();
 	void render();
+	// screen area of the currently shown line, returns false if none is shown
+	bool getRect(SDL_Rect& rect) const;
 
 	string getLine(CRstring key) const;
 	void queueLine(CRstring key, const BaseUnit* const unit, CRint time);
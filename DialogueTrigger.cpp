@@ -26,10 +26,12 @@
 
 #include "Dialogue.h"
 
+const KeywordTable DialogueTrigger::stringToProp = KeywordTable(&BaseTrigger::stringToProp)
+	.add("textkey",tpTextKey)
+	.add("time",tpTime);
+
 DialogueTrigger::DialogueTrigger(Level* newParent) : BaseTrigger(newParent)
 {
-	stringToProp["textkey"] = tpTextKey;
-	stringToProp["time"] = tpTime;
 	textKey = "";
 	time = 1000;
 	triggerCol = LIGHT_RED;
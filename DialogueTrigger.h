@@ -47,6 +47,8 @@ protected:
 		tpTime,
 		tpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 private:
 
 };
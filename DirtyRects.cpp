@@ -0,0 +1,125 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "DirtyRects.h"
+
+#include "GFX.h"
+
+DirtyRects* DirtyRects::self = NULL;
+
+DirtyRects::DirtyRects()
+{
+	restoreCached = false;
+	partial = false;
+	valid = false;
+	levelFrame = false;
+}
+
+DirtyRects::~DirtyRects()
+{
+	//
+}
+
+DirtyRects* DirtyRects::GetSingleton()
+{
+	if (not self)
+		self = new DirtyRects();
+	return self;
+}
+
+void DirtyRects::addBackground(SDL_Rect rect)
+{
+	if (clip(rect))
+	{
+		background.push_back(rect);
+		restoreCached = false;
+	}
+}
+
+void DirtyRects::addOverlay(SDL_Rect rect)
+{
+	if (clip(rect))
+		overlay.push_back(rect);
+}
+
+const vector<SDL_Rect>& DirtyRects::getRestoreRects()
+{
+	if (not restoreCached)
+	{
+		restore.clear();
+		restore.insert(restore.end(),background.begin(),background.end());
+		restore.insert(restore.end(),lastBackground.begin(),lastBackground.end());
+		restore.insert(restore.end(),lastOverlay.begin(),lastOverlay.end());
+		restoreCached = true;
+	}
+	return restore;
+}
+
+int DirtyRects::getRestoreArea()
+{
+	int result = 0;
+	const vector<SDL_Rect>& rects = getRestoreRects();
+	for (vector<SDL_Rect>::const_iterator I = rects.begin(); I != rects.end(); ++I)
+		result += I->w * I->h;
+	return result;
+}
+
+void DirtyRects::flip(SDL_Surface* const screen)
+{
+	if (partial && valid)
+	{
+		vector<SDL_Rect> rects = getRestoreRects();
+		rects.insert(rects.end(),overlay.begin(),overlay.end());
+		if (not rects.empty())
+			SDL_UpdateRects(screen,rects.size(),&rects[0]);
+	}
+	else
+		GFX::forceBlit();
+
+	lastBackground.swap(background);
+	lastOverlay.swap(overlay);
+	background.clear();
+	overlay.clear();
+	restoreCached = false;
+	partial = false;
+	valid = levelFrame;
+	levelFrame = false;
+}
+
+/// ---private------------------------------------------------------------------
+
+bool DirtyRects::clip(SDL_Rect& rect) const
+{
+	int x1 = max((int)rect.x,0);
+	int y1 = max((int)rect.y,0);
+	int x2 = min((int)rect.x + rect.w,(int)GFX::getXResolution());
+	int y2 = min((int)rect.y + rect.h,(int)GFX::getYResolution());
+	if (x2 <= x1 || y2 <= y1)
+		return false;
+	rect.x = x1;
+	rect.y = y1;
+	rect.w = x2 - x1;
+	rect.h = y2 - y1;
+	return true;
+}
@@ -0,0 +1,94 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef DIRTYRECTS_H
+#define DIRTYRECTS_H
+
+#include <SDL/SDL.h>
+#include <vector>
+
+#include "PenjinTypes.h"
+
+#define DIRTY_RECTS DirtyRects::GetSingleton()
+
+/**
+Tracks the screen regions changed since the last frame, so a static screen only
+needs to update those instead of blitting and flipping everything
+Background rects are parts of the level image which may have changed (units),
+overlay rects are things drawn on top of that (particles, links, cursor, etc.)
+A region needs to be restored from the background if it changed this or the last
+frame or had an overlay drawn on it last frame
+All rects in screen coordinates
+**/
+
+class DirtyRects
+{
+private:
+	DirtyRects();
+	static DirtyRects* self;
+public:
+	~DirtyRects();
+	static DirtyRects* GetSingleton();
+
+	void addBackground(SDL_Rect rect);
+	void addOverlay(SDL_Rect rect);
+
+	// returns the rects which need to be restored from the background this frame
+	// (only valid after all background rects have been added)
+	const vector<SDL_Rect>& getRestoreRects();
+	// total area of the restore rects in pixels (overlap counted twice)
+	int getRestoreArea();
+
+	// partial updates are only possible if the screen still contains the
+	// previous frame drawn by the level
+	bool isValid() const {return valid;}
+	// call when drawing something to the screen without adding a rect for it
+	// or when the level changes
+	void invalidate() {valid = false; levelFrame = false;}
+	// call when the level has finished drawing the current frame
+	void setLevelFrame() {levelFrame = true;}
+
+	bool isPartial() const {return partial;}
+	void setPartial(CRbool value) {partial = value;}
+
+	// updates the screen (only the dirty regions if partial is set, else all)
+	// and starts a new frame
+	void flip(SDL_Surface* const screen);
+
+private:
+	// clips the rect to the screen, returns false if nothing is left
+	bool clip(SDL_Rect& rect) const;
+
+	vector<SDL_Rect> background;
+	vector<SDL_Rect> overlay;
+	vector<SDL_Rect> lastBackground;
+	vector<SDL_Rect> lastOverlay;
+	vector<SDL_Rect> restore;
+	bool restoreCached;
+	bool partial;
+	bool valid;
+	bool levelFrame;
+};
+
+#endif // DIRTYRECTS_H
@@ -27,10 +27,11 @@
 #include "Level.h"
 #include "ControlUnit.h"
 
+const KeywordTable Exit::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("link",epLink);
+
 Exit::Exit(Level* newParent) : BaseUnit(newParent)
 {
-	stringToProp["link"] = epLink;
-
 	flags.addFlag(ufNoMapCollision);
 	flags.addFlag(ufNoGravity);
 	unitCollisionMode = 0;
@@ -65,29 +66,25 @@ bool Exit::load(list<PARAMETER_TYPE >& params)
 	}
 	else // clear sprites loaded by BaseUnit
 	{
-		for (map<string,AnimatedSprite*>::iterator I = states.begin(); I != states.end(); ++I)
-		{
-			delete I->second;
-		}
 		states.clear();
 	}
 	AnimatedSprite* temp = new AnimatedSprite;
 	temp->loadFrames(getSurface(imageOverwrite),3,1,0,1);
 	temp->setTransparentColour(MAGENTA);
-	states["open"] = temp;
+	states.set(ssOpen,temp);
 	temp = new AnimatedSprite;
 	temp->loadFrames(getSurface(imageOverwrite),3,1,1,1);
 	temp->setTransparentColour(MAGENTA);
-	states["closed"] = temp;
+	states.set(ssClosed,temp);
 	temp = new AnimatedSprite;
 	temp->loadFrames(getSurface(imageOverwrite),3,1,2,1);
 	temp->setTransparentColour(MAGENTA);
-	states["linked"] = temp;
+	states.set(ssLinked,temp);
 
-	if (startingState[0] == 0 && !targetIDs.empty())
-		startingState = "linked";
-	if (startingState[0] == 0 || startingState == "default")
-		startingState = "open";
+	if (startingState == STATE_NONE && !targetIDs.empty())
+		startingState = ssLinked;
+	if (startingState == STATE_NONE || startingState == ssDefault)
+		startingState = ssOpen;
 	setSpriteState(startingState,true);
 
 	return result;
@@ -124,7 +121,7 @@ void Exit::reset()
 
 void Exit::hitUnit(const UnitCollisionEntry& entry)
 {
-	if (currentState != "closed") // open or linked
+	if (currentState != ssClosed) // open or linked
 	{
 		// standing still on the ground
 		if (entry.unit->isPlayer && (int)entry.unit->velocity.x == 0 &&
@@ -189,9 +186,9 @@ void Exit::update()
 	if (lastKeys != keys.size())
 	{
 		if (!keys.empty())
-			setSpriteState("closed");
+			setSpriteState(ssClosed);
 		else if (targetIDs.empty())
-			setSpriteState("open");
+			setSpriteState(ssOpen);
 		lastKeys = keys.size();
 	}
 
@@ -50,6 +50,8 @@ protected:
 		epLink=BaseUnit::upEOL,
 		epEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 
 	bool checkAllExited() const;
 
@@ -42,10 +42,10 @@ bool ExitTrigger::load(list<PARAMETER_TYPE >& params)
 {
 	bool result = BaseTrigger::load(params);
 
-	states["open"] = NULL;
-	states["closed"] = NULL;
-	if (startingState[0] == 0 || startingState == "default")
-		startingState = "open";
+	states.set(ssOpen,NULL);
+	states.set(ssClosed,NULL);
+	if (startingState == STATE_NONE || startingState == ssDefault)
+		startingState = ssOpen;
 	setSpriteState(startingState);
 
 	return result;
@@ -55,7 +55,7 @@ bool ExitTrigger::load(list<PARAMETER_TYPE >& params)
 
 void ExitTrigger::doTrigger(const UnitCollisionEntry& entry)
 {
-	if (currentState == "open")
+	if (currentState == ssOpen)
 	{
 		entry.unit->toBeRemoved = true;
 		if (entry.unit->isPlayer)
@@ -26,6 +26,12 @@
 
 #include "ControlUnit.h"
 #include "Level.h"
+#include "CollisionMap.h"
+
+const KeywordTable FadingBox::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("farcolour",fpFarColour)
+	.add("faderadius",fpFadeRadius)
+	.add("fadesteps",fpFadeSteps);
 
 FadingBox::FadingBox(Level* newParent) : PushableBox(newParent)
 {
@@ -34,10 +40,6 @@ FadingBox::FadingBox(Level* newParent) : PushableBox(newParent)
 	flags.addFlag(ufInvincible);
 	unitCollisionMode = 0;
 
-	stringToProp["farcolour"] = fpFarColour;
-	stringToProp["faderadius"] = fpFadeRadius;
-	stringToProp["fadesteps"] = fpFadeSteps;
-
 	colours.first = WHITE;
 	colours.second = BLACK;
 	fadeRadius = Vector2df(32,96);
@@ -139,6 +141,17 @@ void FadingBox::update()
 	}
 }
 
+void FadingBox::renderCollision(CollisionMap* const map, SDL_Surface* const surf)
+{
+	// don't register the in-between colours of the fade, the box keeps the ID of
+	// its base colour until it reaches a colour units are checking against
+	Uint8 id = map->getColourID(col);
+	if (id == COLOUR_ID_NONE)
+		id = map->getColourID(colours.first);
+	SDL_Rect temp = {position.x,position.y,rect.w,rect.h};
+	map->fillRect(temp,id);
+}
+
 void FadingBox::hitUnit(const UnitCollisionEntry& entry)
 {
 	//
@@ -36,6 +36,7 @@ public:
 	virtual bool processParameter(const PARAMETER_TYPE& value);
 
 	virtual void update();
+	virtual void renderCollision(CollisionMap* const map, SDL_Surface* const surf);
 
 	virtual void hitUnit(const UnitCollisionEntry& entry);
 	virtual bool checkCollisionColour(const Colour& col) const;
@@ -59,6 +60,8 @@ protected:
 		fpFadeSteps,
 		fpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 
 private:
 
@@ -24,13 +24,15 @@
 
 #include "Gear.h"
 
-Gear::Gear(Level* newParent) : BaseUnit(newParent)
-{
-	stringToProp["speed"] = gpSpeed;
-	stringToProp["rotation"] = gpRotation;
+const KeywordTable Gear::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("speed",gpSpeed)
+	.add("rotation",gpRotation);
 
-	stringToOrder["rotation"] = goRotation;
+const KeywordTable Gear::stringToOrder = KeywordTable(&BaseUnit::stringToOrder)
+	.add("rotation",goRotation);
 
+Gear::Gear(Level* newParent) : BaseUnit(newParent)
+{
 	speed = 0;
 	angle = 0;
 	screenPosition = Vector2df(0,0);
@@ -59,10 +61,6 @@ bool Gear::load(list<PARAMETER_TYPE >& params)
 	}
 	else // clear sprites loaded by BaseUnit
 	{
-		for (map<string,AnimatedSprite*>::iterator I = states.begin(); I != states.end(); ++I)
-		{
-			delete I->second;
-		}
 		states.clear();
 	}
 	img.loadImage(getSurface(imageOverwrite));
@@ -51,11 +51,15 @@ protected:
 		gpRotation,
 		gpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 	enum GearOder
 	{
 		goRotation=BaseUnit::okEOL,
 		goEOL
 	};
+	static const KeywordTable stringToOrder;
+	virtual const KeywordTable& getOrderKeys() const {return stringToOrder;}
 
 	float speed;
 	float angle;
@@ -25,6 +25,12 @@
 #include "GreySurfaceCache.h"
 
 #include <iostream>
+#include <SDL/SDL_image.h>
+
+#include "AssetPack.h"
+#ifdef _DEBUG
+#include "StringUtility.h"
+#endif
 
 GreySurfaceCache::GreySurfaceCache() : SurfaceCache()
 {
@@ -33,11 +39,21 @@ GreySurfaceCache::GreySurfaceCache() : SurfaceCache()
 	#else
 	superVerbose = false;
 	#endif
+	mutex = SDL_CreateMutex();
+	useCounter = 0;
+	budget = SURFACE_CACHE_BUDGET * 1024 * 1024;
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+	stats.surfaces = 0;
+	stats.referenced = 0;
+	stats.bytes = 0;
 }
 
 GreySurfaceCache::~GreySurfaceCache()
 {
-	//
+	clear();
+	SDL_DestroyMutex(mutex);
 }
 
 SDL_Surface* GreySurfaceCache::loadSurface(CRstring filename, CRstring pathOverwrite, CRbool optimize)
@@ -48,11 +64,8 @@ SDL_Surface* GreySurfaceCache::loadSurface(CRstring filename, CRstring pathOverw
 	if (superVerbose)
 		printf("Trying to load custom image \"%s%s\"\n",pathOverwrite.c_str(),filename.c_str());
 
-	verbose = false;
-	SDL_Surface* surface = loadSurface(pathOverwrite + filename, optimize);
-	verbose = true;
-
-	if (surface == errorSurface || surface == NULL)
+	SDL_Surface* surface = acquireSurface(pathOverwrite + filename,optimize,false);
+	if (not surface)
 	{
 		if (superVerbose)
 			printf("Custom image not found, loading default!\n");
@@ -61,3 +74,239 @@ SDL_Surface* GreySurfaceCache::loadSurface(CRstring filename, CRstring pathOverw
 
 	return surface;
 }
+
+SDL_Surface* GreySurfaceCache::loadSurface(CRstring filename, CRbool optimize)
+{
+	SDL_Surface* surface = acquireSurface(filename,optimize,true);
+	return surface ? surface : errorSurface;
+}
+
+void GreySurfaceCache::releaseSurface(SDL_Surface* const surface)
+{
+	SDL_mutexP(mutex);
+	for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+	{
+		if (I->second.surface == surface)
+		{
+			if (I->second.references > 0 && --I->second.references == 0)
+			{
+				--stats.referenced;
+				evict();
+			}
+			break;
+		}
+	}
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::releaseAll()
+{
+	SDL_mutexP(mutex);
+	for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+		I->second.references = 0;
+	stats.referenced = 0;
+	evict();
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::pinSurface(SDL_Surface* const surface)
+{
+	SDL_mutexP(mutex);
+	for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+	{
+		if (I->second.surface == surface)
+		{
+			++I->second.pins;
+			break;
+		}
+	}
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::unpinSurface(SDL_Surface* const surface)
+{
+	SDL_mutexP(mutex);
+	for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+	{
+		if (I->second.surface == surface)
+		{
+			if (I->second.pins > 0 && --I->second.pins == 0)
+				evict();
+			break;
+		}
+	}
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::removeSurface(CRstring filename, CRbool freeSurface)
+{
+	SDL_mutexP(mutex);
+	map<string,CacheEntry>::iterator cached = entries.find(filename);
+	if (cached != entries.end())
+	{
+		if (freeSurface)
+			SDL_FreeSurface(cached->second.surface);
+		--stats.surfaces;
+		if (cached->second.references > 0)
+			--stats.referenced;
+		stats.bytes -= cached->second.bytes;
+		entries.erase(cached);
+	}
+	else
+		SurfaceCache::removeSurface(filename,freeSurface);
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::removeSurface(SDL_Surface* const surface)
+{
+	SDL_mutexP(mutex);
+	for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+	{
+		if (I->second.surface == surface)
+		{
+			string filename = I->first;
+			removeSurface(filename,true);
+			break;
+		}
+	}
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::clear()
+{
+	SDL_mutexP(mutex);
+	for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+		SDL_FreeSurface(I->second.surface);
+	entries.clear();
+	stats.surfaces = 0;
+	stats.referenced = 0;
+	stats.bytes = 0;
+	SurfaceCache::clear(); // images loaded by Penjin itself
+	SDL_mutexV(mutex);
+}
+
+void GreySurfaceCache::setBudget(const size_t& bytes)
+{
+	SDL_mutexP(mutex);
+	budget = bytes;
+	evict();
+	SDL_mutexV(mutex);
+}
+
+GreySurfaceCache::Stats GreySurfaceCache::getStats() const
+{
+	SDL_mutexP(mutex);
+	Stats result = stats;
+	SDL_mutexV(mutex);
+	return result;
+}
+
+#ifdef _DEBUG
+string GreySurfaceCache::debugInfo() const
+{
+	Stats temp = getStats();
+	string result = "Images: " + StringUtility::intToString(temp.referenced) + "/" + StringUtility::intToString(temp.surfaces) +
+			" (" + StringUtility::intToString(temp.bytes / 1024) + "/" + StringUtility::intToString(budget / 1024) + " KiB)\n";
+	result += "Cache: " + StringUtility::intToString(temp.hits) + " hits | " + StringUtility::intToString(temp.misses) +
+			" misses | " + StringUtility::intToString(temp.evictions) + " evicted\n";
+	return result;
+}
+#endif
+
+///---protected---
+
+SDL_Surface* GreySurfaceCache::acquireSurface(CRstring filename, CRbool optimize, CRbool report)
+{
+	SDL_mutexP(mutex);
+	map<string,CacheEntry>::iterator cached = entries.find(filename);
+	if (cached != entries.end())
+	{
+		++stats.hits;
+		if (cached->second.references++ == 0)
+			++stats.referenced;
+		cached->second.lastUse = ++useCounter;
+		SDL_Surface* surface = cached->second.surface;
+		SDL_mutexV(mutex);
+		return surface;
+	}
+	++stats.misses;
+	SDL_mutexV(mutex);
+
+	// decode without holding the lock, so other threads can use cached images
+	// in the meantime
+	SDL_Surface* surface = decodeSurface(filename,optimize,report);
+	if (not surface)
+		return NULL;
+
+	SDL_mutexP(mutex);
+	cached = entries.find(filename);
+	if (cached != entries.end()) // another thread decoded the same image meanwhile
+	{
+		SDL_FreeSurface(surface);
+		if (cached->second.references++ == 0)
+			++stats.referenced;
+		cached->second.lastUse = ++useCounter;
+		surface = cached->second.surface;
+	}
+	else
+	{
+		CacheEntry entry = {surface,1,0,++useCounter,(size_t)surface->pitch * surface->h};
+		entries[filename] = entry;
+		++stats.surfaces;
+		++stats.referenced;
+		stats.bytes += entry.bytes;
+		evict();
+	}
+	SDL_mutexV(mutex);
+	return surface;
+}
+
+SDL_Surface* GreySurfaceCache::decodeSurface(CRstring filename, CRbool optimize, CRbool report)
+{
+	// decode straight from the mapped pack if possible
+	SDL_RWops* data = ASSET_PACK->openRW(filename);
+	if (not data)
+		data = SDL_RWFromFile(filename.c_str(),"rb");
+	SDL_Surface* surface = NULL;
+	if (data)
+		surface = IMG_Load_RW(data,1);
+	if (not surface)
+	{
+		if (verbose && report)
+			printf("ERROR loading image \"%s\": %s\n",filename.c_str(),IMG_GetError());
+		return NULL;
+	}
+	if (optimize)
+	{
+		SDL_Surface* temp = surface->format->Amask ? SDL_DisplayFormatAlpha(surface) : SDL_DisplayFormat(surface);
+		if (temp)
+		{
+			SDL_FreeSurface(surface);
+			surface = temp;
+		}
+	}
+	return surface;
+}
+
+void GreySurfaceCache::evict()
+{
+	while (stats.bytes > budget)
+	{
+		map<string,CacheEntry>::iterator oldest = entries.end();
+		for (map<string,CacheEntry>::iterator I = entries.begin(); I != entries.end(); ++I)
+		{
+			if (I->second.references == 0 && I->second.pins == 0 && (oldest == entries.end() || I->second.lastUse < oldest->second.lastUse))
+				oldest = I;
+		}
+		if (oldest == entries.end()) // everything left is in use
+			break;
+
+		if (superVerbose)
+			printf("Freeing cached image \"%s\"\n",oldest->first.c_str());
+		SDL_FreeSurface(oldest->second.surface);
+		stats.bytes -= oldest->second.bytes;
+		--stats.surfaces;
+		++stats.evictions;
+		entries.erase(oldest);
+	}
+}
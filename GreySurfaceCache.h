@@ -25,6 +25,9 @@
 #ifndef GREY_SURFACE_CACHE_H
 #define GREY_SURFACE_CACHE_H
 
+#include <map>
+#include <SDL/SDL_mutex.h>
+
 #include "PenjinTypes.h"
 #include "SurfaceCache.h"
 
@@ -32,6 +35,13 @@
 All image loading is done through this cache
 This helps to center error output and also ensures no graphic is loaded twice,
 but rather shared between objects through the SDL_Surface pointer
+Images are decoded from a mounted asset pack if found there, from disk otherwise
+Every loadSurface call adds a reference which can be given back by calling
+releaseSurface (or releaseAll on state changes), images without references
+stay decoded for later use until the memory budget is exceeded, then the least
+recently used ones get freed first
+Loading and removing images is thread-safe (the level select loads previews in
+worker threads)
 **/
 
 #ifdef SURFACE_CACHE
@@ -39,6 +49,9 @@ but rather shared between objects through the SDL_Surface pointer
 #endif
 #define SURFACE_CACHE ((GreySurfaceCache*)SurfaceCache::getSurfaceCache())
 
+// default memory budget in MiB, see setBudget
+#define SURFACE_CACHE_BUDGET 32
+
 class GreySurfaceCache : public SurfaceCache
 {
 	protected:
@@ -48,12 +61,70 @@ class GreySurfaceCache : public SurfaceCache
 
 		SDL_Surface* loadSurface(CRstring filename, CRstring pathOverwrite, CRbool optimize = false);
 
-		SDL_Surface* loadSurface(CRstring filename, CRbool optimize = false) {return SurfaceCache::loadSurface(filename,optimize);}
+		SDL_Surface* loadSurface(CRstring filename, CRbool optimize = false);
+
+		// drops one reference to the surface, which might then be freed
+		// to stay in budget, so do not use it afterwards
+		void releaseSurface(SDL_Surface* const surface);
+		// drops all references (to be called after deleting a state)
+		void releaseAll();
+		// keeps the surface from being evicted without holding a reference (so
+		// releaseAll does not drop it), used for images loaded ahead of time
+		void pinSurface(SDL_Surface* const surface);
+		void unpinSurface(SDL_Surface* const surface);
+
+		// removes the surface from the cache, if freeSurface is false the
+		// caller takes ownership of it
+		void removeSurface(CRstring filename, CRbool freeSurface);
+		// removes and frees the surface (e.g. after drawing on it)
+		void removeSurface(SDL_Surface* const surface);
+		void clear();
+
+		// maximum number of bytes of unreferenced surfaces to keep
+		// referenced surfaces are never freed, so this can be exceeded
+		void setBudget(const size_t& bytes);
+		size_t getBudget() const {return budget;}
+
+		struct Stats
+		{
+			int hits;
+			int misses;
+			int evictions;
+			int surfaces;
+			int referenced; // surfaces with at least one reference
+			size_t bytes; // pixel memory of all cached surfaces
+		};
+		Stats getStats() const;
+		#ifdef _DEBUG
+		string debugInfo() const;
+		#endif
 
 	protected:
+		struct CacheEntry
+		{
+			SDL_Surface* surface;
+			int references;
+			int pins; // see pinSurface
+			Uint32 lastUse; // value of useCounter on last load
+			size_t bytes;
+		};
+
+		// returns the cached image adding a reference or decodes and caches it,
+		// NULL on error (errors are only printed if report is true)
+		SDL_Surface* acquireSurface(CRstring filename, CRbool optimize, CRbool report);
+		// decodes an image from an asset pack or from disk, NULL on error
+		SDL_Surface* decodeSurface(CRstring filename, CRbool optimize, CRbool report);
+		// frees least recently used surfaces without references until in budget
+		void evict();
+
 		bool superVerbose;
+		SDL_mutex* mutex; // recursive, guards all members, not held while decoding
+
+		map<string,CacheEntry> entries;
+		Uint32 useCounter;
+		size_t budget;
+		Stats stats;
 };
 
 
 #endif // GREY_SURFACE_CACHE_H
-
@@ -0,0 +1,402 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "InputReplay.h"
+
+#include <fstream>
+#include <string.h>
+
+#define REPLAY_MAGIC "GRPL"
+#define REPLAY_VERSION 2
+#define REPLAY_END 0xFFFFFFFF
+
+InputReplay* InputReplay::active = NULL;
+
+static void writeUint32(vector<char>& buffer, const Uint32& value)
+{
+	buffer.push_back(value & 0xFF);
+	buffer.push_back((value >> 8) & 0xFF);
+	buffer.push_back((value >> 16) & 0xFF);
+	buffer.push_back((value >> 24) & 0xFF);
+}
+
+static void writeUint16(vector<char>& buffer, const Uint16& value)
+{
+	buffer.push_back(value & 0xFF);
+	buffer.push_back((value >> 8) & 0xFF);
+}
+
+static void writeString(vector<char>& buffer, CRstring value)
+{
+	writeUint32(buffer,value.length());
+	buffer.insert(buffer.end(),value.begin(),value.end());
+}
+
+static bool readUint32(const vector<char>& buffer, size_t& pos, Uint32& value)
+{
+	if (pos + 4 > buffer.size())
+		return false;
+	const unsigned char* bytes = (const unsigned char*)&buffer[pos];
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+	pos += 4;
+	return true;
+}
+
+static bool readUint16(const vector<char>& buffer, size_t& pos, Uint16& value)
+{
+	if (pos + 2 > buffer.size())
+		return false;
+	const unsigned char* bytes = (const unsigned char*)&buffer[pos];
+	value = bytes[0] | (bytes[1] << 8);
+	pos += 2;
+	return true;
+}
+
+static bool readUint8(const vector<char>& buffer, size_t& pos, Uint8& value)
+{
+	if (pos + 1 > buffer.size())
+		return false;
+	value = buffer[pos++];
+	return true;
+}
+
+static bool readString(const vector<char>& buffer, size_t& pos, string& value)
+{
+	Uint32 length;
+	if (not readUint32(buffer,pos,length) || pos + length > buffer.size())
+		return false;
+	value.assign(&buffer[0] + pos,length);
+	pos += length;
+	return true;
+}
+
+InputReplay::InputReplay()
+{
+	recording = false;
+	playing = false;
+	seed = 0;
+	timeTrial = false;
+	tickCount = 0;
+	totalTicks = 0;
+	nextTick = 0;
+}
+
+InputReplay::~InputReplay()
+{
+	stop();
+}
+
+///---public---
+
+bool InputReplay::startRecording(CRstring filename, CRstring levelFile, CRstring chapterPath, CRuint seed, CRbool timeTrial)
+{
+	stop();
+	this->filename = filename;
+	this->levelFile = levelFile;
+	this->chapterPath = chapterPath;
+	this->seed = seed;
+	this->timeTrial = timeTrial;
+	ticks.clear();
+	current.clear();
+	tickCount = 0;
+
+	recording = true;
+	active = this;
+	SDL_SetEventFilter(InputReplay::filterEvent);
+	printf("Recording input of \"%s\" (seed %u) to \"%s\"\n",levelFile.c_str(),seed,filename.c_str());
+	return true;
+}
+
+bool InputReplay::startPlayback(CRstring filename)
+{
+	stop();
+
+	ifstream file(filename.c_str(),ios::in | ios::binary);
+	if (file.fail())
+	{
+		printf("ERROR: Could not open replay \"%s\"\n",filename.c_str());
+		return false;
+	}
+	vector<char> buffer((istreambuf_iterator<char>(file)),istreambuf_iterator<char>());
+	file.close();
+
+	size_t pos = 4;
+	Uint32 version, value;
+	Uint8 flag;
+	if (buffer.size() < 4 || memcmp(&buffer[0],REPLAY_MAGIC,4) != 0 || not readUint32(buffer,pos,version) ||
+			version != REPLAY_VERSION || not readUint32(buffer,pos,value) || not readString(buffer,pos,levelFile) ||
+			not readString(buffer,pos,chapterPath) || not readUint8(buffer,pos,flag))
+	{
+		printf("ERROR: \"%s\" is not a valid replay file\n",filename.c_str());
+		return false;
+	}
+	seed = value;
+	timeTrial = flag;
+
+	ticks.clear();
+	while (true)
+	{
+		Tick tick;
+		Uint32 count;
+		if (not readUint32(buffer,pos,tick.number))
+			break;
+		if (tick.number == REPLAY_END)
+		{
+			if (not readUint32(buffer,pos,totalTicks))
+				break;
+			this->filename = filename;
+			tickCount = 0;
+			nextTick = 0;
+			playing = true;
+			active = this;
+			SDL_SetEventFilter(InputReplay::filterEvent);
+			printf("Playing replay \"%s\" of \"%s\" (%u ticks, seed %u)\n",filename.c_str(),levelFile.c_str(),totalTicks,seed);
+			return true;
+		}
+		// every event takes at least its type byte
+		if (not readUint32(buffer,pos,count) || count > buffer.size() - pos)
+			break;
+		tick.events.resize(count);
+		bool valid = true;
+		for (Uint32 I = 0; I < count && valid; ++I)
+			valid = readEvent(buffer,pos,tick.events[I]);
+		if (not valid)
+			break;
+		ticks.push_back(tick);
+	}
+
+	printf("ERROR: Replay \"%s\" is broken\n",filename.c_str());
+	ticks.clear();
+	return false;
+}
+
+void InputReplay::stop()
+{
+	if (recording)
+	{
+		vector<char> buffer(REPLAY_MAGIC,REPLAY_MAGIC + 4);
+		writeUint32(buffer,REPLAY_VERSION);
+		writeUint32(buffer,seed);
+		writeString(buffer,levelFile);
+		writeString(buffer,chapterPath);
+		buffer.push_back(timeTrial ? 1 : 0);
+		for (vector<Tick>::const_iterator tick = ticks.begin(); tick != ticks.end(); ++tick)
+		{
+			writeUint32(buffer,tick->number);
+			writeUint32(buffer,tick->events.size());
+			for (vector<SDL_Event>::const_iterator event = tick->events.begin(); event != tick->events.end(); ++event)
+				writeEvent(buffer,*event);
+		}
+		writeUint32(buffer,REPLAY_END);
+		writeUint32(buffer,tickCount);
+
+		ofstream file(filename.c_str(),ios::out | ios::binary | ios::trunc);
+		if (file.fail())
+			printf("ERROR: Could not write replay \"%s\"\n",filename.c_str());
+		else
+		{
+			file.write(&buffer[0],buffer.size());
+			printf("Saved replay \"%s\" (%u ticks, %i bytes)\n",filename.c_str(),tickCount,buffer.size());
+		}
+	}
+	else if (playing)
+		printf("Replay stopped after %u of %u ticks\n",tickCount,totalTicks);
+
+	if (recording || playing)
+		SDL_SetEventFilter(NULL);
+	recording = false;
+	playing = false;
+	active = NULL;
+	ticks.clear();
+	current.clear();
+}
+
+void InputReplay::beginTick()
+{
+	if (not playing)
+		return;
+
+	// the recorded events take the same path through SimpleJoy as real ones
+	// (pushed events do not pass the event filter)
+	if (nextTick < ticks.size() && ticks[nextTick].number == tickCount)
+	{
+		for (vector<SDL_Event>::iterator event = ticks[nextTick].events.begin(); event != ticks[nextTick].events.end(); ++event)
+			SDL_PushEvent(&(*event));
+		++nextTick;
+	}
+}
+
+void InputReplay::endTick()
+{
+	if (recording)
+	{
+		if (not current.empty())
+		{
+			Tick tick;
+			tick.number = tickCount;
+			tick.events.swap(current);
+			ticks.push_back(tick);
+		}
+		++tickCount;
+	}
+	else if (playing)
+	{
+		if (++tickCount >= totalTicks)
+		{
+			printf("Replay finished\n");
+			stop();
+		}
+	}
+}
+
+///---private---
+
+int InputReplay::filterEvent(const SDL_Event* event)
+{
+	if (not active or not isInputEvent(event))
+		return 1;
+	if (active->playing)
+		return 0; // only recorded input during playback
+	active->current.push_back(*event);
+	return 1;
+}
+
+bool InputReplay::isInputEvent(const SDL_Event* event)
+{
+	switch (event->type)
+	{
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+	case SDL_MOUSEMOTION:
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+	case SDL_JOYAXISMOTION:
+	case SDL_JOYHATMOTION:
+	case SDL_JOYBUTTONDOWN:
+	case SDL_JOYBUTTONUP:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void InputReplay::writeEvent(vector<char>& buffer, const SDL_Event& event) const
+{
+	buffer.push_back(event.type);
+	switch (event.type)
+	{
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		writeUint16(buffer,event.key.keysym.sym);
+		writeUint16(buffer,event.key.keysym.mod);
+		writeUint16(buffer,event.key.keysym.unicode);
+		buffer.push_back(event.key.keysym.scancode);
+		break;
+	case SDL_MOUSEMOTION:
+		writeUint16(buffer,event.motion.x);
+		writeUint16(buffer,event.motion.y);
+		writeUint16(buffer,event.motion.xrel);
+		writeUint16(buffer,event.motion.yrel);
+		buffer.push_back(event.motion.state);
+		break;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		buffer.push_back(event.button.button);
+		writeUint16(buffer,event.button.x);
+		writeUint16(buffer,event.button.y);
+		break;
+	case SDL_JOYAXISMOTION:
+		buffer.push_back(event.jaxis.which);
+		buffer.push_back(event.jaxis.axis);
+		writeUint16(buffer,event.jaxis.value);
+		break;
+	case SDL_JOYHATMOTION:
+		buffer.push_back(event.jhat.which);
+		buffer.push_back(event.jhat.hat);
+		buffer.push_back(event.jhat.value);
+		break;
+	case SDL_JOYBUTTONDOWN:
+	case SDL_JOYBUTTONUP:
+		buffer.push_back(event.jbutton.which);
+		buffer.push_back(event.jbutton.button);
+		break;
+	}
+}
+
+bool InputReplay::readEvent(const vector<char>& buffer, size_t& pos, SDL_Event& event) const
+{
+	memset(&event,0,sizeof(event));
+	Uint8 type;
+	Uint16 a, b, c, d;
+	if (not readUint8(buffer,pos,type))
+		return false;
+	event.type = type;
+	switch (type)
+	{
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		if (not readUint16(buffer,pos,a) || not readUint16(buffer,pos,b) || not readUint16(buffer,pos,c) ||
+				not readUint8(buffer,pos,event.key.keysym.scancode))
+			return false;
+		event.key.state = (type == SDL_KEYDOWN) ? SDL_PRESSED : SDL_RELEASED;
+		event.key.keysym.sym = (SDLKey)a;
+		event.key.keysym.mod = (SDLMod)b;
+		event.key.keysym.unicode = c;
+		return true;
+	case SDL_MOUSEMOTION:
+		if (not readUint16(buffer,pos,a) || not readUint16(buffer,pos,b) || not readUint16(buffer,pos,c) ||
+				not readUint16(buffer,pos,d) || not readUint8(buffer,pos,event.motion.state))
+			return false;
+		event.motion.x = a;
+		event.motion.y = b;
+		event.motion.xrel = (Sint16)c;
+		event.motion.yrel = (Sint16)d;
+		return true;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		if (not readUint8(buffer,pos,event.button.button) || not readUint16(buffer,pos,a) || not readUint16(buffer,pos,b))
+			return false;
+		event.button.state = (type == SDL_MOUSEBUTTONDOWN) ? SDL_PRESSED : SDL_RELEASED;
+		event.button.x = a;
+		event.button.y = b;
+		return true;
+	case SDL_JOYAXISMOTION:
+		if (not readUint8(buffer,pos,event.jaxis.which) || not readUint8(buffer,pos,event.jaxis.axis) ||
+				not readUint16(buffer,pos,a))
+			return false;
+		event.jaxis.value = (Sint16)a;
+		return true;
+	case SDL_JOYHATMOTION:
+		return readUint8(buffer,pos,event.jhat.which) && readUint8(buffer,pos,event.jhat.hat) &&
+				readUint8(buffer,pos,event.jhat.value);
+	case SDL_JOYBUTTONDOWN:
+	case SDL_JOYBUTTONUP:
+		if (not readUint8(buffer,pos,event.jbutton.which) || not readUint8(buffer,pos,event.jbutton.button))
+			return false;
+		event.jbutton.state = (type == SDL_JOYBUTTONDOWN) ? SDL_PRESSED : SDL_RELEASED;
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,108 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef INPUTREPLAY_H
+#define INPUTREPLAY_H
+
+#include <SDL/SDL.h>
+#include <string>
+#include <vector>
+
+#include "PenjinTypes.h"
+
+#define REPLAY_FOLDER "replays/"
+#define REPLAY_EXTENSION ".grpl"
+
+/**
+Records the input events of a level run per tick together with the random
+seed, so the run can be played back exactly (e.g. to profile it or to track
+down physics bugs)
+Recording uses an SDL event filter, so it sees exactly the events SimpleJoy
+reads, playback drops all real input events and pushes the recorded ones
+before SimpleJoy updates, so they take the same path as on recording
+The game logic is tick based, so the replay is independent of the frame rate
+File layout (numbers 32bit little endian, strings with their length first):
+"GRPL", version, seed, level file, chapter path, time trial flag, then for
+every tick with input the tick number, the number of events and the events
+(type byte and its data), ended by 0xFFFFFFFF and the total number of ticks
+**/
+
+class InputReplay
+{
+public:
+	InputReplay();
+	~InputReplay();
+
+	// starts recording a run of the passed level, the file is written on stop
+	bool startRecording(CRstring filename, CRstring levelFile, CRstring chapterPath, CRuint seed, CRbool timeTrial);
+	// reads a replay file, the level and seed have to be set up by the caller
+	// (see getters) before playback starts with the first beginTick
+	bool startPlayback(CRstring filename);
+	// ends recording (writes the file) or playback
+	void stop();
+
+	// call directly before and after SimpleJoy::update every tick
+	void beginTick();
+	void endTick();
+
+	bool isRecording() const {return recording;}
+	bool isPlaying() const {return playing;}
+
+	CRstring getLevelFile() const {return levelFile;}
+	CRstring getChapterPath() const {return chapterPath;}
+	uint getSeed() const {return seed;}
+	bool getTimeTrial() const {return timeTrial;}
+
+private:
+	struct Tick
+	{
+		Uint32 number;
+		vector<SDL_Event> events;
+	};
+
+	// records input events while recording, drops them while playing
+	static int filterEvent(const SDL_Event* event);
+	static bool isInputEvent(const SDL_Event* event);
+
+	void writeEvent(vector<char>& buffer, const SDL_Event& event) const;
+	bool readEvent(const vector<char>& buffer, size_t& pos, SDL_Event& event) const;
+
+	static InputReplay* active; // the instance the event filter works for
+
+	bool recording;
+	bool playing;
+	string filename;
+	string levelFile;
+	string chapterPath;
+	uint seed;
+	bool timeTrial;
+
+	vector<Tick> ticks; // ticks with input (in order)
+	vector<SDL_Event> current; // recorded events of the running tick
+	Uint32 tickCount;
+	Uint32 totalTicks; // playback length
+	size_t nextTick; // index into ticks on playback
+};
+
+#endif // INPUTREPLAY_H
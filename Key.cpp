@@ -57,19 +57,15 @@ bool Key::load(list<PARAMETER_TYPE >& params)
 	}
 	else // clear sprites loaded by BaseUnit
 	{
-		for (map<string,AnimatedSprite*>::iterator I = states.begin(); I != states.end(); ++I)
-		{
-			delete I->second;
-		}
 		states.clear();
 	}
 	AnimatedSprite* temp = new AnimatedSprite;
 	temp->loadFrames(getSurface(imageOverwrite),1,1,0,1);
 	temp->setTransparentColour(MAGENTA);
-	states["key"] = temp;
+	states.set(ssKey,temp);
 
-	if (startingState[0] == 0 || startingState == "default")
-		startingState = "key";
+	if (startingState == STATE_NONE || startingState == ssDefault)
+		startingState = ssKey;
 	setSpriteState(startingState,true);
 
 	if (targetIDs.empty())
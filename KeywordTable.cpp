@@ -0,0 +1,117 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "KeywordTable.h"
+
+#include <cstring>
+
+#define KEYWORD_MAX_SEEDS 256
+
+KeywordTable::KeywordTable(const KeywordTable* const newParent)
+{
+	seed = 0;
+	parent = newParent;
+}
+
+///---public---
+
+KeywordTable& KeywordTable::add(const char* const name, CRint value)
+{
+	int length = strlen(name);
+	for (vector<Keyword>::iterator I = keywords.begin(); I != keywords.end(); ++I)
+	{
+		if (I->length == length && memcmp(I->name,name,length) == 0)
+		{
+			I->value = value;
+			return *this;
+		}
+	}
+
+	Keyword temp;
+	temp.name = name;
+	temp.length = length;
+	temp.value = value;
+	keywords.push_back(temp);
+	rebuild();
+	return *this;
+}
+
+int KeywordTable::find(const char* const key, CRint length) const
+{
+	if (not slots.empty())
+	{
+		int index = slots[hash(key,length,seed) & (slots.size() - 1)];
+		if (index >= 0 && keywords[index].length == length &&
+				memcmp(keywords[index].name,key,length) == 0)
+			return keywords[index].value;
+	}
+	if (parent)
+		return parent->find(key,length);
+	return 0;
+}
+
+///---private---
+
+void KeywordTable::rebuild()
+{
+	int size = 1;
+	while (size < keywords.size() * 2)
+		size *= 2;
+
+	// try seeds until every keyword gets its own slot, grow the table if that
+	// does not happen in a reasonable number of tries
+	while (true)
+	{
+		for (seed = 0; seed < KEYWORD_MAX_SEEDS; ++seed)
+		{
+			slots.assign(size,-1);
+			bool collision = false;
+			for (int I = 0; I < keywords.size(); ++I)
+			{
+				int slot = hash(keywords[I].name,keywords[I].length,seed) & (size - 1);
+				if (slots[slot] >= 0)
+				{
+					collision = true;
+					break;
+				}
+				slots[slot] = I;
+			}
+			if (not collision)
+				return;
+		}
+		size *= 2;
+	}
+}
+
+unsigned int KeywordTable::hash(const char* const key, CRint length, const unsigned int& seed)
+{
+	// FNV-1a
+	unsigned int result = 2166136261u ^ (seed * 16777619u);
+	for (int I = 0; I < length; ++I)
+	{
+		result ^= (unsigned char)key[I];
+		result *= 16777619u;
+	}
+	return result;
+}
@@ -0,0 +1,76 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef KEYWORDTABLE_H
+#define KEYWORDTABLE_H
+
+#include <vector>
+#include <string>
+
+#include "PenjinTypes.h"
+
+/**
+Constant keyword to integer table used for parsing level files (unit classes,
+parameters, flags, orders)
+Tables are defined once as static members and filled by chaining add calls,
+every add rebuilds a perfect hash (a seed is searched for which maps all
+keywords to different slots), so a lookup hashes the key once and compares
+against a single entry without allocating
+Keys not found are looked up in the parent table, so child classes only add
+their own keywords, 0 is returned if no table contains the key (the unknown
+value of all ident enums)
+**/
+
+class KeywordTable
+{
+public:
+	KeywordTable(const KeywordTable* const newParent = NULL);
+
+	// adds a keyword (or changes the value of an existing one)
+	KeywordTable& add(const char* const name, CRint value);
+
+	int find(const char* const key, CRint length) const;
+	inline int operator[](CRstring key) const {return find(key.c_str(),key.size());}
+
+	// number of keywords in this table (not counting the parent)
+	int size() const {return keywords.size();}
+
+private:
+	struct Keyword
+	{
+		const char* name;
+		int length;
+		int value;
+	};
+
+	void rebuild();
+	static unsigned int hash(const char* const key, CRint length, const unsigned int& seed);
+
+	vector<Keyword> keywords;
+	vector<int> slots; // index into keywords or -1, size is a power of two
+	unsigned int seed;
+	const KeywordTable* parent;
+};
+
+#endif // KEYWORDTABLE_H
@@ -28,7 +28,6 @@
 
 #include "BaseUnit.h"
 #include "ControlUnit.h"
-#include "PixelParticle.h"
 #include "Link.h"
 #include "Physics.h"
 #include "MyGame.h"
@@ -38,6 +37,8 @@
 #include "MusicCache.h"
 #include "Dialogue.h"
 #include "Savegame.h"
+#include "DirtyRects.h"
+#include "Profiler.h"
 #include "globalControls.h"
 
 #ifdef _MEOW
@@ -79,11 +80,23 @@
 
 #define END_TIMER_ANIMATION_STEP 30
 
+// larger movements in one tick are jumps (resets, wrapping), which are not interpolated
+#define INTERPOLATION_MAX_DISTANCE 32
+
 #define XOR(a,b) ((a) && !(b)) || (!(a) && (b))
 
 map<string,int> Level::stringToFlag;
 map<string,int> Level::stringToProp;
 
+// blends a position of the last tick into the current one by fraction
+static Vector2df interpolatePosition(const Vector2df& last, const Vector2df& current, CRfloat fraction)
+{
+	Vector2df diff = current - last;
+	if (fabs(diff.x) > INTERPOLATION_MAX_DISTANCE || fabs(diff.y) > INTERPOLATION_MAX_DISTANCE)
+		return current;
+	return last + diff * fraction;
+}
+
 Level::Level()
 {
 	// set-up static string to int conversion maps
@@ -111,6 +124,7 @@ Level::Level()
 	stringToProp["dialogue"] = lpDialogue;
 	stringToProp["gravity"] = lpGravity;
 	stringToProp["terminalvelocity"] = lpTerminalVelocity;
+	stringToProp["mapcollision"] = lpMapCollision;
 
 	levelImage = NULL;
 	collisionLayer = NULL;
@@ -118,6 +132,10 @@ Level::Level()
 	chapterPath = "";
 	errorString = "";
 	drawOffset = Vector2df(0,0);
+	lastDrawOffset = Vector2df(0,0);
+	lastTickOffset = Vector2df(0,0);
+	rewinding = false;
+	dirtyTracking = false;
 	idCounter = 0;
 	PHYSICS->reset();
 
@@ -183,11 +201,12 @@ Level::Level()
 	overlay.setColour(BLACK);
 	overlay.setAlpha(128);
 
-	arrows.loadFrames(SURFACE_CACHE->loadSurface("images/general/arrows2.png"),4,1,0,0);
+	arrows.loadFrames(getSurface("images/general/arrows2.png"),4,1,0,0);
 	arrows.setTransparentColour(MAGENTA);
 
 	hideHor = false;
 	hideVert = false;
+	snapshot.taken = false;
 
 	if (ENGINE->currentState != STATE_LEVELSELECT)
 		GFX::showCursor(false);
@@ -228,16 +247,18 @@ Level::~Level()
 		delete (*curr);
 	}
 	removedUnits.clear();
-	for (vector<PixelParticle*>::iterator curr = effects.begin(); curr != effects.end(); ++curr)
-	{
-		delete (*curr);
-	}
-	effects.clear();
+	particles.clear();
 	for (vector<Link*>::iterator curr = links.begin(); curr != links.end(); ++curr)
 	{
 		delete (*curr);
 	}
 	links.clear();
+	// the surfaces stay cached, so the next level can reuse them
+	for (vector<SDL_Surface*>::iterator curr = surfaces.begin(); curr != surfaces.end(); ++curr)
+	{
+		SURFACE_CACHE->releaseSurface(*curr);
+	}
+	surfaces.clear();
 	#ifdef _DEBUG
 	debugUnits.clear();
 	ENGINE->setFrameRate(FRAME_RATE);
@@ -272,6 +293,7 @@ bool Level::load(const list<PARAMETER_TYPE >& params)
 	else
 	{
 		collisionLayer = SDL_CreateRGBSurface(SDL_SWSURFACE,levelImage->w,levelImage->h,GFX::getVideoSurface()->format->BitsPerPixel,0,0,0,0);
+		unitGrid.init(levelImage->w,levelImage->h);
 	}
 
 	tilingSetup();
@@ -295,7 +317,7 @@ bool Level::processParameter(const PARAMETER_TYPE& value)
 	{
 	case lpImage:
 	{
-		levelImage = SURFACE_CACHE->loadSurface(value.second,chapterPath);
+		levelImage = getSurface(value.second);
 		if (levelImage == SURFACE_CACHE->getErrorSurface())
 			levelImage = NULL;
 		if (levelImage)
@@ -405,6 +427,16 @@ bool Level::processParameter(const PARAMETER_TYPE& value)
 		PHYSICS->maximum.y = StringUtility::stringToFloat(token[1]);
 		break;
 	}
+	case lpMapCollision: // "sampled" (default, only units faster than their size get swept) or "continuous"
+	{
+		if (value.second == "continuous")
+			PHYSICS->continuous = true;
+		else if (value.second == "sampled")
+			PHYSICS->continuous = false;
+		else
+			parsed = false;
+		break;
+	}
 	default:
 		parsed = false;
 	}
@@ -422,6 +454,7 @@ void Level::reset()
 	}
 	for (vector<BaseUnit*>::iterator unit = removedUnits.begin(); unit != removedUnits.end();)
 	{
+		(*unit)->body->simulated = true;
 		units.push_back(*unit);
 		unit = removedUnits.erase(unit);
 	}
@@ -439,8 +472,8 @@ void Level::reset()
 	for (int I = players.size()-1; I >= 0; --I)
 	{
 		players[I]->takesControl = playersControl[I];
-		if (players[I]->startingState == "wave" || players[I]->startingState == "stand")
-			playersControl[I] ? players[I]->startingState = "wave" : players[I]->startingState = "stand";
+		if (players[I]->startingState == ssWave || players[I]->startingState == ssStand)
+			playersControl[I] ? players[I]->startingState = ssWave : players[I]->startingState = ssStand;
 		players[I]->setSpriteState(players[I]->startingState);
 	}
 	playersControl.clear();
@@ -449,11 +482,7 @@ void Level::reset()
 	{
 		(*unit)->reset();
 	}
-	for (vector<PixelParticle*>::iterator curr = effects.begin(); curr != effects.end(); ++curr)
-	{
-		delete (*curr);
-	}
-	effects.clear();
+	particles.clear();
 	for (vector<Link*>::iterator curr = links.begin(); curr != links.end(); ++curr)
 	{
 		delete (*curr);
@@ -462,12 +491,16 @@ void Level::reset()
 
 	firstLoad = false;
 	ENGINE->restartCounter++;
+	rewind.clear();
 	cam.reset();
 	PHYSICS->reset();
 	drawOffset = Vector2df(0,0);
 	eventState = fsNone;
 
-	load(parameters);
+	if (snapshot.taken)
+		restoreSnapshot();
+	else
+		load(parameters);
 	init();
 }
 
@@ -495,13 +528,13 @@ void Level::init()
 	switch (ENGINE->settings->getParticleDensity())
 	{
 	case Settings::pdFew:
-		effects.reserve(256);
+		particles.reserve(256);
 		break;
 	case Settings::pdMany:
-		effects.reserve(1024);
+		particles.reserve(1024);
 		break;
 	case Settings::pdTooMany:
-		effects.reserve(4096);
+		particles.reserve(4096);
 		break;
 	default:
 		break;
@@ -513,6 +546,15 @@ void Level::init()
 	removedPlayers.reserve(4);
 
 	SDL_BlitSurface(levelImage,NULL,collisionLayer,NULL);
+	if (snapshot.taken)
+		collisionMap.reset(); // the base layer is the level image already
+	else
+	{
+		initCollisionMap();
+		takeSnapshot();
+	}
+	// whole collision layer changed, redraw everything next frame
+	dirtyTracking = false;
 }
 
 void Level::userInput()
@@ -567,6 +609,8 @@ void Level::userInput()
 		lose(true);
 		input->resetKeys();
 	}
+	// step back in time while held
+	rewinding = canRewind() && input->isKey("BACKSPACE");
 
 #ifdef _DEBUG
 	if (input->isLeftClick())
@@ -589,11 +633,13 @@ void Level::userInput()
 
 	if (input->isKey("b"))
 	{
+		// fast forward, one tick per frame as fast as possible
 		if (frameLimiter)
 			ENGINE->setFrameRate(1000);
 		else
-			ENGINE->setFrameRate(FRAME_RATE);
+			ENGINE->setFrameRate(ENGINE->renderRate);
 		frameLimiter = !frameLimiter;
+		ENGINE->fixedTimestep = frameLimiter;
 	}
 #endif
 
@@ -622,12 +668,19 @@ void Level::userInput()
 
 void Level::update()
 {
+	if (rewinding)
+	{
+		rewindTick();
+		return;
+	}
+
 	++timeCounter;
 	++timeOnLevel;
 	if ( firstLoad && nameTimer > 0 )
 		--nameTimer;
 
 	// Check for units to be removed, also reset temporary data
+	ProfileZone zone(pzRemoval);
 	for (vector<ControlUnit*>::iterator player = players.begin(); player != players.end();)
 	{
 		(*player)->resetTemporary();
@@ -648,6 +701,7 @@ void Level::update()
 		if ((*unit)->toBeRemoved)
 		{
 			clearUnitFromCollision(collisionLayer,*unit);
+			(*unit)->body->simulated = false;
 			removedUnits.push_back(*unit);
 			unit = units.erase(unit);
 		}
@@ -656,19 +710,11 @@ void Level::update()
 			++unit;
 		}
 	}
-	for (vector<PixelParticle*>::iterator part = effects.begin();  part != effects.end();)
-	{
-		(*part)->resetTemporary();
-		if ((*part)->toBeRemoved)
-		{
-			delete (*part);
-			part = effects.erase(part);
-		}
-		else
-		{
-			++part;
-		}
-	}
+	particles.removeDead();
+	lastTickOffset = drawOffset;
+	lastPlayerPositions.resize(players.size());
+	for (int I = 0; I < players.size(); ++I)
+		lastPlayerPositions[I] = players[I]->position;
 	for (vector<Link*>::iterator I = links.begin();  I != links.end();)
 	{
 		(*I)->update();
@@ -683,37 +729,44 @@ void Level::update()
 		}
 	}
 
+	onCollisionStart();
+
 	// particle-map collision
 	// and update (velocity, gravity, etc.)
-	for (vector<PixelParticle*>::iterator curr = effects.begin(); curr != effects.end(); ++curr)
-	{
-		PHYSICS->applyPhysics(*curr);
-		PHYSICS->particleMapCollision(this,collisionLayer,(*curr));
-		(*curr)->update();
-	}
+	zone.next(pzParticlePhysics);
+	PHYSICS->particlePhysics(&collisionMap,&particles);
+	particles.update();
 
 	// physics (acceleration, friction, etc)
+	// adjustPosition does not touch velocity or acceleration, so the physics of
+	// all units can be applied afterwards straight on the body pool
+	zone.next(pzUnitPhysics);
 	for (vector<BaseUnit*>::iterator unit = units.begin();  unit != units.end(); ++unit)
 	{
 		adjustPosition(*unit);
-		PHYSICS->applyPhysics(*unit);
 	}
+	PHYSICS->applyPhysics(&bodies);
 	// cache unit collision data for ALL units
+	// only pairs sharing a cell of the grid are tested (in the same order as
+	// testing every pair would)
+	zone.next(pzUnitCollision);
+	fillUnitGrid();
 	for (vector<ControlUnit*>::iterator player = players.begin(); player != players.end(); ++player)
 	{
 		clearUnitFromCollision(collisionLayer,*player);
 		adjustPosition( *player, (*player)->takesControl );
 		PHYSICS->applyPhysics(*player);
-		for (vector<BaseUnit*>::iterator unit = units.begin();  unit != units.end(); ++unit)
+		queryUnitGrid(*player,gridResult);
+		for (vector<int>::const_iterator I = gridResult.begin(); I != gridResult.end(); ++I)
 		{
-			PHYSICS->playerUnitCollision(this,(*player),(*unit));
+			PHYSICS->playerUnitCollision(this,(*player),units[*I]);
 		}
 	}
 	for (vector<BaseUnit*>::iterator unit = units.begin(); unit != units.end(); ++unit)
 	{
-		vector<BaseUnit*>::iterator next = unit;
-		for (vector<BaseUnit*>::iterator unit2 = ++next; unit2 != units.end(); ++unit2)
-			PHYSICS->playerUnitCollision(this,(*unit2),(*unit));
+		queryUnitGrid(*unit,gridResult,unit - units.begin());
+		for (vector<int>::const_iterator I = gridResult.begin(); I != gridResult.end(); ++I)
+			PHYSICS->playerUnitCollision(this,units[*I],(*unit));
 
 		for (vector<UnitCollisionEntry>::iterator item = (*unit)->collisionInfo.units.begin();
 			item != (*unit)->collisionInfo.units.end(); ++item)
@@ -729,6 +782,11 @@ void Level::update()
 	// also if a sinlge pixel only collides with the unit itself disregard that
 
 	// map collision
+	// Both representations are kept up to date here: collisionLayer is the
+	// composited level image render() blits to the screen (it is not read back
+	// anymore), collisionMap holds the colour IDs the physics checks against.
+	// clearUnitFromCollision and renderUnit update both for the unit's rect.
+	zone.next(pzMapCollision);
 	for (vector<BaseUnit*>::iterator curr = units.begin(); curr != units.end(); ++curr)
 	{
 		clearUnitFromCollision(collisionLayer,(*curr));
@@ -742,7 +800,7 @@ void Level::update()
 
 		if (not (*curr)->flags.hasFlag(BaseUnit::ufNoMapCollision))
 		{
-			PHYSICS->unitMapCollision(this,collisionLayer,(*curr));
+			PHYSICS->unitMapCollision(this,&collisionMap,(*curr));
 		}
 
 		// else still update unit on collision surface for player-map collision
@@ -761,13 +819,20 @@ void Level::update()
 	}
 
 	// player-map collision
+	zone.next(pzPlayerUpdate);
 	for (vector<ControlUnit*>::iterator curr = players.begin(); curr != players.end(); ++curr)
 	{
 		// players should always have map collision enabled, so don't check for that here
-		PHYSICS->unitMapCollision(this,collisionLayer,(*curr));
+		PHYSICS->unitMapCollision(this,&collisionMap,(*curr));
 		(*curr)->update();
+		// players are only drawn to the collision surface when rendering (not at
+		// all when interpolating), but units check against them in every tick
+		renderUnitCollision(*curr);
 	}
 
+	zone.stop();
+	onCollisionEnd();
+
 	// other update stuff
 	if (flags.hasFlag(lfKeepCentred))
 		cam.centerOnUnit(getFirstActivePlayer(),500);
@@ -799,12 +864,25 @@ void Level::update()
 		win();
 	}
 
-	DIALOGUE->update();
+	// these belong to the main thread, previews are updated by the level select's workers
+	if (ENGINE->currentState != STATE_LEVELSELECT)
+	{
+		zone.next(pzDialogue);
+		DIALOGUE->update();
 
-	EFFECTS->update();
+		zone.next(pzHollywood);
+		EFFECTS->update();
+	}
+	zone.stop();
 
 	cam.update();
 
+	if (canRewind())
+	{
+		collectRewindUnits();
+		rewind.record(rewindUnits,drawOffset);
+	}
+
 #ifdef _DEBUG
 	debugString = debugInfo();
 	for (vector<BaseUnit*>::const_iterator I = debugUnits.begin(); I != debugUnits.end(); ++I)
@@ -821,11 +899,26 @@ void Level::update()
 
 void Level::render()
 {
-	GFX::clearScreen();
+	if (not dirtyTracking)
+	{
+		DIRTY_RECTS->invalidate();
+		dirtyTracking = true;
+	}
+	// draw the camera between the last two ticks, see render(SDL_Surface*) for players
+	Vector2df tickOffset = drawOffset;
+	if (ENGINE->tickFraction < 1.0f)
+		drawOffset = interpolatePosition(lastTickOffset,drawOffset,ENGINE->tickFraction);
+
+	bool partial = canRenderPartial();
+	DIRTY_RECTS->setPartial(partial);
+	if (not partial)
+		GFX::clearScreen();
 
+	ProfileZone zone(pzRenderLevel);
 	render(GFX::getVideoSurface());
 
 	// if level is smaller hide outside area
+	zone.next(pzRenderScaling);
 	SimpleFlags sides;
 	SDL_Rect src, dst;
 	dst.w = 0;
@@ -987,39 +1080,32 @@ void Level::render()
 //		}
 	}
 
-	// scaling (very unoptimized and slow!)
-	// TODO: Implement properly
+	// scaling
 	if (flags.hasFlag(lfScaleX) && getWidth() != GFX::getXResolution() ||
 			flags.hasFlag(lfScaleY) && getHeight() != GFX::getYResolution())
 	{
-		static float fx = (float)GFX::getXResolution() / (float)getWidth();
-		static float fy = (float)GFX::getYResolution() / (float)getHeight();
-		SDL_Surface* scaled;
-		SDL_Rect scaleRect;
+		float fx = (float)GFX::getXResolution() / (float)getWidth();
+		float fy = (float)GFX::getYResolution() / (float)getHeight();
 		if (not flags.hasFlag(lfScaleX))
 		{
-			scaled = zoomSurface(GFX::getVideoSurface(),fy,fy,SMOOTHING_OFF);
-			scaleRect.x = (float)-drawOffset.x * fy;
-			scaleRect.y = (float)-drawOffset.y * fy;
+			scaler.setup(GFX::getVideoSurface(),fy,fy,(float)-drawOffset.x * fy,(float)-drawOffset.y * fy);
 		}
 		else if (not flags.hasFlag(lfScaleY))
 		{
-			scaled = zoomSurface(GFX::getVideoSurface(),fx,fx,SMOOTHING_OFF);
-			scaleRect.x = (float)-drawOffset.x * fx;
-			scaleRect.y = (float)-drawOffset.y * fx + (scaled->h - GFX::getYResolution());
+			// keep the bottom of the level at the bottom of the screen
+			int scaledHeight = floor((float)GFX::getYResolution() * fx + 0.5f);
+			scaler.setup(GFX::getVideoSurface(),fx,fx,(float)-drawOffset.x * fx,
+					(float)-drawOffset.y * fx + (scaledHeight - (int)GFX::getYResolution()));
 		}
 		else
 		{
-			scaled = zoomSurface(GFX::getVideoSurface(),fx,fy,SMOOTHING_OFF);
-			scaleRect.x = (float)-drawOffset.x * fx;
-			scaleRect.y = (float)-drawOffset.y * fy;
+			scaler.setup(GFX::getVideoSurface(),fx,fy,(float)-drawOffset.x * fx,(float)-drawOffset.y * fy);
 		}
-		scaleRect.w = GFX::getXResolution();
-		scaleRect.h = GFX::getYResolution();
-		SDL_BlitSurface(scaled,&scaleRect,GFX::getVideoSurface(),NULL);
-		SDL_FreeSurface(scaled);
+		scaler.scale(GFX::getVideoSurface());
 	}
 
+	zone.stop();
+
 	// draw level name overlay
 	if (firstLoad)
 	{
@@ -1027,12 +1113,20 @@ void Level::render()
 		{
 			nameRect.render();
 			nameText.print(name);
+			SDL_Rect nameArea = {0,(GFX::getYResolution() - NAME_RECT_HEIGHT) / 2,GFX::getXResolution(),NAME_RECT_HEIGHT};
+			DIRTY_RECTS->addOverlay(nameArea);
 		}
 	}
 
+	zone.next(pzDialogue);
 	DIALOGUE->render();
+	SDL_Rect dialogueArea;
+	if (DIALOGUE->getRect(dialogueArea))
+		DIRTY_RECTS->addOverlay(dialogueArea);
 
+	zone.next(pzHollywood);
 	EFFECTS->render();
+	zone.stop();
 
 	// draw the cursor
 	Vector2df pos = input->getMouse();
@@ -1042,11 +1136,17 @@ void Level::render()
 	GFX::setPixel(pos+Vector2df(1,-1),RED);
 	GFX::setPixel(pos+Vector2df(-1,-1),RED);
 	//GFX::renderPixelBuffer();
+	SDL_Rect cursorArea = {pos.x - 1,pos.y - 1,3,3};
+	DIRTY_RECTS->addOverlay(cursorArea);
 
 #ifdef _DEBUG
 	debugText.setPosition(10,10);
 	debugText.print(debugString);
 #endif
+
+	lastDrawOffset = drawOffset;
+	drawOffset = tickOffset;
+	DIRTY_RECTS->setLevelFrame();
 }
 
 void Level::render(SDL_Surface* screen)
@@ -1128,26 +1228,80 @@ void Level::render(SDL_Surface* screen)
 		src.w = min((int)GFX::getXResolution(),getWidth() - src.x);
 		src.h = min((int)GFX::getYResolution(),getHeight() - src.y);
 
+		// interpolated players are drawn straight to the screen below, as they
+		// would not be cleared from the collision surface in frames without update
+		bool smooth = screen == GFX::getVideoSurface() && ENGINE->tickFraction < 1.0f;
+
 		// players don't get drawn to the collision surface for collision testing
-		for (vector<ControlUnit*>::iterator curr = players.begin(); curr != players.end(); ++curr)
+		for (vector<ControlUnit*>::iterator curr = players.begin(); curr != players.end() && not smooth; ++curr)
 		{
 			renderUnit(collisionLayer,(*curr),Vector2df(0,0));
 		}
 
-		SDL_BlitSurface(collisionLayer,&src,screen,&dst);
+		if (screen == GFX::getVideoSurface() && DIRTY_RECTS->isPartial() &&
+				DIRTY_RECTS->getRestoreArea() * 2 < GFX::getXResolution() * GFX::getYResolution())
+		{
+			// only restore the changed parts of the screen
+			Uint32 clearColour = GFX::getClearColour().getSDL_Uint32Colour(screen);
+			const vector<SDL_Rect>& rects = DIRTY_RECTS->getRestoreRects();
+			for (vector<SDL_Rect>::const_iterator I = rects.begin(); I != rects.end(); ++I)
+			{
+				SDL_Rect rectSrc = {I->x + drawOffset.x,I->y + drawOffset.y,I->w,I->h};
+				SDL_Rect rectDst = *I;
+				SDL_FillRect(screen,&rectDst,clearColour);
+				SDL_BlitSurface(collisionLayer,&rectSrc,screen,&rectDst);
+			}
+		}
+		else
+		{
+			if (screen == GFX::getVideoSurface() && DIRTY_RECTS->isPartial())
+			{
+				// too much changed, redraw everything
+				DIRTY_RECTS->setPartial(false);
+				GFX::clearScreen();
+			}
+			SDL_BlitSurface(collisionLayer,&src,screen,&dst);
+		}
+
+		for (int I = 0; I < players.size() && smooth; ++I)
+		{
+			if (players[I]->flags.hasFlag(BaseUnit::ufNoRender))
+				continue;
+			Vector2df temp = players[I]->position;
+			if (I < lastPlayerPositions.size())
+				players[I]->position = interpolatePosition(lastPlayerPositions[I],temp,ENGINE->tickFraction);
+			renderUnit(screen,players[I],drawOffset);
+			// also the copy on the other side of wrapping levels
+			Vector2df pos[2] = {players[I]->position,boundsCheck(players[I])};
+			for (int K = 0; K < 2; ++K)
+			{
+				SDL_Rect playerArea = {pos[K].x - drawOffset.x,pos[K].y - drawOffset.y,
+						players[I]->getWidth(),players[I]->getHeight()};
+				DIRTY_RECTS->addOverlay(playerArea);
+			}
+			players[I]->position = temp;
+		}
 	}
 
 	// particles
-	for (vector<PixelParticle*>::iterator curr = effects.begin(); curr != effects.end(); ++curr)
+	ProfileZone zone(pzRenderParticles);
+	if (screen == GFX::getVideoSurface())
 	{
-		(*curr)->updateScreenPosition(drawOffset);
-		(*curr)->render(screen);
-		GFX::renderPixelBuffer();
+		SDL_Rect particleArea;
+		particles.render(screen,drawOffset,&particleArea);
+		DIRTY_RECTS->addOverlay(particleArea);
 	}
+	else
+		particles.render(screen,drawOffset);
+	zone.stop();
 
 	// links
 	for (vector<Link*>::iterator I = links.begin(); I != links.end(); ++I)
+	{
 		(*I)->render(screen);
+		if (screen == GFX::getVideoSurface())
+			DIRTY_RECTS->addOverlay((*I)->getRect());
+	}
 }
 
 void Level::onPause()
@@ -1617,7 +1771,7 @@ void Level::swapControl(const bool &cycleForward)
 					{
 						--activePlayers;
 						(*unit)->takesControl = true;
-						(*unit)->setSpriteState("wave",true);
+						(*unit)->setSpriteState(ssWave,true);
 					}
 				}
 				if ( activePlayers > 0 )
@@ -1625,7 +1779,7 @@ void Level::swapControl(const bool &cycleForward)
 					for (int I = 0; I < activePlayers; ++I )
 					{
 						players[I]->takesControl = true;
-						players[I]->setSpriteState("wave",true);
+						players[I]->setSpriteState(ssWave,true);
 					}
 				}
 			}
@@ -1645,7 +1799,7 @@ void Level::swapControl(const bool &cycleForward)
 					{
 						--activePlayers;
 						(*unit)->takesControl = true;
-						(*unit)->setSpriteState("wave",true);
+						(*unit)->setSpriteState(ssWave,true);
 					}
 				}
 				if ( activePlayers > 0 )
@@ -1653,7 +1807,7 @@ void Level::swapControl(const bool &cycleForward)
 					for (int I = 1; I <= activePlayers; ++I )
 					{
 						players[players.size()-I]->takesControl = true;
-						players[players.size()-I]->setSpriteState("wave",true);
+						players[players.size()-I]->setSpriteState(ssWave,true);
 					}
 				}
 			}
@@ -1665,7 +1819,7 @@ void Level::swapControl(const bool &cycleForward)
 			{
 				(*unit)->takesControl = not (*unit)->takesControl;
 				if ((*unit)->takesControl)
-					(*unit)->setSpriteState("wave",true);
+					(*unit)->setSpriteState(ssWave,true);
 				else
 				{
 					(*unit)->velocity.x = 0;
@@ -1734,13 +1888,21 @@ void Level::getUnitsByID(const vector<string>& IDs, vector<BaseUnit*>& unitVecto
 
 void Level::addParticle(const BaseUnit* const caller, const Colour& col, const Vector2df& pos, const Vector2df& vel, CRint lifeTime)
 {
-	PixelParticle* temp = new PixelParticle(this,lifeTime);
 	// copy the collision colours from the calling unit to mimic behaviour
-	temp->collisionColours.insert(caller->collisionColours.begin(),caller->collisionColours.end());
-	temp->position = pos;
-	temp->velocity = vel;
-	temp->col = col;
-	effects.push_back(temp);
+	// (the caller's own colour is replaced by the particle's one)
+	caller->updateCollisionMask(&collisionMap);
+	CollisionMask mask = caller->collisionMask;
+	Uint8 id = collisionMap.getColourID(caller->col);
+	if (id != COLOUR_ID_NONE && caller->collisionColours.find(caller->col.getIntColour()) == caller->collisionColours.end())
+		mask.reset(id);
+	particles.add(pos,vel,col,collisionMap.getColourID(col),lifeTime,particles.addMask(mask));
+}
+
+void Level::registerColours(const BaseUnit* const unit)
+{
+	collisionMap.registerColour(unit->col);
+	for (set<int>::const_iterator I = unit->collisionColours.begin(); I != unit->collisionColours.end(); ++I)
+		collisionMap.registerColour(Colour(*I));
 }
 
 void Level::addLink(BaseUnit* source, BaseUnit* target)
@@ -1761,6 +1923,14 @@ void Level::removeLink(BaseUnit *source)
 	}
 }
 
+SDL_Surface* Level::getSurface(CRstring filename, CRbool optimize)
+{
+	SDL_Surface* surface = SURFACE_CACHE->loadSurface(filename,chapterPath,optimize);
+	if (surface && surface != SURFACE_CACHE->getErrorSurface())
+		surfaces.push_back(surface);
+	return surface;
+}
+
 
 #ifdef _DEBUG
 string Level::debugInfo()
@@ -1768,12 +1938,16 @@ string Level::debugInfo()
 	string result = levelFileName + "\n";
 	result += "Players alive: " + StringUtility::intToString(players.size()) + " (" + StringUtility::intToString(players.capacity()) + ")\n";
 	result += "Units alive: " + StringUtility::intToString(units.size()) + " (" + StringUtility::intToString(units.capacity()) + ")\n";
-	result += "Particles: " + StringUtility::intToString(effects.size()) + " (" + StringUtility::intToString(effects.capacity()) + ")\n";
+	result += "Particles: " + StringUtility::intToString(particles.size()) + " (" + StringUtility::intToString(particles.capacity()) + ")\n";
+	result += "Bodies: " + StringUtility::intToString(bodies.size()) + " (" + StringUtility::intToString(bodies.capacity()) + ")\n";
 	result += "Links: " + StringUtility::intToString(links.size()) + " (" + StringUtility::intToString(links.capacity()) + ")\n";
 	result += "Camera: " + StringUtility::vecToString(drawOffset) + " | " +
 		StringUtility::vecToString(cam.getDest()) + " | " +
 		StringUtility::vecToString(cam.getSpeed()) + "\n";
 	result += "Flags: " + StringUtility::intToString(flags.flags) + "\n";
+	result += "Rewind: " + StringUtility::intToString(rewind.getLength()) + " ticks (" +
+		StringUtility::intToString(rewind.getMemoryUsage() / 1024) + " KiB)\n";
+	result += SURFACE_CACHE->debugInfo();
 	if (input && collisionLayer)
 	{
 		result += "Mouse: " + StringUtility::vecToString(input->getMouse());
@@ -1831,6 +2005,11 @@ void Level::clearRectangle(SDL_Surface* const surface, CRfloat posX, CRfloat pos
 	unitRect.h = tempH;
 
 	SDL_BlitSurface(levelImage,&unitRect,surface,&unitRect);
+	if (surface == collisionLayer)
+	{
+		collisionMap.clearRect(unitRect);
+		addDirtyRect(unitRect.x,unitRect.y,unitRect.w,unitRect.h);
+	}
 }
 
 void Level::renderUnit(SDL_Surface* const surface, BaseUnit* const unit, const Vector2df& offset)
@@ -1850,6 +2029,11 @@ void Level::renderUnit(SDL_Surface* const surface, BaseUnit* const unit, const V
 
 	unit->updateScreenPosition(offset);
 	unit->render(surface);
+	if (surface == collisionLayer)
+	{
+		unit->renderCollision(&collisionMap,surface);
+		addDirtyRect(unit->position.x,unit->position.y,unit->getWidth(),unit->getHeight());
+	}
 	Vector2df pos2 = boundsCheck(unit);
 	if (pos2 != unit->position)
 	{
@@ -1857,10 +2041,62 @@ void Level::renderUnit(SDL_Surface* const surface, BaseUnit* const unit, const V
 		unit->position = pos2;
 		unit->updateScreenPosition(offset);
 		unit->render(surface);
+		if (surface == collisionLayer)
+		{
+			unit->renderCollision(&collisionMap,surface);
+			addDirtyRect(pos2.x,pos2.y,unit->getWidth(),unit->getHeight());
+		}
+		unit->position = temp;
+	}
+}
+
+void Level::renderUnitCollision(BaseUnit* const unit)
+{
+	if ( unit->flags.hasFlag(BaseUnit::ufNoRender) )
+		return;
+
+	unit->renderCollision(&collisionMap,collisionLayer);
+	Vector2df pos2 = boundsCheck(unit);
+	if (pos2 != unit->position)
+	{
+		Vector2df temp = unit->position;
+		unit->position = pos2;
+		unit->renderCollision(&collisionMap,collisionLayer);
 		unit->position = temp;
 	}
 }
 
+bool Level::canRenderPartial() const
+{
+#ifdef _DEBUG
+	return false; // debug text is not tracked
+#else
+	if (not DIRTY_RECTS->isValid() || drawOffset != lastDrawOffset)
+		return false;
+	if (flags.hasFlag(lfScaleX) || flags.hasFlag(lfScaleY) ||
+			flags.hasFlag(lfSplitX) || flags.hasFlag(lfSplitY))
+		return false;
+	if (flags.hasFlag(lfDrawPattern) && (flags.hasFlag(lfRepeatX) || flags.hasFlag(lfRepeatY)))
+		return false;
+	// fades, wipes, etc. cover the whole screen
+	return EFFECTS->isIdle();
+#endif
+}
+
+void Level::addDirtyRect(CRfloat posX, CRfloat posY, CRint width, CRint height)
+{
+	if (not dirtyTracking)
+		return;
+
+	// add a pixel on each side to account for rounding of the position
+	SDL_Rect rect;
+	rect.x = floor(posX - drawOffset.x) - 1;
+	rect.y = floor(posY - drawOffset.y) - 1;
+	rect.w = width + 2;
+	rect.h = height + 2;
+	DIRTY_RECTS->addBackground(rect);
+}
+
 void Level::renderTiling(SDL_Surface* src, SDL_Rect* srcRect, SDL_Surface* target,
 						SDL_Rect* targetRect, SimpleDirection dir )
 {
@@ -1965,6 +2201,152 @@ bool Level::adjustPosition( BaseUnit* const unit, const bool adjustCamera )
 	return changed;
 }
 
+void Level::fillUnitGrid()
+{
+	// velocity may still change when units hit each other, so use the physical
+	// maximum as a safe margin (or more if some unit is faster than that)
+	gridMargin = PHYSICS->maximum;
+	for (vector<UnitBody*>::const_iterator block = bodies.blocks.begin(); block != bodies.blocks.end(); ++block)
+	{
+		const UnitBody* const end = (*block) + UNIT_BODY_BLOCK_SIZE;
+		for (const UnitBody* body = *block; body != end; ++body)
+		{
+			if (not body->simulated)
+				continue;
+			gridMargin.x = max(gridMargin.x,abs(body->velocity.x));
+			gridMargin.y = max(gridMargin.y,abs(body->velocity.y));
+		}
+	}
+
+	unitGrid.clear();
+	for (int I = 0; I < units.size(); ++I)
+	{
+		Vector2df size = Vector2df(units[I]->getSize()) + gridMargin * 2.0f;
+		unitGrid.insert(I,units[I]->position - gridMargin,size);
+		Vector2df pos2 = boundsCheck(units[I]);
+		if (pos2 != units[I]->position)
+			unitGrid.insert(I,pos2 - gridMargin,size);
+	}
+}
+
+void Level::queryUnitGrid(const BaseUnit* const unit, vector<int>& result, CRint minIndex)
+{
+	result.clear();
+	Vector2df margin(max(gridMargin.x,abs(unit->velocity.x)),max(gridMargin.y,abs(unit->velocity.y)));
+	Vector2df size = Vector2df(unit->getSize()) + margin * 2.0f;
+	unitGrid.query(unit->position - margin,size,result,minIndex);
+	Vector2df pos2 = boundsCheck(unit);
+	if (pos2 != unit->position)
+		unitGrid.query(pos2 - margin,size,result,minIndex);
+}
+
+void Level::initCollisionMap()
+{
+	collisionMap.loadBase(collisionLayer);
+}
+
+void Level::collectRewindUnits()
+{
+	rewindUnits.clear();
+	rewindUnits.insert(rewindUnits.end(),players.begin(),players.end());
+	rewindUnits.insert(rewindUnits.end(),units.begin(),units.end());
+}
+
+bool Level::canRewind() const
+{
+	return ENGINE->currentState != STATE_LEVELSELECT && ENGINE->settings->getDebugControls() &&
+			not ENGINE->timeTrial && not ENGINE->chapterTrial;
+}
+
+void Level::rewindTick()
+{
+	// take units and players off the collision surface at their current position
+	for (vector<BaseUnit*>::iterator curr = units.begin(); curr != units.end(); ++curr)
+		clearUnitFromCollision(collisionLayer,*curr);
+	for (vector<ControlUnit*>::iterator curr = players.begin(); curr != players.end(); ++curr)
+		clearUnitFromCollision(collisionLayer,*curr);
+
+	collectRewindUnits();
+	vector<SDL_Rect> oldRects(rewindUnits.size());
+	for (int I = 0; I < rewindUnits.size(); ++I)
+	{
+		SDL_Rect temp = {floor(rewindUnits[I]->position.x),floor(rewindUnits[I]->position.y),
+						 rewindUnits[I]->getWidth(),rewindUnits[I]->getHeight()};
+		oldRects[I] = temp;
+	}
+	lastTickOffset = drawOffset;
+	lastPlayerPositions.resize(players.size());
+	for (int I = 0; I < players.size(); ++I)
+		lastPlayerPositions[I] = players[I]->position;
+	if (rewind.stepBack(rewindUnits,drawOffset))
+	{
+		--timeCounter;
+		--timeOnLevel;
+		cam.reset(); // stop camera movements of the future
+	}
+
+	for (vector<BaseUnit*>::iterator curr = units.begin(); curr != units.end(); ++curr)
+		renderUnit(collisionLayer,*curr,Vector2df(0,0));
+	for (vector<BaseUnit*>::iterator curr = units.begin(); curr != units.end(); ++curr)
+	{
+		if ((*curr)->flags.hasFlag(BaseUnit::ufAlwaysOnTop))
+			renderUnit(collisionLayer,*curr,Vector2df(0,0));
+	}
+	// players are drawn when rendering, but units check against them (see update)
+	for (vector<ControlUnit*>::iterator curr = players.begin(); curr != players.end(); ++curr)
+		renderUnitCollision(*curr);
+
+	// redraw the whole area a unit moved across, not only its old and new rect
+	for (int I = 0; I < rewindUnits.size(); ++I)
+	{
+		const SDL_Rect& old = oldRects[I];
+		int newX = floor(rewindUnits[I]->position.x);
+		int newY = floor(rewindUnits[I]->position.y);
+		if (newX == old.x && newY == old.y)
+			continue;
+		int left = min((int)old.x,newX);
+		int top = min((int)old.y,newY);
+		int right = max(old.x + old.w,newX + rewindUnits[I]->getWidth());
+		int bottom = max(old.y + old.h,newY + rewindUnits[I]->getHeight());
+		addDirtyRect(left,top,right - left,bottom - top);
+	}
+}
+
+void Level::takeSnapshot()
+{
+	snapshot.drawOffset = drawOffset;
+	snapshot.flags = flags;
+	snapshot.hideHor = hideHor;
+	snapshot.hideVert = hideVert;
+	snapshot.disregardBoundaries = cam.disregardBoundaries;
+	snapshot.gravity = PHYSICS->gravity;
+	snapshot.maximum = PHYSICS->maximum;
+	snapshot.continuous = PHYSICS->continuous;
+	snapshot.taken = true;
+}
+
+void Level::restoreSnapshot()
+{
+	drawOffset = snapshot.drawOffset;
+	flags = snapshot.flags;
+	hideHor = snapshot.hideHor;
+	hideVert = snapshot.hideVert;
+	cam.disregardBoundaries = snapshot.disregardBoundaries;
+	PHYSICS->gravity = snapshot.gravity;
+	PHYSICS->maximum = snapshot.maximum;
+	PHYSICS->continuous = snapshot.continuous;
+
+	// these act on global state (clear colour, music, dialogue), which might
+	// have changed, child class parameters (Benchmark) are not covered by the
+	// snapshot, so process them again as a full load would
+	for (list<PARAMETER_TYPE >::const_iterator value = parameters.begin(); value != parameters.end(); ++value)
+	{
+		int prop = stringToProp[value->first];
+		if (prop == lpBackground || prop == lpMusic || prop == lpDialogue || prop >= lpEOL)
+			processParameter(*value);
+	}
+}
+
 bool Level::playersVisible() const
 {
 	SDL_Rect screen = {drawOffset.x,drawOffset.y,GFX::getXResolution(),GFX::getYResolution()};
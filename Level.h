@@ -43,6 +43,12 @@
 
 #include "SimpleFlags.h"
 #include "Camera.h"
+#include "CollisionMap.h"
+#include "CollisionGrid.h"
+#include "RewindBuffer.h"
+#include "UnitBody.h"
+#include "ParticlePool.h"
+#include "SurfaceScaler.h"
 #include "fileTypeDefines.h"
 
 /**
@@ -52,7 +58,6 @@ Does input processing, collision testing and bounds checking
 
 class BaseUnit;
 class ControlUnit;
-class PixelParticle;
 class Link;
 
 class Level : public BaseState
@@ -73,6 +78,10 @@ public:
 	virtual bool processParameter(const PARAMETER_TYPE& value);
 
 	// reset level to initial state
+	// only the state Level::load derives from its own parameters is restored from
+	// the snapshot taken on the first init, parameters of child classes and of
+	// all units are processed again (see BaseUnit::reset) and the collision
+	// surface is redrawn from the level image
 	virtual void reset();
 
 	// framework related
@@ -129,15 +138,27 @@ public:
 	// adds a formatted particle to the list
 	void addParticle(const BaseUnit* const caller, const Colour& col, const Vector2df& pos, const Vector2df& vel, CRint lifeTime);
 
+	// adds the unit's colour and collision colours to the level's colour IDs
+	// (done on loading, so these are preferred over colours only in the image)
+	void registerColours(const BaseUnit* const unit);
+
 	// add/remove Links
 	void addLink(BaseUnit *source, BaseUnit *target);
 	void removeLink(BaseUnit *source);
 
+	// loads an image through the surface cache (trying the chapter path first)
+	// the level holds a reference on it, which is released on deletion
+	SDL_Surface* getSurface(CRstring filename, CRbool optimize = false);
+
 	vector<ControlUnit*> players;
 	vector<BaseUnit*> units;
-	vector<PixelParticle*> effects;
+	// physics state of all players and units (see BaseUnit::body), the bodies of
+	// units in the units vector are simulated, all others are not
+	UnitBodyPool bodies;
+	ParticlePool particles;
 	vector<Link*> links;
 	SDL_Surface* levelImage;
+	vector<SDL_Surface*> surfaces; // loaded through getSurface
 	SimpleFlags flags;
 
 	string levelFileName; // chapterPath + filename
@@ -195,6 +216,9 @@ protected:
 	// opposite side of the screen
 	// specify offset to pass to updateScreenPosition
 	void renderUnit(SDL_Surface* const surface, BaseUnit* const unit, const Vector2df& offset);
+	// only writes the unit's colour ID to the collision map (also on the
+	// opposite side of repeating levels), without drawing it
+	void renderUnitCollision(BaseUnit* const unit);
 
 	void renderTiling( SDL_Surface *src, SDL_Rect *srcRect, SDL_Surface *target, SDL_Rect *targetRect, SimpleDirection dir );
 
@@ -203,6 +227,48 @@ protected:
 
 	bool playersVisible() const;
 
+	// inserts all units into unitGrid (broadphase for unit collision)
+	void fillUnitGrid();
+	// puts the indices of all units possibly colliding with the passed unit into
+	// result (sorted), only indices greater than minIndex are returned
+	void queryUnitGrid(const BaseUnit* const unit, vector<int>& result, CRint minIndex = -1);
+
+	// called before and after the physics and collision part of update
+	virtual void onCollisionStart() {}
+	virtual void onCollisionEnd() {}
+
+	// converts the collision surface to the collision map, call after the level
+	// image has been drawn to collisionLayer
+	void initCollisionMap();
+
+	// the state set by Level::load (not by child classes), saved after the
+	// collision map has been built, the collision map keeps its own copy of the
+	// level image (base layer)
+	// unit state (positions, velocities, flags, sprites) is not included, unit
+	// subclasses derive more state from their parameters in load and from their
+	// targets, so units still load themselves again on reset
+	struct Snapshot
+	{
+		bool taken;
+		Vector2df drawOffset;
+		SimpleFlags flags;
+		bool hideHor;
+		bool hideVert;
+		bool disregardBoundaries;
+		Vector2df gravity;
+		Vector2df maximum;
+		bool continuous;
+	};
+	void takeSnapshot();
+	void restoreSnapshot();
+	Snapshot snapshot;
+
+	// whether this frame can be drawn by only restoring the changed parts of the
+	// screen (static camera, no scaling, no fullscreen effects)
+	virtual bool canRenderPartial() const;
+	// marks a rect in level coordinates as changed on the screen
+	void addDirtyRect(CRfloat posX, CRfloat posY, CRint width, CRint height);
+
 	enum LevelProp
 	{
 		lpUnknown,
@@ -217,6 +283,7 @@ protected:
 		lpDialogue,
 		lpGravity,
 		lpTerminalVelocity,
+		lpMapCollision,
 		lpEOL
 	};
 	static map<string,int> stringToProp;
@@ -233,6 +300,29 @@ protected:
 	bool frameLimiter;
 	#endif
 	SDL_Surface* collisionLayer;
+	// colour IDs of collisionLayer used for collision checking, kept in sync
+	// by clearRectangle and renderUnit
+	CollisionMap collisionMap;
+	SurfaceScaler scaler; // used for levels with lfScaleX or lfScaleY
+	Vector2df lastDrawOffset; // drawOffset of the last frame drawn to the screen
+	// state before the last update, rendering blends it into the current one
+	// when MyGame::interpolate is set (players are parallel to the players vector)
+	Vector2df lastTickOffset;
+	vector<Vector2df> lastPlayerPositions;
+	bool dirtyTracking; // only true for the level currently drawn to the screen
+	CollisionGrid unitGrid;
+	Vector2df gridMargin; // maximum expected movement of units this frame
+	vector<int> gridResult;
+	RewindBuffer rewind;
+	vector<BaseUnit*> rewindUnits; // players and units, in the order passed to rewind
+	bool rewinding; // step back through rewind instead of updating
+	// collects players and units into rewindUnits
+	void collectRewindUnits();
+	// reverts the level by one tick, called by update instead of simulating when rewinding
+	void rewindTick();
+	// rewinding is a debug control, never available in previews and time trials
+	// (stepping back also turns back the level timer)
+	bool canRewind() const;
 	int eventTimer; // used for fading in and out
 	enum LevelFinishState
 	{
@@ -27,6 +27,8 @@
 #include <fstream>
 #include <vector>
 #include <map>
+#include <string.h>
+#include <sys/stat.h>
 
 #include "StringUtility.h"
 #include "Image.h"
@@ -34,6 +36,9 @@
 #include "userStates.h"
 #include "GreySurfaceCache.h"
 #include "SimpleFlags.h"
+#include "KeywordTable.h"
+#include "AssetPack.h"
+#include "MusicCache.h"
 
 // Level classes
 #include "Level.h"
@@ -61,6 +66,8 @@
 #include "ParticleEmitter.h"
 #include "ControlSprite.h"
 
+#define LEVEL_CACHE_SIZE 16 // parsed level files kept in memory
+
 using namespace std;
 
 enum DataIdent
@@ -111,55 +118,54 @@ enum UnitIdent
 
 // mapping the ident string used in the map file to a ident integer for use in
 // a switch statement for cleaner and faster map loading
-static map<string, DataIdent> dataIdents;
-static map<string, LevelIdent> levelClasses;
-static map<string, PlayerIdent> playerClasses;
-static map<string, UnitIdent> unitClasses;
-
-void createIdentMaps()
-{
-	dataIdents["level"] = diLevel;
-	dataIdents["player"] = diPlayer;
-	dataIdents["unit"] = diUnit;
-
-	levelClasses["generic"] = lcGeneric;
-	levelClasses["benchmark"] = lcBenchmark;
-	levelClasses["playground"] = lcPlayground;
-
-	playerClasses["generic"] = pcGeneric;
-	playerClasses["black"] = pcBlack;
-	playerClasses["white"] = pcWhite;
-
-	unitClasses["generic"] = ucGeneric;
-	unitClasses["pushablebox"] = ucPushableBox;
-	unitClasses["solidbox"] = ucSolidBox;
-	unitClasses["exit"] = ucExit;
-	unitClasses["dialoguetrigger"] = ucDialogueTrigger;
-	unitClasses["gear"] = ucGear;
-	unitClasses["switch"] = ucSwitch;
-	unitClasses["key"] = ucKey;
-	unitClasses["basetrigger"] = ucBaseTrigger;
-	unitClasses["exittrigger"] = ucExitTrigger;
-	unitClasses["soundtrigger"] = ucSoundTrigger;
-	unitClasses["cameratrigger"] = ucCameraTrigger;
-	unitClasses["text"] = ucTextObject;
-	unitClasses["fadingbox"] = ucFadingBox;
-	unitClasses["leveltrigger"] = ucLevelTrigger;
-	unitClasses["emitter"] = ucEmitter;
-	unitClasses["controlsprite"] = ucControlSprite;
-}
+static const KeywordTable dataIdents = KeywordTable()
+	.add("level",diLevel)
+	.add("player",diPlayer)
+	.add("unit",diUnit);
+
+static const KeywordTable levelClasses = KeywordTable()
+	.add("generic",lcGeneric)
+	.add("benchmark",lcBenchmark)
+	.add("playground",lcPlayground);
+
+static const KeywordTable playerClasses = KeywordTable()
+	.add("generic",pcGeneric)
+	.add("black",pcBlack)
+	.add("white",pcWhite);
+
+static const KeywordTable unitClasses = KeywordTable()
+	.add("generic",ucGeneric)
+	.add("pushablebox",ucPushableBox)
+	.add("solidbox",ucSolidBox)
+	.add("exit",ucExit)
+	.add("dialoguetrigger",ucDialogueTrigger)
+	.add("gear",ucGear)
+	.add("switch",ucSwitch)
+	.add("key",ucKey)
+	.add("basetrigger",ucBaseTrigger)
+	.add("exittrigger",ucExitTrigger)
+	.add("soundtrigger",ucSoundTrigger)
+	.add("cameratrigger",ucCameraTrigger)
+	.add("text",ucTextObject)
+	.add("fadingbox",ucFadingBox)
+	.add("leveltrigger",ucLevelTrigger)
+	.add("emitter",ucEmitter)
+	.add("controlsprite",ucControlSprite);
 
 LevelLoader* LevelLoader::self = NULL;
 
 LevelLoader::LevelLoader()
 {
 	errorString = "";
-	createIdentMaps();
+	mutex = SDL_CreateMutex();
+	prefetchThread = NULL;
+	abortPrefetch = false;
 }
 
 LevelLoader::~LevelLoader()
 {
-	//
+	finishPrefetch(true);
+	SDL_DestroyMutex(mutex);
 }
 
 LevelLoader* LevelLoader::getLevelLoader()
@@ -170,87 +176,83 @@ LevelLoader* LevelLoader::getLevelLoader()
 }
 
 Level* LevelLoader::loadLevelFromFile(CRstring filename, CRstring chapterPath)
+{
+	lock();
+	Level* level = loadLevel(filename,chapterPath);
+	// the level holds its own references to the prefetched images now
+	if (filename == prefetchFile)
+		releasePrefetched();
+	unlock();
+	return level;
+}
+
+void LevelLoader::lock()
+{
+	SDL_mutexP(mutex);
+}
+
+void LevelLoader::unlock()
+{
+	SDL_mutexV(mutex);
+}
+
+void LevelLoader::prefetchLevel(CRstring filename, CRstring chapterPath)
+{
+	finishPrefetch(true);
+	if (filename[0] == 0)
+		return;
+
+	// no thread running, so no need to lock
+	prefetchFile = filename;
+	prefetchPath = chapterPath;
+	abortPrefetch = false;
+	prefetchThread = SDL_CreateThread(LevelLoader::prefetch,this);
+}
+
+void LevelLoader::finishPrefetch(CRbool cancel)
+{
+	if (not prefetchThread)
+		return;
+
+	lock();
+	abortPrefetch = cancel;
+	unlock();
+	int* status = NULL;
+	SDL_WaitThread(prefetchThread,status);
+	prefetchThread = NULL;
+
+	if (cancel)
+	{
+		lock();
+		releasePrefetched();
+		unlock();
+	}
+}
+
+Level* LevelLoader::loadLevel(CRstring filename, CRstring chapterPath)
 {
 	printf("---------------------------------------------------------\n");
 	printf("Trying to load level file \"%s\"\n",filename.c_str());
 
-	string line;
-	ifstream file(filename.c_str());
-	int lineNumber = 0; // for error output
 	errorString = "";
 
-	if (file.fail())
-	{
-		errorString = "Failed to open file for read!";
+	const LevelData* data = NULL;
+	ErrorCode error = getLevelData(filename,data);
+	if (error == ecFile)
 		return NULL;
-	}
-
-	ErrorCode error = ecNone;
 
-	string field = ""; // the current field
-	list<PARAMETER_TYPE > params; // list of field parameters (key=value)
 	Level* level = NULL;
 
-	// parse file line by line
-	while (file.good())
+	// add fields with parameters to the level
+	if (error != ecCritical)
 	{
-		getline(file,line);
-		++lineNumber;
-
-		// solve win-lin compatibility issues
-		line = StringUtility::stripLineEndings(line);
-		// make case in-sensitive
-		line = StringUtility::lower(line);
-
-		// A value in [] brackets indicates a new field
-		// all key=value pairs following will be loaded in a map as parameters
-		string nextField = "";
-		if (line.substr(0,COMMENT_STRING.length()) == COMMENT_STRING)
+		for (vector<LevelField>::const_iterator field = data->fields.begin(); field != data->fields.end(); ++field)
 		{
-			// comment line - disregard
-		}
-		else if (line.substr(0,FIELD_STRING.length()) == FIELD_STRING) // new field
-		{
-			// strip brackets
-			nextField = line.substr(1,line.length()-2);
-		}
-		else if (line[0] == 0) // empty line
-		{
-			// disregard
-		}
-		else // key=value pair
-		{
-			if (field[0] == 0)
-			{
-				errorString = "Parameter outside of field specification on line "
-							  + StringUtility::intToString(lineNumber);
-				error = ecCritical;
-			}
-			else
-			{
-				// add pair to the map
-				vector<string> tokens;
-				StringUtility::tokenize(line,tokens,VALUE_STRING,2);
-				if (tokens.size() != 2)
-				{
-					printf("ERROR: Incorrect key-value pair on line %i\n",lineNumber);
-					error = ecWarning;
-				}
-				else
-				{
-					// make sure class parameter is always the first element
-					if (tokens[0] == CLASS_STRING)
-						params.push_front(make_pair(tokens[0],tokens[1]));
-					else
-						params.push_back(make_pair(tokens[0],tokens[1]));
-				}
-			}
-		}
+			// the create functions might add parameters
+			list<PARAMETER_TYPE > params = field->params;
+			int lineNumber = field->lineNumber;
 
-		// add current field with parameters to the level when reaching a new field or the end of the file
-		if ((nextField[0] != 0) && (field[0] != 0) || not (file.good()))
-		{
-			switch (dataIdents[field])
+			switch (field->ident)
 			{
 			case diLevel:
 			{
@@ -298,25 +300,15 @@ Level* LevelLoader::loadLevelFromFile(CRstring filename, CRstring chapterPath)
 			}
 			default:
 			{
-				printf("ERROR: Unknown field \"%s\" ending on line %i\n",field.c_str(),lineNumber);
+				printf("ERROR: Unknown field \"%s\" ending on line %i\n",field->name.c_str(),lineNumber);
 				error = ecWarning;
 			}
 			}
-		}
 
-		if (nextField[0] != 0) // set the next field loaded above
-		{
-			field = nextField;
-			params.clear();
+			if (error == ecCritical) // encountered a critical error, abort
+				break;
 		}
-
-		if (error == ecCritical) // encountered a critical error, abort
-			break;
-	} // while
-
-
-	if (file.is_open())
-		file.close();
+	}
 
 	// Additional check for missing initialisation
 	if (level)
@@ -487,6 +479,8 @@ ControlUnit* LevelLoader::createPlayer(list<PARAMETER_TYPE >& params, Level* con
 		delete result;
 		result = NULL;
 	}
+	else
+		parent->registerColours(result);
 
 	return result;
 }
@@ -605,6 +599,361 @@ BaseUnit* LevelLoader::createUnit(list<PARAMETER_TYPE >& params, Level* const pa
 		delete result;
 		result = NULL;
 	}
+	else
+		parent->registerColours(result);
 
 	return result;
 }
+
+/// ---private------------------------------------------------------------------
+
+int LevelLoader::prefetch(void* data)
+{
+	LevelLoader* self = (LevelLoader*)data;
+	printf("Prefetching level file \"%s\"\n",self->prefetchFile.c_str());
+
+	// collect the files to load while holding the lock (the level cache
+	// might be changed by the main thread otherwise)
+	vector<string> images;
+	vector<string> sounds;
+	self->lock();
+	string error = self->errorString; // might be read by the main thread later
+	const LevelData* level = NULL;
+	ErrorCode code = self->getLevelData(self->prefetchFile,level);
+	if (code != ecFile && code != ecCritical)
+	{
+		for (vector<LevelField>::const_iterator field = level->fields.begin(); field != level->fields.end(); ++field)
+		{
+			bool soundTrigger = false;
+			if (field->ident == diUnit && not field->params.empty())
+			{
+				soundTrigger = (unitClasses[field->params.front().second] == ucSoundTrigger);
+			}
+			for (list<PARAMETER_TYPE >::const_iterator param = field->params.begin(); param != field->params.end(); ++param)
+			{
+				if ((field->ident == diLevel && param->first == "image") || param->first == "imageoverwrite")
+					images.push_back(param->second);
+				else if (soundTrigger && param->first == "file")
+					sounds.push_back(param->second);
+			}
+		}
+	}
+	self->errorString = error;
+	self->unlock();
+
+	// decoded images are pinned in the surface cache, so they are neither
+	// evicted nor dropped by releaseAll before the level loads them again
+	for (vector<string>::const_iterator image = images.begin(); image != images.end() && not self->isPrefetchAborted(); ++image)
+	{
+		SDL_Surface* surface = SURFACE_CACHE->loadSurface(*image,self->prefetchPath);
+		if (surface != SURFACE_CACHE->getErrorSurface())
+		{
+			SURFACE_CACHE->pinSurface(surface);
+			SURFACE_CACHE->releaseSurface(surface);
+			self->lock();
+			self->prefetchedImages.push_back(surface);
+			self->unlock();
+		}
+	}
+	for (vector<string>::const_iterator sound = sounds.begin(); sound != sounds.end() && not self->isPrefetchAborted(); ++sound)
+		MUSIC_CACHE->loadSound(*sound,self->prefetchPath);
+
+	if (self->isPrefetchAborted())
+		printf("Aborted prefetching level file \"%s\"\n",self->prefetchFile.c_str());
+	return 0;
+}
+
+bool LevelLoader::isPrefetchAborted()
+{
+	lock();
+	bool result = abortPrefetch;
+	unlock();
+	return result;
+}
+
+void LevelLoader::releasePrefetched()
+{
+	for (vector<SDL_Surface*>::const_iterator I = prefetchedImages.begin(); I != prefetchedImages.end(); ++I)
+		SURFACE_CACHE->unpinSurface(*I);
+	prefetchedImages.clear();
+}
+
+LevelLoader::ErrorCode LevelLoader::getLevelData(CRstring filename, const LevelData*& data)
+{
+	// files in a pack take the modification time of the pack
+	const char* packed = NULL;
+	size_t packedSize = 0;
+	time_t modified = 0;
+	long size = 0;
+	if (ASSET_PACK->find(filename,packed,packedSize,modified))
+	{
+		size = packedSize;
+	}
+	else
+	{
+		struct stat info;
+		if (stat(filename.c_str(),&info) != 0)
+		{
+			errorString = "Failed to open file for read!";
+			return ecFile;
+		}
+		modified = info.st_mtime;
+		size = info.st_size;
+	}
+
+	map<string,LevelData>::const_iterator cached = levelCache.find(filename);
+	if (cached != levelCache.end() && cached->second.modified == modified &&
+			cached->second.size == size)
+	{
+		data = &cached->second;
+		return data->warnings ? ecWarning : ecNone;
+	}
+
+	LevelData temp;
+	temp.modified = modified;
+	temp.size = size;
+	if (packed) // already in memory, no need for a compiled file
+	{
+		AssetStream file(packed,packedSize);
+		ErrorCode error = parseLevelFile(file,temp);
+		if (error == ecCritical || error == ecFile)
+			return error;
+	}
+	else if (not readCompiledLevel(filename,temp))
+	{
+		ifstream file(filename.c_str());
+		ErrorCode error = parseLevelFile(file,temp);
+		if (error == ecCritical || error == ecFile)
+			return error;
+		writeCompiledLevel(filename,temp);
+	}
+
+	// levels are only reloaded within a chapter (and the menus), so there is
+	// no need to keep track of which entries are used, just start over
+	if (levelCache.size() >= LEVEL_CACHE_SIZE)
+		levelCache.clear();
+	LevelData& entry = levelCache[filename];
+	entry = temp;
+	data = &entry;
+	return data->warnings ? ecWarning : ecNone;
+}
+
+LevelLoader::ErrorCode LevelLoader::parseLevelFile(istream& file, LevelData& data)
+{
+	string line;
+	int lineNumber = 0; // for error output
+
+	if (file.fail())
+	{
+		errorString = "Failed to open file for read!";
+		return ecFile;
+	}
+
+	data.warnings = false;
+	data.fields.clear();
+
+	string field = ""; // the current field
+	list<PARAMETER_TYPE > params; // list of field parameters (key=value)
+
+	// parse file line by line
+	while (file.good())
+	{
+		getline(file,line);
+		++lineNumber;
+
+		// solve win-lin compatibility issues
+		line = StringUtility::stripLineEndings(line);
+		// make case in-sensitive
+		line = StringUtility::lower(line);
+
+		// A value in [] brackets indicates a new field
+		// all key=value pairs following will be loaded in a map as parameters
+		string nextField = "";
+		if (line.substr(0,COMMENT_STRING.length()) == COMMENT_STRING)
+		{
+			// comment line - disregard
+		}
+		else if (line.substr(0,FIELD_STRING.length()) == FIELD_STRING) // new field
+		{
+			// strip brackets
+			nextField = line.substr(1,line.length()-2);
+		}
+		else if (line[0] == 0) // empty line
+		{
+			// disregard
+		}
+		else // key=value pair
+		{
+			if (field[0] == 0)
+			{
+				errorString = "Parameter outside of field specification on line "
+							  + StringUtility::intToString(lineNumber);
+				return ecCritical;
+			}
+			else
+			{
+				// add pair to the map
+				vector<string> tokens;
+				StringUtility::tokenize(line,tokens,VALUE_STRING,2);
+				if (tokens.size() != 2)
+				{
+					printf("ERROR: Incorrect key-value pair on line %i\n",lineNumber);
+					data.warnings = true;
+				}
+				else
+				{
+					// make sure class parameter is always the first element
+					if (tokens[0] == CLASS_STRING)
+						params.push_front(make_pair(tokens[0],tokens[1]));
+					else
+						params.push_back(make_pair(tokens[0],tokens[1]));
+				}
+			}
+		}
+
+		// store current field with parameters when reaching a new field or the end of the file
+		if ((nextField[0] != 0) && (field[0] != 0) || not (file.good()))
+		{
+			LevelField temp;
+			data.fields.push_back(temp);
+			data.fields.back().name = field;
+			data.fields.back().ident = dataIdents[field];
+			data.fields.back().lineNumber = lineNumber;
+			data.fields.back().params.swap(params);
+		}
+
+		if (nextField[0] != 0) // set the next field loaded above
+		{
+			field = nextField;
+			params.clear();
+		}
+	} // while
+
+	return data.warnings ? ecWarning : ecNone;
+}
+
+// Compiled level files store the LevelData of a text file, all numbers are
+// 32bit little endian, strings are stored with their length first:
+// "GLVC", version, modified, size, warnings, field count, then for every field
+// name, line number, parameter count and key/value strings
+// Only keyword strings are stored (idents get resolved again on reading), so
+// changes to the keyword tables don't require a new version, changes to the
+// format itself do
+
+#define COMPILED_LEVEL_MAGIC "GLVC"
+#define COMPILED_LEVEL_VERSION 2
+// minimum size of a stored field (name length, line number, parameter count)
+// and parameter (key and value length), used to sanity check counts
+#define COMPILED_FIELD_SIZE 12
+#define COMPILED_PARAM_SIZE 8
+
+static void writeUint32(ofstream& file, const Uint32& value)
+{
+	char bytes[4] = {(char)(value & 0xFF),(char)((value >> 8) & 0xFF),(char)((value >> 16) & 0xFF),(char)((value >> 24) & 0xFF)};
+	file.write(bytes,4);
+}
+
+static void writeString(ofstream& file, CRstring value)
+{
+	writeUint32(file,value.length());
+	file.write(value.data(),value.length());
+}
+
+static bool readUint32(const vector<char>& buffer, size_t& pos, Uint32& value)
+{
+	if (pos + 4 > buffer.size())
+		return false;
+	const unsigned char* bytes = (const unsigned char*)&buffer[pos];
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+	pos += 4;
+	return true;
+}
+
+static bool readString(const vector<char>& buffer, size_t& pos, string& value)
+{
+	Uint32 length;
+	if (not readUint32(buffer,pos,length) || length > buffer.size() - pos)
+		return false;
+	value.assign(&buffer[0] + pos,length);
+	pos += length;
+	return true;
+}
+
+bool LevelLoader::readCompiledLevel(CRstring filename, LevelData& data) const
+{
+	ifstream file((filename + COMPILED_LEVEL_EXTENSION).c_str(),ios::in | ios::binary);
+	if (file.fail())
+		return false;
+
+	// read the whole file at once and parse from memory
+	file.seekg(0,ios::end);
+	streamoff length = file.tellg();
+	file.seekg(0,ios::beg);
+	if (length < 4)
+		return false;
+	vector<char> buffer(length);
+	file.read(&buffer[0],length);
+	if (file.gcount() != length)
+		return false;
+	file.close();
+
+	size_t pos = 4;
+	Uint32 version, modified, size, warnings, fieldCount;
+	if (memcmp(&buffer[0],COMPILED_LEVEL_MAGIC,4) != 0 ||
+			not readUint32(buffer,pos,version) || version != COMPILED_LEVEL_VERSION ||
+			not readUint32(buffer,pos,modified) || modified != (Uint32)data.modified ||
+			not readUint32(buffer,pos,size) || size != (Uint32)data.size ||
+			not readUint32(buffer,pos,warnings) || not readUint32(buffer,pos,fieldCount) ||
+			fieldCount > (buffer.size() - pos) / COMPILED_FIELD_SIZE)
+		return false;
+
+	data.warnings = warnings;
+	data.fields.clear();
+	data.fields.resize(fieldCount);
+	for (vector<LevelField>::iterator field = data.fields.begin(); field != data.fields.end(); ++field)
+	{
+		Uint32 lineNumber, paramCount;
+		if (not readString(buffer,pos,field->name) || not readUint32(buffer,pos,lineNumber) ||
+				not readUint32(buffer,pos,paramCount) || paramCount > (buffer.size() - pos) / COMPILED_PARAM_SIZE)
+			return false;
+		field->ident = dataIdents[field->name];
+		field->lineNumber = lineNumber;
+		for (Uint32 I = 0; I < paramCount; ++I)
+		{
+			PARAMETER_TYPE param;
+			if (not readString(buffer,pos,param.first) || not readString(buffer,pos,param.second))
+				return false;
+			field->params.push_back(param);
+		}
+	}
+
+	return pos == buffer.size();
+}
+
+void LevelLoader::writeCompiledLevel(CRstring filename, const LevelData& data) const
+{
+	// might fail on read-only installations, the level then just gets parsed
+	// from text every time the game is started
+	ofstream file((filename + COMPILED_LEVEL_EXTENSION).c_str(),ios::out | ios::binary | ios::trunc);
+	if (file.fail())
+		return;
+
+	file.write(COMPILED_LEVEL_MAGIC,4);
+	writeUint32(file,COMPILED_LEVEL_VERSION);
+	writeUint32(file,data.modified);
+	writeUint32(file,data.size);
+	writeUint32(file,data.warnings);
+	writeUint32(file,data.fields.size());
+	for (vector<LevelField>::const_iterator field = data.fields.begin(); field != data.fields.end(); ++field)
+	{
+		writeString(file,field->name);
+		writeUint32(file,field->lineNumber);
+		writeUint32(file,field->params.size());
+		for (list<PARAMETER_TYPE >::const_iterator param = field->params.begin(); param != field->params.end(); ++param)
+		{
+			writeString(file,param->first);
+			writeString(file,param->second);
+		}
+	}
+	file.close();
+}
@@ -26,6 +26,12 @@
 #define LEVELLOADER_H
 
 #include <list>
+#include <istream>
+#include <vector>
+#include <map>
+#include <time.h>
+#include <SDL/SDL_mutex.h>
+#include <SDL/SDL_thread.h>
 
 #include "PenjinTypes.h"
 
@@ -55,8 +61,26 @@ public:
 
 // parses a level file and sets a level object accordingly (creates units, etc.)
 // returns a pointer to the created level object or NULL on failure
+// the parsed file is cached in memory and in a compiled file next to it, so
+// loading it again skips reading and tokenising the text
+// thread-safe, loads one level at a time
 	Level* loadLevelFromFile(CRstring filename, CRstring chapterPath="");
 
+// held while loading a level, lock it to init and update a level outside the
+// main thread as these touch global state (Physics, the surface cache, ...)
+// recursive, so loadLevelFromFile can be called while holding it
+	void lock();
+	void unlock();
+
+// parses a level file and decodes its images and sounds into the caches in a
+// separate thread, so a following loadLevelFromFile of it does not stall
+// (used to load the next level of a chapter while the current one is played)
+// a previous prefetch is cancelled
+	void prefetchLevel(CRstring filename, CRstring chapterPath="");
+// waits for a running prefetch to finish, if cancel is true it stops after
+// the file or image currently being loaded
+	void finishPrefetch(CRbool cancel=false);
+
 // Creates a level object amd load parameters such as flags, image, etc.
 // parameter loading depending on Level::load implementation
 	Level* createLevel(list<PARAMETER_TYPE >& params, CRstring chapterPath, CRint lineNumber=-1);
@@ -82,6 +106,55 @@ public:
 		ecFile
 	};
 
+private:
+	// a [field] of a level file with its key=value pairs (class first)
+	struct LevelField
+	{
+		string name;
+		int ident; // DataIdent resolved from the name
+		int lineNumber; // last line of the field, for error output
+		list<PARAMETER_TYPE > params;
+	};
+	// all fields of a level file in order
+	struct LevelData
+	{
+		time_t modified; // of the text file the data was parsed from
+		long size;
+		bool warnings; // minor errors while parsing
+		vector<LevelField> fields;
+	};
+
+// returns the parsed fields of a level file (from the memory cache, an asset
+// pack, the compiled file or the text file, whichever is up-to-date and
+// available first)
+// data is only set if the returned code is not ecCritical or ecFile
+	ErrorCode getLevelData(CRstring filename, const LevelData*& data);
+// reads a text level file (from disk or an asset pack)
+	ErrorCode parseLevelFile(istream& file, LevelData& data);
+// returns false if the compiled file does not exist, is broken or outdated
+	bool readCompiledLevel(CRstring filename, LevelData& data) const;
+	void writeCompiledLevel(CRstring filename, const LevelData& data) const;
+// does the actual work for loadLevelFromFile without locking
+	Level* loadLevel(CRstring filename, CRstring chapterPath);
+// thread function of prefetchLevel, data is the LevelLoader
+	static int prefetch(void* data);
+// reads abortPrefetch while holding the lock
+	bool isPrefetchAborted();
+// unpins the images of the last prefetch in the surface cache (with lock held)
+	void releasePrefetched();
+
+	// guarded by mutex, as are errorString and the created level until it
+	// has been initialised, cleared when LEVEL_CACHE_SIZE is reached
+	map<string,LevelData> levelCache;
+	SDL_mutex* mutex;
+
+	SDL_Thread* prefetchThread;
+	string prefetchFile;
+	string prefetchPath;
+	bool abortPrefetch; // guarded by mutex once the thread is running
+	// images decoded by the prefetch, pinned in the surface cache until the
+	// prefetched level has been loaded or the prefetch is cancelled
+	vector<SDL_Surface*> prefetchedImages;
 };
 
 #endif // LEVELLOADER_H
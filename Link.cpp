@@ -99,6 +99,20 @@ void Link::render(SDL_Surface* screen)
 	line.render(screen);
 }
 
+SDL_Rect Link::getRect() const
+{
+	SDL_Rect result = {0,0,0,0};
+	if (!source || !target)
+		return result;
+	Vector2df start = source->getPixel(diMIDDLE) - parent->drawOffset;
+	Vector2df end = target->getPixel(diMIDDLE) - parent->drawOffset;
+	result.x = min(start.x,end.x) - 1;
+	result.y = min(start.y,end.y) - 1;
+	result.w = abs(end.x - start.x) + 3;
+	result.h = abs(end.y - start.y) + 3;
+	return result;
+}
+
 ///--- PROTECTED ---------------------------------------------------------------
 
 ///--- PRIVATE -----------------------------------------------------------------
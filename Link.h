@@ -41,6 +41,8 @@ public:
 	void update();
 	void remove();
 	void render(SDL_Surface *screen);
+	// screen area covered by the line
+	SDL_Rect getRect() const;
 
 	BaseUnit *source;
 	BaseUnit *target;
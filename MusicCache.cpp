@@ -43,6 +43,7 @@ MusicCache::MusicCache()
 	musicVolume = MIX_MAX_VOLUME;
 	setMusicVolume(musicVolume);
 	fadeThread = NULL;
+	cacheLock = SDL_CreateMutex();
 }
 
 MusicCache::~MusicCache()
@@ -53,6 +54,7 @@ MusicCache::~MusicCache()
 	stopMusic();
 	stopSounds();
 	clear();
+	SDL_DestroyMutex(cacheLock);
 }
 
 MusicCache* MusicCache::getMusicCache()
@@ -66,8 +68,7 @@ MusicCache* MusicCache::getMusicCache()
 
 bool MusicCache::playMusic(CRstring filename, CRbool suppressOutput)
 {
-	map<string,Music*>::iterator iter = music.find(filename);
-
+	// wait first, the fade thread needs the lock, too
 	int* result = NULL;
 	if (fadeThread)
 	{
@@ -75,7 +76,12 @@ bool MusicCache::playMusic(CRstring filename, CRbool suppressOutput)
 		fadeThread = NULL;
 	}
 
-	if (iter != music.end()) // found in cache
+	SDL_mutexP(cacheLock);
+	map<string,Music*>::iterator iter = music.find(filename);
+	bool cached = (iter != music.end());
+	SDL_mutexV(cacheLock);
+
+	if (cached) // found in cache
 	{
 		if (musicPlaying[0] == 0) // nothing is currently playing
 		{
@@ -107,7 +113,9 @@ bool MusicCache::playMusic(CRstring filename, CRbool suppressOutput)
 			delete temp;
 			return false;
 		}
+		SDL_mutexP(cacheLock);
 		music[filename] = temp;
+		SDL_mutexV(cacheLock);
 		nextTrack = filename;
 		fadeThread = SDL_CreateThread(MusicCache::fadeMusic, temp);
 	}
@@ -134,7 +142,12 @@ bool MusicCache::playMusic(CRstring filename, CRstring pathOverwrite)
 void MusicCache::stopMusic()
 {
 	if (musicPlaying[0] != 0)
-		stop(music.find(musicPlaying)->second);
+	{
+		SDL_mutexP(cacheLock);
+		Music* playing = music.find(musicPlaying)->second;
+		SDL_mutexV(cacheLock);
+		stop(playing);
+	}
 	musicPlaying = "";
 }
 
@@ -150,6 +163,7 @@ void MusicCache::setMusicVolume(int newVol)
 
 bool MusicCache::playSound(CRstring filename, CRint numLoops, CRbool suppressOutput)
 {
+	SDL_mutexP(cacheLock);
 	map<string,Sound*>::iterator iter = sounds.find(filename);
 
 	if (iter != sounds.end()) // found in cache
@@ -169,6 +183,7 @@ bool MusicCache::playSound(CRstring filename, CRint numLoops, CRbool suppressOut
 			if (not suppressOutput)
 				printf("ERROR loading sound \"%s\": %s\n",filename.c_str(),Mix_GetError());
 			delete temp;
+			SDL_mutexV(cacheLock);
 			return false;
 		}
 
@@ -177,6 +192,7 @@ bool MusicCache::playSound(CRstring filename, CRint numLoops, CRbool suppressOut
 		temp->play(numLoops);
 		temp->setVolume(soundVolume);
 	}
+	SDL_mutexV(cacheLock);
 
 	return true;
 }
@@ -196,12 +212,39 @@ bool MusicCache::playSound(CRstring filename, CRstring pathOverwrite, CRint numL
 	return true;
 }
 
+bool MusicCache::loadSound(CRstring filename, CRstring pathOverwrite)
+{
+	if (pathOverwrite[0] != 0 && loadSound(pathOverwrite + filename))
+		return true;
+	if (isLoaded(filename))
+		return true;
+
+	// decode without holding the lock, so playing sounds is not blocked
+	Sound* temp = new Sound;
+	if (temp->loadSound(filename) != PENJIN_OK)
+	{
+		delete temp;
+		return false;
+	}
+	temp->setSimultaneousPlay(true);
+
+	SDL_mutexP(cacheLock);
+	if (sounds.find(filename) == sounds.end())
+		sounds[filename] = temp;
+	else // loaded by someone else meanwhile
+		delete temp;
+	SDL_mutexV(cacheLock);
+	return true;
+}
+
 void MusicCache::stopSounds()
 {
+	SDL_mutexP(cacheLock);
 	for(map<string,Sound*>::iterator iter = sounds.begin(); iter != sounds.end(); ++iter)
 	{
 		iter->second->stop();
 	}
+	SDL_mutexV(cacheLock);
 }
 
 void MusicCache::setSoundVolume(int newVol)
@@ -210,11 +253,13 @@ void MusicCache::setSoundVolume(int newVol)
 		newVol = getMaxVolume();
 	else if (newVol < 0)
 		newVol = 0;
+	SDL_mutexP(cacheLock);
 	for(map<string,Sound*>::iterator iter = sounds.begin(); iter != sounds.end(); ++iter)
 	{
 		iter->second->setVolume(newVol);
 	}
 	soundVolume = newVol;
+	SDL_mutexV(cacheLock);
 }
 
 int MusicCache::getMaxVolume() const
@@ -230,6 +275,7 @@ void MusicCache::clear(CRbool clearPlaying)
 
 void MusicCache::clearMusic(CRbool clearPlaying)
 {
+	SDL_mutexP(cacheLock);
 	int musicClear = music.size();
 
 	map<string,Music*> playingM;
@@ -249,10 +295,12 @@ void MusicCache::clearMusic(CRbool clearPlaying)
 	}
 	printf("Cleared music cache - deleted %i music tracks (%i still playing).\n",
 		   musicClear - music.size(),music.size());
+	SDL_mutexV(cacheLock);
 }
 
 void MusicCache::clearSounds(CRbool clearPlaying)
 {
+	SDL_mutexP(cacheLock);
 	int soundClear = sounds.size();
 
 	map<string,Sound*> playingS;
@@ -271,18 +319,16 @@ void MusicCache::clearSounds(CRbool clearPlaying)
 	}
 	printf("Cleared sound cache - deleted %i sounds (%i still playing).\n",
 		   soundClear - sounds.size(),sounds.size());
+	SDL_mutexV(cacheLock);
 }
 
 
 bool MusicCache::isLoaded(CRstring filename) const
 {
-	map<string,Music*>::const_iterator mIter = music.find(filename);
-	if (mIter != music.end())
-		return true;
-	map<string,Sound*>::const_iterator sIter = sounds.find(filename);
-	if (sIter != sounds.end())
-		return true;
-	return false;
+	SDL_mutexP(cacheLock);
+	bool loaded = (music.find(filename) != music.end() || sounds.find(filename) != sounds.end());
+	SDL_mutexV(cacheLock);
+	return loaded;
 }
 
 ///---protected---
@@ -312,7 +358,10 @@ int MusicCache::fadeMusic(void* data)
 	Music* track = (Music*)data;
 	if (MUSIC_CACHE->musicPlaying[0] != 0) // stop current
 	{
-		MUSIC_CACHE->stop(MUSIC_CACHE->music.find(MUSIC_CACHE->musicPlaying)->second);
+		SDL_mutexP(MUSIC_CACHE->cacheLock);
+		Music* playing = MUSIC_CACHE->music.find(MUSIC_CACHE->musicPlaying)->second;
+		SDL_mutexV(MUSIC_CACHE->cacheLock);
+		MUSIC_CACHE->stop(playing);
 	}
 	// play next track
 	MUSIC_CACHE->play(track,MUSIC_CACHE->nextTrack);
@@ -27,6 +27,7 @@
 
 #include <map>
 #include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
 
 #include "PenjinTypes.h"
 class Music;
@@ -41,6 +42,7 @@ Class will only allow one music track to play at the time, so playing a second o
 will stop the first
 Sounds on the other hand will also allow playing of multiple instances of the same
 sound at one time
+Sounds can be loaded in advance from any thread by calling loadSound
 **/
 
 class MusicCache
@@ -61,6 +63,8 @@ public:
 
 	bool playSound(CRstring filename, CRint numLoops = 0, CRbool suppressOutput = false);
 	bool playSound(CRstring filename, CRstring pathOverwrite, CRint numLoops = 0);
+	// loads a sound into the cache without playing it, thread-safe
+	bool loadSound(CRstring filename, CRstring pathOverwrite = "");
 	void stopSounds();
 	void setSoundVolume(int newVol);
 	int getSoundVolume() const {return soundVolume;}
@@ -92,6 +96,7 @@ protected:
 	int musicVolume;
 	SDL_Thread* fadeThread;
 	string nextTrack;
+	SDL_mutex* cacheLock; // guards the music and sounds maps
 private:
 
 };
@@ -30,8 +30,13 @@
 #include "LevelLoader.h"
 #include "Savegame.h"
 #include "Dialogue.h"
+#include "DirtyRects.h"
+#include "Timing.h"
+#include "Profiler.h"
+#include "AssetPack.h"
 
 #include "StringUtility.h"
+#include "Random.h"
 #include "IMG_savepng.h"
 #include <time.h>
 #ifndef _WIN32
@@ -45,6 +50,10 @@
 
 #define SAVE_FILE "save.me"
 #define FPS_FONT_SIZE 24
+#define HEADLESS_SEED 1234
+#define TICK_TIME (1000000 / FRAME_RATE) // in microseconds
+// if a level falls further behind the game slows down instead
+#define MAX_TICKS_PER_FRAME 5
 
 MyGame* MyGame::m_MyGame = NULL;
 
@@ -64,10 +73,16 @@ MyGame::MyGame()
 	restartCounter = 0;
 	icon = NULL;
 	settings = NULL;
-	videoCaptureRunning = false;
-	videoFile = NULL;
-	videoCounter = 0;
 	videoTempCounter = 0;
+	headlessTicks = 0;
+	recordReplays = false;
+	renderRate = FRAME_RATE;
+	fixedTimestep = true;
+	interpolate = false;
+	tickFraction = 1.0f;
+	lastFrameTime = 0;
+	tickAccumulator = 0;
+	flipTime = 0;
 	#ifdef _DEBUG
 	frameAdvance = false;
 	#endif // _DEBUG
@@ -77,9 +92,19 @@ MyGame::~MyGame()
 {
 	SAVEGAME->autoSave = false;
 	delete settings; // this saves
-	SAVEGAME->writeData("restarts",StringUtility::intToString(restartCounter));
-	SAVEGAME->writeData("activechapter",activeChapter,true);
-	SAVEGAME->save();
+	if (not isHeadless()) // simulated resets and wins should not end up in the save file
+	{
+		SAVEGAME->writeData("restarts",StringUtility::intToString(restartCounter));
+		SAVEGAME->writeData("activechapter",activeChapter,true);
+		SAVEGAME->save();
+	}
+	if (PROFILER->isActive())
+	{
+		PROFILER->printSummary();
+		PROFILER->writeTrace();
+	}
+	replay.stop();
+	LEVEL_LOADER->finishPrefetch(true);
 	SURFACE_CACHE->clear();
 	MUSIC_CACHE->clear();
 	SDL_FreeSurface(icon);
@@ -97,7 +122,12 @@ PENJIN_ERRORS MyGame::init()
 			AutoVersion::DATE,AutoVersion::MONTH,AutoVersion::YEAR);
 	setInitialState(STATE_TITLE);
 	gameTimer->start();
-	icon = IMG_Load("images/general/icon_win.png");
+	ASSET_PACK->mount(ASSET_PACK_FILE); // optional
+	SDL_RWops* iconData = ASSET_PACK->openRW("images/general/icon_win.png");
+	if (iconData)
+		icon = IMG_Load_RW(iconData,1);
+	else
+		icon = IMG_Load("images/general/icon_win.png");
 	SDL_WM_SetIcon(icon,NULL);
 	#ifdef _MEOW
 	GFX::setResolution(320,240);
@@ -135,6 +165,14 @@ PENJIN_ERRORS MyGame::init()
 	#else
 		result);
 	#endif
+	if (recordReplays)
+	{
+		#ifdef _WIN32
+		mkdir(REPLAY_FOLDER);
+		#else
+		mkdir(REPLAY_FOLDER, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+		#endif // _WIN32
+	}
 
 #ifdef PENJIN_CALC_FPS
 	fpsDisplay = new Text();
@@ -155,12 +193,24 @@ void MyGame::stateManagement()
 		next = state->getNextState();
 		delete state;
 		state = NULL;
-		SURFACE_CACHE->clear(); // clear all images loaded by previous state
+		// a recording or replay covers one level run
+		replay.stop();
+		// a prefetched level is only needed when continuing the chapter
+		LEVEL_LOADER->finishPrefetch(next != STATE_NEXT);
+		// images of the previous state stay decoded for reuse until the cache runs out of budget
+		SURFACE_CACHE->releaseAll();
 		MUSIC_CACHE->clearMusic(false); // clear all unused music
 	}
 	else // first normal call of the game
 	{
 		next = STATE_TITLE;
+		if (replayFile[0] != 0 && replay.startPlayback(replayFile))
+		{
+			next = STATE_LEVEL;
+			stateParameter = replay.getLevelFile();
+			returnState = STATE_MAIN;
+			timeTrial = replay.getTimeTrial();
+		}
 	}
 
 	if (next == STATE_NEXT)
@@ -218,6 +268,14 @@ void MyGame::stateManagement()
 
 	currentState = next;
 	state = createState(next,stateParameter);
+	// only levels have a fixed timestep, menus run one tick per frame
+	fixedTimestep = true;
+	lastFrameTime = 0;
+	setFrameRate(next == STATE_LEVEL ? renderRate : FRAME_RATE);
+
+	// load the following level of the chapter in the background while this one is played
+	if (next == STATE_LEVEL && currentChapter)
+		LEVEL_LOADER->prefetchLevel(currentChapter->getNextLevel(stateParameter),currentChapter->path);
 }
 
 PENJIN_ERRORS MyGame::argHandler(int argc, char **argv)
@@ -248,6 +306,82 @@ PENJIN_ERRORS MyGame::argHandler(int argc, char **argv)
 					customControlMap = argv[arg+1];
 					break;
 				}
+				//	Headless simulation: -h <ticks> <level> [<level> ...]
+				case 'h':
+				case 'H':
+				{
+					if (arg + 2 >= argc)
+						return PENJIN_INVALID_COMMANDLINE;
+					headlessTicks = StringUtility::stringToInt(argv[++arg]);
+					while (arg + 1 < argc && argv[arg+1][0] != '-')
+						headlessLevels.push_back(argv[++arg]);
+					// no window and no sound, surfaces still work as usual
+					SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+					SDL_putenv((char*)"SDL_AUDIODRIVER=dummy");
+					break;
+				}
+				//	Create asset pack: -k <pack file> <file> [<file> ...]
+				case 'k':
+				case 'K':
+				{
+					if (arg + 2 >= argc)
+						return PENJIN_INVALID_COMMANDLINE;
+					packFile = argv[++arg];
+					while (arg + 1 < argc && argv[arg+1][0] != '-')
+						packFiles.push_back(argv[++arg]);
+					SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+					SDL_putenv((char*)"SDL_AUDIODRIVER=dummy");
+					break;
+				}
+				//	Profiler: -p [<trace file>]
+				case 'p':
+				case 'P':
+				{
+					PROFILER->setActive(true);
+					if (arg + 1 < argc && argv[arg+1][0] != '-')
+						PROFILER->setTraceFile(argv[++arg]);
+					break;
+				}
+				//	Image cache budget: -i <MiB>
+				case 'i':
+				case 'I':
+				{
+					if (arg + 1 >= argc)
+						return PENJIN_INVALID_COMMANDLINE;
+					SURFACE_CACHE->setBudget(StringUtility::stringToInt(argv[++arg]) * 1024 * 1024);
+					break;
+				}
+				//	Record level runs: -r
+				case 'r':
+				case 'R':
+				{
+					recordReplays = true;
+					break;
+				}
+				//	Play replay: -y <replay file>
+				case 'y':
+				case 'Y':
+				{
+					if (arg + 1 >= argc)
+						return PENJIN_INVALID_COMMANDLINE;
+					replayFile = argv[++arg];
+					break;
+				}
+				//	Level render rate: -d <fps> [smooth]
+				//	with "smooth" players and camera are interpolated between ticks
+				case 'd':
+				case 'D':
+				{
+					if (arg + 1 >= argc)
+						return PENJIN_INVALID_COMMANDLINE;
+					renderRate = max(StringUtility::stringToInt(argv[++arg]),1);
+					if (arg + 1 < argc && string(argv[arg+1]) == "smooth")
+					{
+						interpolate = true;
+						++arg;
+					}
+					break;
+				}
 				//	Set Fullscreen
 				case 'f':
 				case 'F':
@@ -310,7 +444,14 @@ bool MyGame::stateLoop()
 
 		// the following will always last at least the time of one frame
 		gameTimer->start();
-		input->update();
+		PROFILER->newFrame();
+		int ticks = countTicks();
+		if (ticks > 0)
+		{
+			replay.beginTick();
+			input->update();
+			replay.endTick();
+		}
 		#ifdef _DEBUG
 		if (input->isKey("f"))
 		{
@@ -328,7 +469,7 @@ bool MyGame::stateLoop()
 		{
 			int result = startVideoCapture();
 			if (result == 0)
-				takeScreenshot(settings->getVideoCompression());
+				videoCapture.addFrame(GFX::getVideoSurface());
 			input->resetKeys();
 		}
 		else if (input->isKey("F9"))
@@ -336,17 +477,15 @@ bool MyGame::stateLoop()
 			stopVideoCapture();
 			input->resetKeys();
 		}
-		else if (videoCaptureRunning)
+		else if (videoCapture.isRunning())
 		{
 			if (--videoTempCounter < 0)
 			{
-				int result = takeScreenshot(settings->getVideoCompression());
+				// only copies the screen, encoding and writing is done by another thread
+				videoCapture.addFrame(GFX::getVideoSurface());
 				videoTempCounter = settings->getVideoFrameskip();
-				if (result != 0)
-				{
-					printf("Error saving screenshot: %s\n", SDL_GetError());
+				if (videoCapture.hasFailed())
 					stopVideoCapture();
-				}
 			}
 		}
 
@@ -390,10 +529,24 @@ bool MyGame::stateLoop()
 				settings->userInput(input);
 				settings->update();
 			}
-			else
+			else if (ticks > 0)
 			{
+				ProfileZone zone(pzUserInput);
 				state->userInput();
+				zone.next(pzUpdate);
 				state->update();
+				// catch up in levels which fell behind, every tick reads input
+				// the same way, so replays are not affected
+				for (int I = 1; I < ticks && not state->getIsPaused() && not state->getNeedInit(); ++I)
+				{
+					zone.next(pzUserInput);
+					replay.beginTick();
+					input->update();
+					replay.endTick();
+					state->userInput();
+					zone.next(pzUpdate);
+					state->update();
+				}
 			}
 			#ifdef USE_ACHIEVEMENTS
 				ACHIEVEMENTS->update();
@@ -402,12 +555,17 @@ bool MyGame::stateLoop()
 			if(state->getNeedInit())
 				return true;
 			//  Render objects
+			ProfileZone renderZone(pzRender);
 			state->render();
+			renderZone.stop();
 			if (settings->isActive())
 			{
 				settings->render(GFX::getVideoSurface());
+				DIRTY_RECTS->invalidate();
 			}
 			#ifdef USE_ACHIEVEMENTS
+				// achievement popups are not tracked
+				DIRTY_RECTS->invalidate();
 				#ifdef PENJIN_SDL
 					ACHIEVEMENTS->render(GFX::getVideoSurface());
 				#else
@@ -435,11 +593,26 @@ bool MyGame::stateLoop()
 		#ifndef PENJIN_ASCII
 			#ifdef PENJIN_CALC_FPS
 			if (settings->getDrawFps())
+			{
 				fpsDisplay->print(StringUtility::intToString(frameCount));
+				SDL_Rect fpsRect = {GFX::getXResolution() - FPS_FONT_SIZE * 2,0,FPS_FONT_SIZE * 2,FPS_FONT_SIZE * 3 / 2};
+				DIRTY_RECTS->addOverlay(fpsRect);
+			}
 			if (settings->getWriteFps())
 				printf("%i\n",frameCount);
 			#endif
-			GFX::forceBlit();
+			if (PROFILER->isActive())
+			{
+				// left of the fps display
+				SDL_Rect graphArea = PROFILER->render(GFX::getVideoSurface(),
+						GFX::getXResolution() - FPS_FONT_SIZE * 2 - PROFILER_HISTORY,0);
+				DIRTY_RECTS->addOverlay(graphArea);
+			}
+			ProfileZone flipZone(pzFlip);
+			Uint64 flipStart = getMicroTicks();
+			DIRTY_RECTS->flip(GFX::getVideoSurface());
+			flipTime = getMicroTicks() - flipStart;
+			flipZone.stop();
 		#endif
 
 		#ifdef PENJIN_CALC_FPS
@@ -455,6 +628,7 @@ bool MyGame::stateLoop()
 	else
 	{
 		// check and change states
+		ProfileZone zone(pzStateManagement);
 		getVariables();
 		stateManagement();
 		setVariables();
@@ -483,6 +657,17 @@ void MyGame::playChapter(CRstring filename, CRint startLevel)
 	delete currentChapter;
 	currentChapter = new Chapter;
 
+	// files in the chapter's pack overlay all others (also the chapter file itself)
+	string pack = filename.substr(0,filename.find_last_of('/')+1) + CHAPTER_PACK_FILE;
+	if (pack != chapterPack)
+	{
+		// no thread may read from the old pack while it is unmapped (the caller
+		// has to stop its own workers before)
+		LEVEL_LOADER->finishPrefetch(true);
+		ASSET_PACK->unmount(chapterPack);
+		chapterPack = ASSET_PACK->mount(pack) ? pack : "";
+	}
+
 	if (not currentChapter->loadFromFile(filename)) // on error
 	{
 		stateParameter = currentChapter->errorString;
@@ -524,6 +709,48 @@ string MyGame::ticksToTimeString(CRint ticks)
 	return (m + s.substr(s.length()-2,2) + "''" + cs.substr(cs.length()-2,2));
 }
 
+int MyGame::runHeadless()
+{
+	SAVEGAME->autoSave = false;
+	currentState = STATE_LEVEL;
+	int failed = 0;
+	for (vector<string>::const_iterator file = headlessLevels.begin(); file != headlessLevels.end(); ++file)
+	{
+		Level* level = LEVEL_LOADER->loadLevelFromFile(*file);
+		if (not level)
+		{
+			printf("ERROR: %s\n",LEVEL_LOADER->errorString.c_str());
+			++failed;
+			continue;
+		}
+		// same run every time, seeded after loading like replays
+		srand(HEADLESS_SEED);
+		Random::setSeed(HEADLESS_SEED);
+		level->init();
+
+		Uint32 start = SDL_GetTicks();
+		for (int I = 0; I < headlessTicks; ++I)
+		{
+			ProfileZone zone(pzUpdate);
+			level->update();
+			zone.stop();
+			PROFILER->newFrame();
+		}
+		Uint32 time = max(SDL_GetTicks() - start,(Uint32)1);
+
+		printf("%s: %i ticks in %i ms (%.1f ticks/s)\n",file->c_str(),headlessTicks,time,
+				(float)headlessTicks * 1000.0f / (float)time);
+		delete level;
+		SURFACE_CACHE->releaseAll();
+	}
+	return failed;
+}
+
+int MyGame::createAssetPack()
+{
+	return AssetPack::create(packFile,packFiles) ? 0 : 1;
+}
+
 void MyGame::startChapterTrial()
 {
 	chapterTrial = true;
@@ -533,26 +760,17 @@ void MyGame::startChapterTrial()
 
 int MyGame::takeScreenshot(int compression)
 {
-	if (videoCaptureRunning)
-	{
-		char file[256];
-		sprintf(file, videoFile, videoCounter++);
-		return takeScreenshot(file, compression);
-	}
-	else
-	{
-		time_t timeval;
-		struct tm *timestruct;
-		time(&timeval);
-		timestruct = localtime(&timeval);
-		char file[256];
-		sprintf(file, "screenshots/shot_%02i%02i%02i_%02i%02i%02i.png",
-				timestruct->tm_year + 1900, timestruct->tm_mon + 1,
-				timestruct->tm_mday, timestruct->tm_hour,
-				timestruct->tm_min, timestruct->tm_sec);
-		printf("Saving screenshot to %s...\n", file);
-		return takeScreenshot(file, compression);
-	}
+	time_t timeval;
+	struct tm *timestruct;
+	time(&timeval);
+	timestruct = localtime(&timeval);
+	char file[256];
+	sprintf(file, "screenshots/shot_%02i%02i%02i_%02i%02i%02i.png",
+			timestruct->tm_year + 1900, timestruct->tm_mon + 1,
+			timestruct->tm_mday, timestruct->tm_hour,
+			timestruct->tm_min, timestruct->tm_sec);
+	printf("Saving screenshot to %s...\n", file);
+	return takeScreenshot(file, compression);
 }
 
 int MyGame::takeScreenshot(char *filename, int compression)
@@ -562,53 +780,60 @@ int MyGame::takeScreenshot(char *filename, int compression)
 
 int MyGame::startVideoCapture()
 {
-	if (videoCaptureRunning)
+	if (videoCapture.isRunning())
 	{
 		printf("Video capture already running!");
 		return -1;
 	}
+	time_t timeval;
 	struct tm *timestruct;
-	time(&videoStart);
-	timestruct = localtime(&videoStart);
-	char *file = new char[256];
-	sprintf(file, "screenshots/video_%02i%02i%02i_%02i%02i%02i",
+	time(&timeval);
+	timestruct = localtime(&timeval);
+	char file[256];
+	sprintf(file, "screenshots/video_%02i%02i%02i_%02i%02i%02i.gvid",
 			timestruct->tm_year + 1900, timestruct->tm_mon + 1,
 			timestruct->tm_mday, timestruct->tm_hour,
 			timestruct->tm_min, timestruct->tm_sec);
-	#ifndef _WIN32
-	int result = mkdir(file, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-	#else
-	int result = mkdir(file);
-	#endif // _WIN32
-	if (result == 0)
-		printf("Video folder created successfully.\n");
-	else
-	{
-		printf("Error creating video folder, error code: %i\n", result);
-		return result;
-	}
-	printf("Starting video capture to folder %s\n", file);
-	sprintf(file, "%s/shot_%s.png", file, "%05i");
-	delete videoFile;
-	videoFile = file;
-	videoCounter = 0;
+	// compression 0 writes raw frames, anything else delta and run length encoded ones
+	if (not videoCapture.start(file, GFX::getVideoSurface(), settings->getVideoCompression() != 0))
+		return -1;
+	printf("Starting video capture to file %s\n", file);
 	videoTempCounter = settings->getVideoFrameskip();
-	videoCaptureRunning = true;
 	return 0;
-
 }
+
 void MyGame::stopVideoCapture()
 {
-	videoCaptureRunning = false;
-	time_t videoEnd;
-	time(&videoEnd);
-	printf("Stopping video capture. recorded %i frames in %i seconds (%.2f fps).\n",
-			videoCounter, videoEnd - videoStart, (float)videoCounter / (float)(videoEnd - videoStart));
+	videoCapture.stop();
 }
 
 
 /// ---private---
 
+int MyGame::countTicks()
+{
+	if (not fixedTimestep || currentState != STATE_LEVEL || state->getIsPaused() || settings->isActive())
+	{
+		lastFrameTime = 0;
+		tickFraction = 1.0f;
+		return 1;
+	}
+
+	Uint64 now = getMicroTicks();
+	if (lastFrameTime == 0) // just entered the level (or resumed), start with a single tick
+		tickAccumulator = TICK_TIME;
+	else
+		tickAccumulator += now - lastFrameTime;
+	lastFrameTime = now;
+
+	int ticks = tickAccumulator / TICK_TIME;
+	tickAccumulator -= ticks * TICK_TIME;
+	if (ticks > MAX_TICKS_PER_FRAME)
+		ticks = MAX_TICKS_PER_FRAME;
+	tickFraction = interpolate ? (float)tickAccumulator / (float)TICK_TIME : 1.0f;
+	return ticks;
+}
+
 BaseState* MyGame::createState(CRuint stateID,CRstring parameter)
 {
 	BaseState* nextState = NULL;
@@ -638,8 +863,14 @@ BaseState* MyGame::createState(CRuint stateID,CRstring parameter)
 #ifdef _DEBUG
 		printf("Level State\n");
 #endif
+	{
+		string chapterPath = "";
 		if (currentChapter)
-			nextState = LEVEL_LOADER->loadLevelFromFile(parameter,currentChapter->path);
+			chapterPath = currentChapter->path;
+		else if (replay.isPlaying())
+			chapterPath = replay.getChapterPath();
+		if (not chapterPath.empty())
+			nextState = LEVEL_LOADER->loadLevelFromFile(parameter,chapterPath);
 		else
 			nextState = LEVEL_LOADER->loadLevelFromFile(parameter);
 		if (not nextState)
@@ -648,7 +879,25 @@ BaseState* MyGame::createState(CRuint stateID,CRstring parameter)
 			string e = "ERROR: " + LEVEL_LOADER->errorString;
 			return createState(STATE_ERROR,e);
 		}
+		// seed after loading, as particle emitters seed randomly on creation
+		uint seed = replay.isPlaying() ? replay.getSeed() : time(NULL);
+		srand(seed);
+		Random::setSeed(seed);
+		if (recordReplays)
+		{
+			time_t timeval;
+			struct tm *timestruct;
+			time(&timeval);
+			timestruct = localtime(&timeval);
+			char file[256];
+			sprintf(file, REPLAY_FOLDER "replay_%02i%02i%02i_%02i%02i%02i" REPLAY_EXTENSION,
+					timestruct->tm_year + 1900, timestruct->tm_mon + 1,
+					timestruct->tm_mday, timestruct->tm_hour,
+					timestruct->tm_min, timestruct->tm_sec);
+			replay.startRecording(file,parameter,chapterPath,seed,timeTrial || chapterTrial);
+		}
 		break;
+	}
 	case STATE_BENCHMARK:
 #ifdef _DEBUG
 		printf("Benchmark started\n");
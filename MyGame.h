@@ -30,6 +30,8 @@
 #include "Text.h"
 #include "Chapter.h"
 #include "Settings.h"
+#include "VideoCapture.h"
+#include "InputReplay.h"
 
 #include "gameDefines.h"
 
@@ -69,15 +71,31 @@ class MyGame : public Engine
 
 		void startChapterTrial();
 
+		// updates the levels passed with -h for a fixed number of ticks without
+		// drawing anything and prints the update throughput
+		// returns the number of levels which could not be loaded
+		int runHeadless();
+		bool isHeadless() const {return not headlessLevels.empty();}
+
+		// writes the files passed with -k to a new asset pack
+		// returns 0 on success
+		int createAssetPack();
+		bool isPacking() const {return packFile[0] != 0;}
+
 		int takeScreenshot(int compression = -1);
 		int takeScreenshot(char *filename, int compression = -1);
 		int startVideoCapture();
 		void stopVideoCapture();
-		bool videoCaptureRunning;
-		char *videoFile;
-		int videoCounter;
-		int videoTempCounter;
-		time_t videoStart;
+		VideoCapture videoCapture;
+		int videoTempCounter; // frames to skip until the next capture
+		// levels always update at FRAME_RATE ticks per second, but are drawn at
+		// renderRate frames per second, so a frame may run zero or several ticks
+		uint renderRate;
+		bool fixedTimestep; // if false every frame is one tick (debug fast forward)
+		bool interpolate; // draw players and camera between the last two ticks
+		float tickFraction; // time passed towards the next tick (0-1), 1 when not interpolating
+		InputReplay replay;
+		Uint64 flipTime; // time needed for the last screen update in microseconds
 
 		string stateParameter; // this might be the current level filename or an error string
 		Chapter* currentChapter;
@@ -101,9 +119,24 @@ class MyGame : public Engine
 	private:
 		// creates a state from a defined set, gets called by MyGame::stateManangement()
 		BaseState* createState(CRuint stateID, CRstring parameter="");
+		// returns the number of ticks to run this frame, one unless in a level
+		int countTicks();
+
+		Uint64 lastFrameTime; // 0 restarts the tick accumulator
+		Uint64 tickAccumulator; // time not yet simulated in microseconds
 
 		SDL_Surface* icon;
 
+		vector<string> headlessLevels;
+		int headlessTicks;
+
+		string packFile;
+		vector<string> packFiles;
+		string chapterPack; // currently mounted overlay
+
+		bool recordReplays; // every level run is recorded to REPLAY_FOLDER
+		string replayFile; // played back instead of showing the title
+
 };
 
 
@@ -29,6 +29,19 @@
 #include "Level.h"
 #include "MyGame.h"
 
+const KeywordTable ParticleEmitter::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("direction",epDirection)
+	.add("power",epPower)
+	.add("lifetime",epLifetime)
+	.add("delay",epDelay)
+	.add("directionscatter",epDirectionScatter)
+	.add("powerscatter",epPowerScatter)
+	.add("lifetimescatter",epLifetimeScatter)
+	.add("delayscatter",epDelayScatter)
+	.add("enabled",epEnabled)
+	.add("multiplier",epMultiplier)
+	.add("centred",epCentred);
+
 ParticleEmitter::ParticleEmitter( Level *newParent ) :
 	BaseUnit(newParent),
 	particleTimer(0),
@@ -49,18 +62,6 @@ ParticleEmitter::ParticleEmitter( Level *newParent ) :
 	#endif // _DEBUG
 	unitCollisionMode = 0;
 
-	stringToProp["direction"] = epDirection;
-	stringToProp["power"] = epPower;
-	stringToProp["lifetime"] = epLifetime;
-	stringToProp["delay"] = epDelay;
-	stringToProp["directionscatter"] = epDirectionScatter;
-	stringToProp["powerscatter"] = epPowerScatter;
-	stringToProp["lifetimescatter"] = epLifetimeScatter;
-	stringToProp["delayscatter"] = epDelayScatter;
-	stringToProp["enabled"] = epEnabled;
-	stringToProp["multiplier"] = epMultiplier;
-	stringToProp["centred"] = epCentred;
-
 	Random::randSeed();
 }
 
@@ -70,6 +70,8 @@ protected:
 		epCentred,
 		epEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 private:
 
 };
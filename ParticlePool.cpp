@@ -0,0 +1,247 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "ParticlePool.h"
+
+#include <cstring>
+
+ParticlePool::ParticlePool()
+{
+	lastMask = -1;
+}
+
+ParticlePool::~ParticlePool()
+{
+	clear();
+}
+
+void ParticlePool::reserve(CRint count)
+{
+	posX.reserve(count);
+	posY.reserve(count);
+	velX.reserve(count);
+	velY.reserve(count);
+	colour.reserve(count);
+	colourID.reserve(count);
+	life.reserve(count);
+	maskIndex.reserve(count);
+}
+
+void ParticlePool::clear()
+{
+	posX.clear();
+	posY.clear();
+	velX.clear();
+	velY.clear();
+	colour.clear();
+	colourID.clear();
+	life.clear();
+	maskIndex.clear();
+	masks.clear();
+	maskUsers.clear();
+	freeMasks.clear();
+	lastMask = -1;
+}
+
+void ParticlePool::add(const Vector2df& pos, const Vector2df& vel, const Colour& col, const Uint8& colourID, CRint lifeTime, CRint mask)
+{
+	posX.push_back(pos.x);
+	posY.push_back(pos.y);
+	velX.push_back(vel.x);
+	velY.push_back(vel.y);
+	colour.push_back(col.getIntColour());
+	this->colourID.push_back(colourID);
+	life.push_back(lifeTime);
+	maskIndex.push_back(mask);
+	++maskUsers[mask];
+}
+
+int ParticlePool::addMask(const CollisionMask& mask)
+{
+	if (lastMask >= 0)
+	{
+		if (memcmp(&masks[lastMask],&mask,sizeof(CollisionMask)) == 0)
+			return lastMask;
+		// no particle was added with the last mask, so just overwrite it
+		if (maskUsers[lastMask] == 0)
+		{
+			masks[lastMask] = mask;
+			return lastMask;
+		}
+	}
+
+	if (freeMasks.empty())
+	{
+		masks.push_back(mask);
+		maskUsers.push_back(0);
+		lastMask = masks.size() - 1;
+	}
+	else
+	{
+		lastMask = freeMasks.back();
+		freeMasks.pop_back();
+		masks[lastMask] = mask;
+	}
+	return lastMask;
+}
+
+void ParticlePool::removeDead()
+{
+	for (int I = 0; I < size();)
+	{
+		if (life[I] >= 0)
+		{
+			++I;
+			continue;
+		}
+
+		releaseMask(maskIndex[I]);
+		int last = size() - 1;
+		posX[I] = posX[last];
+		posY[I] = posY[last];
+		velX[I] = velX[last];
+		velY[I] = velY[last];
+		colour[I] = colour[last];
+		colourID[I] = colourID[last];
+		life[I] = life[last];
+		maskIndex[I] = maskIndex[last];
+		posX.pop_back();
+		posY.pop_back();
+		velX.pop_back();
+		velY.pop_back();
+		colour.pop_back();
+		colourID.pop_back();
+		life.pop_back();
+		maskIndex.pop_back();
+	}
+}
+
+void ParticlePool::update()
+{
+	const int count = size();
+	for (int I = 0; I < count; ++I)
+	{
+		if (life[I] > 0)
+			--life[I];
+		else
+			life[I] = -1;
+	}
+	for (int I = 0; I < count; ++I)
+	{
+		posX[I] += velX[I];
+		posY[I] += velY[I];
+	}
+}
+
+void ParticlePool::render(SDL_Surface* const screen, const Vector2df& offset, SDL_Rect* const bounds) const
+{
+	if (bounds)
+	{
+		bounds->x = 0;
+		bounds->y = 0;
+		bounds->w = 0;
+		bounds->h = 0;
+	}
+	const int count = size();
+	if (count == 0)
+		return;
+
+	if (SDL_MUSTLOCK(screen))
+		SDL_LockSurface(screen);
+	const int bpp = screen->format->BytesPerPixel;
+	int lastColour = -1;
+	Uint32 pixel = 0;
+	int minX = screen->w;
+	int minY = screen->h;
+	int maxX = -1;
+	int maxY = -1;
+	for (int I = 0; I < count; ++I)
+	{
+		int X = posX[I] - offset.x;
+		int Y = posY[I] - offset.y;
+		if (X < 0 || Y < 0 || X >= screen->w || Y >= screen->h)
+			continue;
+		minX = min(minX,X);
+		minY = min(minY,Y);
+		maxX = max(maxX,X);
+		maxY = max(maxY,Y);
+
+		// explosions create lots of particles of the same colour in a row
+		if (colour[I] != lastColour)
+		{
+			lastColour = colour[I];
+			pixel = SDL_MapRGB(screen->format,(lastColour >> 16) & 0xff,(lastColour >> 8) & 0xff,lastColour & 0xff);
+		}
+
+		Uint8 *p = (Uint8 *)screen->pixels + Y * screen->pitch + X * bpp;
+		switch(bpp)
+		{
+		case 1:
+			*p = pixel;
+			break;
+		case 2:
+			*(Uint16 *)p = pixel;
+			break;
+		case 3:
+			if(SDL_BYTEORDER == SDL_BIG_ENDIAN)
+			{
+				p[0] = (pixel >> 16) & 0xff;
+				p[1] = (pixel >> 8) & 0xff;
+				p[2] = pixel & 0xff;
+			}
+			else
+			{
+				p[0] = pixel & 0xff;
+				p[1] = (pixel >> 8) & 0xff;
+				p[2] = (pixel >> 16) & 0xff;
+			}
+			break;
+		case 4:
+			*(Uint32 *)p = pixel;
+			break;
+		}
+	}
+	if (SDL_MUSTLOCK(screen))
+		SDL_UnlockSurface(screen);
+
+	if (bounds && maxX >= 0)
+	{
+		bounds->x = minX;
+		bounds->y = minY;
+		bounds->w = maxX - minX + 1;
+		bounds->h = maxY - minY + 1;
+	}
+}
+
+///---protected---
+
+void ParticlePool::releaseMask(CRint mask)
+{
+	if (--maskUsers[mask] > 0)
+		return;
+
+	freeMasks.push_back(mask);
+	if (mask == lastMask)
+		lastMask = -1;
+}
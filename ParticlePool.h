@@ -0,0 +1,106 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef PARTICLEPOOL_H
+#define PARTICLEPOOL_H
+
+#include <SDL/SDL.h>
+#include <vector>
+
+#include "PenjinTypes.h"
+#include "Vector2df.h"
+#include "Colour.h"
+
+#include "CollisionMap.h"
+
+/**
+Storage for the pixel particles created by exploding units
+Particle data is kept in separate, contiguous arrays (one per property) so the
+physics, update and render loops can run over all particles in one go
+Dead particles get replaced by the last one instead of erasing from the middle,
+so particle order is not preserved
+**/
+
+class ParticlePool
+{
+public:
+	ParticlePool();
+	~ParticlePool();
+
+	void reserve(CRint count);
+	// removes all particles and masks
+	void clear();
+	int size() const {return posX.size();}
+	int capacity() const {return posX.capacity();}
+
+	// adds a particle, mask is an index returned by addMask
+	// colourID is the particle's colour on the collision map (particles collide
+	// with their own colour like units do)
+	void add(const Vector2df& pos, const Vector2df& vel, const Colour& col, const Uint8& colourID, CRint lifeTime, CRint mask);
+	// adds a collision mask and returns its index, consecutive particles with
+	// the same mask share one entry, it is freed again once its last particle
+	// has been removed
+	int addMask(const CollisionMask& mask);
+
+	// removes particles which have run out of life time
+	void removeDead();
+	// counts down life time and moves all particles by their velocity
+	void update();
+	// draws all particles as single pixels, offset is subtracted from the position
+	// if bounds is passed it is set to the area covered by the drawn particles
+	void render(SDL_Surface* const screen, const Vector2df& offset, SDL_Rect* const bounds = NULL) const;
+
+	// whether the particle collides with the passed colour ID
+	inline bool checkCollisionID(CRint index, const Uint8& id) const
+	{
+		return (id != COLOUR_ID_NONE && id == colourID[index]) || masks[maskIndex[index]].test(id);
+	}
+	// changes the velocity according to the map collision correction
+	inline void hitMap(CRint index, const float& correctionX, const float& correctionY)
+	{
+		if (abs(correctionX) > abs(correctionY))
+			velX[index] *= -1;
+		else if (correctionY != 0)
+			velY[index] *= -0.5;
+	}
+
+	vector<float> posX;
+	vector<float> posY;
+	vector<float> velX;
+	vector<float> velY;
+	vector<int> colour; // int colour (see Colour::getIntColour)
+	vector<Uint8> colourID;
+	vector<int> life; // ticks left, -1 = dead (removed on next removeDead call)
+	vector<int> maskIndex;
+	vector<CollisionMask> masks;
+protected:
+	// removes a particle's reference on its mask, frees the mask if unused
+	void releaseMask(CRint mask);
+
+	vector<int> maskUsers; // number of particles using each mask
+	vector<int> freeMasks; // indices of unused entries in masks
+	int lastMask; // index of the last added mask, -1 if none
+};
+
+#endif // PARTICLEPOOL_H
@@ -24,6 +24,12 @@
 
 #include "Physics.h"
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "SimpleDirection.h"
 #include "Colour.h"
 #include "NumberUtility.h"
@@ -32,6 +38,8 @@
 
 #include "BaseUnit.h"
 #include "Level.h"
+#include "CollisionMap.h"
+#include "ParticlePool.h"
 
 // you can do funky horizontal gravity, but the collision checking would need some tinkering to make it work
 // it currently checks the y-directions last for a reason...
@@ -44,6 +52,8 @@ Physics::Physics()
 {
 	gravity = DEFAULT_GRAVITY;
 	maximum = DEFAULT_MAXIMUM;
+	vectorise = true;
+	continuous = false;
 
 	checkPointsX.push_back(diTOPLEFT);
 	checkPointsX.push_back(diTOPRIGHT);
@@ -74,55 +84,74 @@ void Physics::reset()
 {
 	gravity = DEFAULT_GRAVITY;
 	maximum = DEFAULT_MAXIMUM;
+	continuous = false;
 }
 
 void Physics::applyPhysics(BaseUnit* const unit) const
+{
+	applyPhysics(*unit->body);
+}
+
+void Physics::applyPhysics(UnitBody& body) const
 {
 	// Acceleration
-	if (unit->acceleration[0].x > 0.0f)
+	if (body.acceleration[0].x > 0.0f)
 	{
-		unit->velocity.x += min(max(unit->acceleration[1].x - unit->velocity.x,0.0f),unit->acceleration[0].x);
+		body.velocity.x += min(max(body.acceleration[1].x - body.velocity.x,0.0f),body.acceleration[0].x);
 	}
-	else if (unit->acceleration[0].x < 0.0f)
+	else if (body.acceleration[0].x < 0.0f)
 	{
-		unit->velocity.x += max(min(unit->acceleration[1].x - unit->velocity.x,0.0f),unit->acceleration[0].x);
+		body.velocity.x += max(min(body.acceleration[1].x - body.velocity.x,0.0f),body.acceleration[0].x);
 	}
-	if (unit->acceleration[0].y > 0.0f)
+	if (body.acceleration[0].y > 0.0f)
 	{
-		unit->velocity.y += min(max(unit->acceleration[1].y - unit->velocity.y,0.0f),unit->acceleration[0].y);
+		body.velocity.y += min(max(body.acceleration[1].y - body.velocity.y,0.0f),body.acceleration[0].y);
 	}
-	else if (unit->acceleration[0].y < 0.0f)
+	else if (body.acceleration[0].y < 0.0f)
 	{
-		unit->velocity.y += max(min(unit->acceleration[1].y - unit->velocity.y,0.0f),unit->acceleration[0].y);
+		body.velocity.y += max(min(body.acceleration[1].y - body.velocity.y,0.0f),body.acceleration[0].y);
 	}
 
 	// Reset acceleration
-	if (unit->velocity.x == unit->acceleration[1].x)
+	if (body.velocity.x == body.acceleration[1].x)
 	{
-		unit->acceleration[0].x = 0.0f;
-		unit->acceleration[1].x = 0.0f;
+		body.acceleration[0].x = 0.0f;
+		body.acceleration[1].x = 0.0f;
 	}
-	if (unit->velocity.y == unit->acceleration[1].y)
+	if (body.velocity.y == body.acceleration[1].y)
 	{
-		unit->acceleration[0].y = 0.0f;
-		unit->acceleration[1].y = 0.0f;
+		body.acceleration[0].y = 0.0f;
+		body.acceleration[1].y = 0.0f;
 	}
 
 	// Gravity
-	if (not unit->flags.hasFlag(BaseUnit::ufNoGravity))
+	if (not body.flags.hasFlag(BaseUnit::ufNoGravity))
 	{
-		unit->velocity += gravity;
+		body.velocity += gravity;
 	}
 
 	// Check for max
-	if ( unit->velocity.x > maximum.x )
-		unit->velocity.x = maximum.x;
-	else if ( unit->velocity.x < -maximum.x )
-		unit->velocity.x = -maximum.x;
-	if ( unit->velocity.y > maximum.y )
-		unit->velocity.y = maximum.y;
-	else if ( unit->velocity.y < -maximum.y )
-		unit->velocity.y = -maximum.y;
+	if ( body.velocity.x > maximum.x )
+		body.velocity.x = maximum.x;
+	else if ( body.velocity.x < -maximum.x )
+		body.velocity.x = -maximum.x;
+	if ( body.velocity.y > maximum.y )
+		body.velocity.y = maximum.y;
+	else if ( body.velocity.y < -maximum.y )
+		body.velocity.y = -maximum.y;
+}
+
+void Physics::applyPhysics(UnitBodyPool* const bodies) const
+{
+	for (vector<UnitBody*>::const_iterator block = bodies->blocks.begin(); block != bodies->blocks.end(); ++block)
+	{
+		UnitBody* const end = (*block) + UNIT_BODY_BLOCK_SIZE;
+		for (UnitBody* body = *block; body != end; ++body)
+		{
+			if (body->simulated)
+				applyPhysics(*body);
+		}
+	}
 }
 
 /** NOTICE:
@@ -130,22 +159,27 @@ New implementation, checking each direction of movement individually. This keeps
 the correction of gravity induced movement separate from sideways movement
 correction, which is desired in platformers. (assuming gravity in y-direction)
 **/
-void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colImage, BaseUnit* const unit, const Vector2df& mapOffset) const
+void Physics::unitMapCollision(const Level* const level, const CollisionMap* const colMap, BaseUnit* const unit, const Vector2df& mapOffset) const
 {
 	/// TODO: Implement step-size and check diBOTTOMLEFT and -RIGHT in x-direction, too
 	/// compare to y-correction values and step-size
 	/// TODO: Take the unit's velocity into account when returning correction value, so sub-pixel movements get corrected properly
 
-	static vector<MapCollisionEntry> collisionDir;
-	collisionDir.clear();
+	// not static, preview workers run this for their own levels at the same time
+	vector<MapCollisionEntry> collisionDir;
+	unit->updateCollisionMask(colMap);
 	Vector2df correction(0,0);
 	Vector2di pixelCorrection(0,0); // unit will be moved by this step until no collision occurs
-	Colour colColour; // the colour taken from the collision surface at the tested point
+	Uint8 colID; // the colour ID taken from the collision map at the tested point
 	Vector2df pixel(0,0); // currently tested pixel
 
 	/// x-direction
+	int sweepCorrection = 0;
+	// without continuous set only units which would skip their own size are swept
+	bool swept = (continuous || fabs(unit->velocity.x) > unit->getWidth()) &&
+			sweepEdge(level,colMap,unit,unit->position + unit->collisionInfo.positionCorrection,true,sweepCorrection,collisionDir);
 	// check which pixels are colliding
-	for (vector<SimpleDirection>::const_iterator dir = checkPointsX.begin(); dir != checkPointsX.end(); ++dir)
+	for (vector<SimpleDirection>::const_iterator dir = checkPointsX.begin(); dir != checkPointsX.end() && not swept; ++dir)
 	{
 		pixel = unit->getPixel((*dir));
 		pixel.x += unit->velocity.x;
@@ -153,18 +187,18 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 		pixel = level->transformCoordinate(pixel);
 
 		// out of bounds check
-		if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colImage->w || pixel.y >= colImage->h)
+		if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colMap->getWidth() || pixel.y >= colMap->getHeight())
 			continue;
 
-		colColour = GFX::getPixel(colImage,pixel.x,pixel.y);
+		colID = colMap->getID(pixel.x,pixel.y);
 
-		if (unit->checkCollisionColour(colColour))
+		if (unit->collisionMask.test(colID))
 		{
 			// we have a collision
 			MapCollisionEntry entry;
 			entry.dir = (*dir);
 			entry.pos = pixel;
-			entry.col = colColour;
+			entry.col = colMap->getColour(colID);
 			entry.correction = Vector2df(0,0);
 			collisionDir.push_back(entry);
 			int temp = dir->xDirection();
@@ -176,7 +210,7 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 
 	// move unit until the collision is solved (maximum by unit's velocity as we
 	// are assuming the unit was in a no-collision state before)
-	bool stillColliding = (!collisionDir.empty()); // don't check when there are no colliding pixels
+	bool stillColliding = (!swept && !collisionDir.empty()); // don't check when there are no colliding pixels
 	int correctionX = 0; // total correction to solve collision in this direction
 	while (stillColliding && abs(correctionX) <= maximum.x)
 	{
@@ -188,18 +222,20 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 			pixel = entryPtr->pos;
 			pixel.x += correctionX;
 			pixel = level->transformCoordinate(pixel);
-			if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colImage->w || pixel.y >= colImage->h)
+			if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colMap->getWidth() || pixel.y >= colMap->getHeight())
 				continue;
 
-			colColour = GFX::getPixel(colImage,pixel.x,pixel.y);
-			if (unit->checkCollisionColour(colColour))
+			colID = colMap->getID(pixel.x,pixel.y);
+			if (unit->collisionMask.test(colID))
 				break;
 		}
 		if (entryPtr == collisionDir.end()) // all pixel have been checked, so no new collision has been found
 			stillColliding = false;
 	}
 
-	if (abs(correctionX) < maximum.x)
+	if (swept)
+		correction.x = sweepCorrection;
+	else if (abs(correctionX) < maximum.x)
 		correction.x = correctionX;
 	unit->collisionInfo.pixels.insert(unit->collisionInfo.pixels.end(),collisionDir.begin(),collisionDir.end());
 
@@ -208,7 +244,11 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 	pixelCorrection = Vector2di(0,0);
 	collisionDir.clear();
 
-	for (vector<SimpleDirection>::const_iterator dir = checkPointsY.begin(); dir != checkPointsY.end(); ++dir)
+	Vector2df start = unit->position + unit->collisionInfo.positionCorrection;
+	start.x += unit->velocity.x + correction.x;
+	swept = (continuous || fabs(unit->velocity.y) > unit->getHeight()) &&
+			sweepEdge(level,colMap,unit,start,false,sweepCorrection,collisionDir);
+	for (vector<SimpleDirection>::const_iterator dir = checkPointsY.begin(); dir != checkPointsY.end() && not swept; ++dir)
 	{
 		pixel = unit->getPixel((*dir));
 		pixel += unit->velocity;
@@ -216,18 +256,18 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 		pixel += unit->collisionInfo.positionCorrection;
 		pixel = level->transformCoordinate(pixel);
 
-		if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colImage->w || pixel.y >= colImage->h)
+		if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colMap->getWidth() || pixel.y >= colMap->getHeight())
 			continue;
 
-		colColour = GFX::getPixel(colImage,pixel.x,pixel.y);
+		colID = colMap->getID(pixel.x,pixel.y);
 
-		if (unit->checkCollisionColour(colColour))
+		if (unit->collisionMask.test(colID))
 		{
 			// we have a collision
 			MapCollisionEntry entry;
 			entry.dir = (*dir);
 			entry.pos = pixel;
-			entry.col = colColour;
+			entry.col = colMap->getColour(colID);
 			entry.correction = Vector2df(0,0);
 			collisionDir.push_back(entry);
 			int temp = dir->yDirection();
@@ -237,7 +277,7 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 		}
 	}
 
-	stillColliding = (!collisionDir.empty()); // don't check when there are no colliding pixels
+	stillColliding = (!swept && !collisionDir.empty()); // don't check when there are no colliding pixels
 	int correctionY = 0; // total correction to solve collision in this direction
 	while (stillColliding && abs(correctionY) <= maximum.y)
 	{
@@ -249,18 +289,18 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 			pixel = entryPtr->pos;
 			pixel.y += correctionY;
 			pixel = level->transformCoordinate(pixel);
-			if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colImage->w || pixel.y >= colImage->h)
+			if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colMap->getWidth() || pixel.y >= colMap->getHeight())
 				continue;
 
-			colColour = GFX::getPixel(colImage,pixel.x,pixel.y);
-			if (unit->checkCollisionColour(colColour))
+			colID = colMap->getID(pixel.x,pixel.y);
+			if (unit->collisionMask.test(colID))
 				break;
 		}
 		if (entryPtr == collisionDir.end()) // all pixel have been checked, so no new collision has been found
 			stillColliding = false;
 	}
 
-	correction.y = correctionY;
+	correction.y = swept ? sweepCorrection : correctionY;
 	unit->collisionInfo.pixels.insert(unit->collisionInfo.pixels.end(),collisionDir.begin(),collisionDir.end());
 
 	unit->collisionInfo.correction = correction;
@@ -268,62 +308,228 @@ void Physics::unitMapCollision(const Level* const level, SDL_Surface* const colI
 	unit->hitMap(correction);
 }
 
-void Physics::particleMapCollision(const Level* const level, SDL_Surface* const colImage, BaseUnit* const particle) const
+bool Physics::sweepEdge(const Level* const level, const CollisionMap* const colMap, BaseUnit* const unit,
+		const Vector2df& start, const bool& horizontal, int& correction, vector<MapCollisionEntry>& hits) const
 {
-	Vector2df proPos = particle->position;
-	Vector2df correction(0,0);
-	Vector2di pixelCorrection(0,0);
-	pixelCorrection.x = NumberUtility::sign(particle->velocity.x) * -1;
-	pixelCorrection.y = NumberUtility::sign(particle->velocity.y) * -1;
+	const float velocity = horizontal ? unit->velocity.x : unit->velocity.y;
+	if (fabs(velocity) < 2.0f) // the sampled check can't skip a pixel line
+		return false;
+	const int dir = NumberUtility::sign(velocity);
+
+	// position of the leading edge on the axis and the range of pixels it spans
+	float edge;
+	int spanStart, spanEnd;
+	if (horizontal)
+	{
+		edge = (dir > 0) ? start.x + unit->getWidth() - 1.0f : start.x;
+		// obstacles in the lower half are steps the y-check lifts the unit onto
+		spanStart = floor(start.y);
+		spanEnd = floor(start.y + unit->getHeight() / 2.0f);
+	}
+	else
+	{
+		edge = (dir > 0) ? start.y + unit->getHeight() - 1.0f : start.y;
+		spanStart = floor(start.x);
+		spanEnd = floor(start.x + unit->getWidth() - 1.0f);
+	}
+	const int first = floor(edge);
+	const int last = floor(edge + velocity);
 
-	// x
-	bool colliding = true;
-	Colour temp;
-	if (pixelCorrection.x != 0)
+	Vector2df pixel(0,0);
+	for (int line = first + dir; line != last + dir; line += dir)
 	{
-		proPos.x += particle->velocity.x;
-		while (colliding && (abs(correction.x) < abs(particle->velocity.x)))
+		for (int K = spanStart; K <= spanEnd; ++K)
 		{
-			if (proPos.x + correction.x < 0 || proPos.y < 0 || proPos.x + correction.x >= colImage->w || proPos.y >= colImage->h)
-				break;
+			pixel = horizontal ? Vector2df(line,K) : Vector2df(K,line);
+			pixel = level->transformCoordinate(pixel);
+			if (pixel.x < 0 || pixel.y < 0 || pixel.x >= colMap->getWidth() || pixel.y >= colMap->getHeight())
+				continue;
 
-			temp = GFX::getPixel(colImage,proPos.x + correction.x, proPos.y);
+			Uint8 colID = colMap->getID(pixel.x,pixel.y);
+			if (not unit->collisionMask.test(colID))
+				continue;
 
-			if (particle->checkCollisionColour(temp)) // collision
+			// directions as used by the sampled check (corners and centre of the edge)
+			MapCollisionEntry entry;
+			if (horizontal)
 			{
-				correction.x += pixelCorrection.x;
+				if (K == spanStart)
+					entry.dir = (dir > 0) ? diTOPRIGHT : diTOPLEFT;
+				else
+					entry.dir = (dir > 0) ? diRIGHT : diLEFT;
 			}
 			else
 			{
-				colliding = false;
+				if (K == spanStart)
+					entry.dir = (dir > 0) ? diBOTTOMLEFT : diTOPLEFT;
+				else if (K == spanEnd)
+					entry.dir = (dir > 0) ? diBOTTOMRIGHT : diTOPRIGHT;
+				else
+					entry.dir = (dir > 0) ? diBOTTOM : diTOP;
+			}
+			entry.pos = pixel;
+			entry.col = colMap->getColour(colID);
+			entry.correction = Vector2df(0,0);
+			hits.push_back(entry);
+		}
+
+		if (not hits.empty())
+		{
+			if (line == first + dir)
+			{
+				hits.clear();
+				return false;
 			}
+			correction = line - dir - last;
+			return true;
 		}
-		proPos.x -= particle->velocity.x;
 	}
-	// y
-	if (pixelCorrection.y != 0)
+	return false;
+}
+
+void Physics::particlePhysics(const CollisionMap* const colMap, ParticlePool* const particles) const
+{
+	const int count = particles->size();
+	int I = 0;
+
+	// gravity and maximum (particles never accelerate and always have gravity)
+#if defined(__AVX__)
+	if (vectorise)
 	{
-		proPos.y += particle->velocity.y;
-		colliding = true;
-		while (colliding && (abs(correction.y) < abs(particle->velocity.y)))
+		const __m256 gravX = _mm256_set1_ps(gravity.x);
+		const __m256 gravY = _mm256_set1_ps(gravity.y);
+		const __m256 maxX = _mm256_set1_ps(maximum.x);
+		const __m256 maxY = _mm256_set1_ps(maximum.y);
+		const __m256 minX = _mm256_set1_ps(-maximum.x);
+		const __m256 minY = _mm256_set1_ps(-maximum.y);
+		for (; I + 8 <= count; I += 8)
 		{
-			if (proPos.x < 0 || proPos.y + correction.y < 0 || proPos.x >= colImage->w || proPos.y + correction.y >= colImage->h)
-				break;
+			__m256 vel = _mm256_add_ps(_mm256_loadu_ps(&particles->velX[I]),gravX);
+			_mm256_storeu_ps(&particles->velX[I],_mm256_min_ps(_mm256_max_ps(vel,minX),maxX));
+			vel = _mm256_add_ps(_mm256_loadu_ps(&particles->velY[I]),gravY);
+			_mm256_storeu_ps(&particles->velY[I],_mm256_min_ps(_mm256_max_ps(vel,minY),maxY));
+		}
+	}
+#elif defined(__SSE2__)
+	if (vectorise)
+	{
+		const __m128 gravX = _mm_set1_ps(gravity.x);
+		const __m128 gravY = _mm_set1_ps(gravity.y);
+		const __m128 maxX = _mm_set1_ps(maximum.x);
+		const __m128 maxY = _mm_set1_ps(maximum.y);
+		const __m128 minX = _mm_set1_ps(-maximum.x);
+		const __m128 minY = _mm_set1_ps(-maximum.y);
+		for (; I + 4 <= count; I += 4)
+		{
+			__m128 vel = _mm_add_ps(_mm_loadu_ps(&particles->velX[I]),gravX);
+			_mm_storeu_ps(&particles->velX[I],_mm_min_ps(_mm_max_ps(vel,minX),maxX));
+			vel = _mm_add_ps(_mm_loadu_ps(&particles->velY[I]),gravY);
+			_mm_storeu_ps(&particles->velY[I],_mm_min_ps(_mm_max_ps(vel,minY),maxY));
+		}
+	}
+#endif
+	for (; I < count; ++I)
+	{
+		particles->velX[I] = min(max(particles->velX[I] + gravity.x,-maximum.x),maximum.x);
+		particles->velY[I] = min(max(particles->velY[I] + gravity.y,-maximum.y),maximum.y);
+	}
 
-			temp = GFX::getPixel(colImage,proPos.x, proPos.y + correction.y);
+	// map collision
+	I = 0;
+#if defined(__SSE2__)
+	if (vectorise)
+	{
+		// most particles fly freely, so test the first probe of both directions
+		// for four particles at once and only resolve the colliding ones
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 width = _mm_set1_ps(colMap->getWidth());
+		const __m128 height = _mm_set1_ps(colMap->getHeight());
+		int probeX[4], probeY[4], probePosX[4], probePosY[4];
+		for (; I + 4 <= count; I += 4)
+		{
+			const __m128 posX = _mm_loadu_ps(&particles->posX[I]);
+			const __m128 posY = _mm_loadu_ps(&particles->posY[I]);
+			const __m128 velX = _mm_loadu_ps(&particles->velX[I]);
+			const __m128 velY = _mm_loadu_ps(&particles->velY[I]);
+			const __m128 proX = _mm_add_ps(posX,velX);
+			const __m128 proY = _mm_add_ps(posY,velY);
+			const __m128 posXInside = _mm_and_ps(_mm_cmpge_ps(posX,zero),_mm_cmplt_ps(posX,width));
+			const __m128 posYInside = _mm_and_ps(_mm_cmpge_ps(posY,zero),_mm_cmplt_ps(posY,height));
+
+			// probe (posX + velX, posY) and (posX, posY + velY), only if moving and inside the map
+			int maskX = _mm_movemask_ps(_mm_and_ps(_mm_and_ps(_mm_cmpneq_ps(velX,zero),posYInside),
+					_mm_and_ps(_mm_cmpge_ps(proX,zero),_mm_cmplt_ps(proX,width))));
+			int maskY = _mm_movemask_ps(_mm_and_ps(_mm_and_ps(_mm_cmpneq_ps(velY,zero),posXInside),
+					_mm_and_ps(_mm_cmpge_ps(proY,zero),_mm_cmplt_ps(proY,height))));
+			if ((maskX | maskY) == 0)
+				continue;
 
-			if (particle->checkCollisionColour(temp)) // collision
+			// truncation is the same as the int conversion in the scalar path
+			_mm_storeu_si128((__m128i*)probeX,_mm_cvttps_epi32(proX));
+			_mm_storeu_si128((__m128i*)probeY,_mm_cvttps_epi32(proY));
+			_mm_storeu_si128((__m128i*)probePosX,_mm_cvttps_epi32(posX));
+			_mm_storeu_si128((__m128i*)probePosY,_mm_cvttps_epi32(posY));
+			for (int K = 0; K < 4; ++K)
 			{
-				correction.y += pixelCorrection.y;
+				if (((maskX >> K) & 1) && particles->checkCollisionID(I + K,colMap->getID(probeX[K],probePosY[K])))
+					particleMapCollision(colMap,particles,I + K);
+				else if (((maskY >> K) & 1) && particles->checkCollisionID(I + K,colMap->getID(probePosX[K],probeY[K])))
+					particleMapCollision(colMap,particles,I + K);
 			}
+		}
+	}
+#endif
+	for (; I < count; ++I)
+	{
+		particleMapCollision(colMap,particles,I);
+	}
+}
+
+void Physics::particleMapCollision(const CollisionMap* const colMap, ParticlePool* const particles, const int& index) const
+{
+	const int width = colMap->getWidth();
+	const int height = colMap->getHeight();
+	const float posX = particles->posX[index];
+	const float posY = particles->posY[index];
+	const float velX = particles->velX[index];
+	const float velY = particles->velY[index];
+	float correctionX = 0;
+	float correctionY = 0;
+	int pixelCorrectionX = NumberUtility::sign(velX) * -1;
+	int pixelCorrectionY = NumberUtility::sign(velY) * -1;
+
+	// x
+	if (pixelCorrectionX != 0)
+	{
+		float proPosX = posX + velX;
+		while (abs(correctionX) < abs(velX))
+		{
+			if (proPosX + correctionX < 0 || posY < 0 || proPosX + correctionX >= width || posY >= height)
+				break;
+
+			if (particles->checkCollisionID(index,colMap->getID(proPosX + correctionX,posY))) // collision
+				correctionX += pixelCorrectionX;
 			else
-			{
-				colliding = false;
-			}
+				break;
+		}
+	}
+	// y
+	if (pixelCorrectionY != 0)
+	{
+		float proPosY = posY + velY;
+		while (abs(correctionY) < abs(velY))
+		{
+			if (posX < 0 || proPosY + correctionY < 0 || posX >= width || proPosY + correctionY >= height)
+				break;
+
+			if (particles->checkCollisionID(index,colMap->getID(posX,proPosY + correctionY))) // collision
+				correctionY += pixelCorrectionY;
+			else
+				break;
 		}
 	}
 
-	particle->hitMap(correction);
+	particles->hitMap(index,correctionX,correctionY);
 }
 
 
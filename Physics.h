@@ -36,6 +36,9 @@ Testing for collisions between a unit and the level (imaged based, checking corn
 and between two units (rectangular)
 Also applies gravity, acceleration and friction to units
 See readme file for more details (such as advantages and problems with this implementation)
+All checks are const and can run in several threads at once, gravity and maximum
+are only changed when loading or resetting a level (preview workers hold
+LevelLoader::lock while doing that)
 **/
 
 #define PHYSICS (Physics::GetSingleton())
@@ -43,6 +46,11 @@ See readme file for more details (such as advantages and problems with this impl
 class Level;
 class BaseUnit;
 class SimpleDirection;
+class CollisionMap;
+class ParticlePool;
+class UnitBodyPool;
+struct UnitBody;
+struct MapCollisionEntry;
 
 class Physics
 {
@@ -55,14 +63,19 @@ public:
 
 	// apply physical forces such as gravity, friction and acceleration to the unit
 	void applyPhysics(BaseUnit* const unit) const;
+	void applyPhysics(UnitBody& body) const;
+	// runs applyPhysics over all simulated bodies, block by block
+	void applyPhysics(UnitBodyPool* const bodies) const;
 
 	// check for a collision between the passed unit and level
+	// (units moving further than their size in a tick, or all fast units with
+	// continuous set, are swept along their velocity first, see sweepEdge)
 	// level - the parent Level, used for bounds checking
-	// colImage - the actual image against which we will test
+	// colMap - the collision map (colour IDs) against which we will test
 	// unit - the unit to test
 	// mapOffset - optional offset parameter
 	// will not return anything but set unit->collisionInfo and call unit->hitMap instead
-	void unitMapCollision(const Level* const level, SDL_Surface* const colImage, BaseUnit* const unit, const Vector2df& mapOffset = Vector2df(0,0)) const;
+	void unitMapCollision(const Level* const level, const CollisionMap* const colMap, BaseUnit* const unit, const Vector2df& mapOffset = Vector2df(0,0)) const;
 	// check for a collision between two units
 	// level - Level, used for bounds checking
 	// calls unit->hit on hit (does not call player->hit, call that from unit->hit
@@ -70,7 +83,10 @@ public:
 	// see readme for why this is done
 	void playerUnitCollision(const Level* const level, BaseUnit* const player, BaseUnit* const unit) const;
 
-	void particleMapCollision(const Level* const level, SDL_Surface* const colImage, BaseUnit* const particle) const;
+	// applies gravity and checks map collision for all particles at once
+	// (same as applyPhysics and unitMapCollision for a single pixel)
+	// uses SSE2/AVX if the compiler has been told so (and vectorise is true)
+	void particlePhysics(const CollisionMap* const colMap, ParticlePool* const particles) const;
 
 	// simple rectangular check between two units, returns true on collision
 	bool checkUnitCollision(const Level* const level, const BaseUnit* const unitA, const BaseUnit* const unitB) const;
@@ -80,9 +96,21 @@ public:
 
 	Vector2df gravity;
 	Vector2df maximum; // the maximum, absolute value a unit is allowed to move (limit)
+	bool vectorise; // use the SIMD particle kernel if available (for benchmarking)
+	bool continuous; // sweep all units moving more than a pixel per tick so they can't pass thin walls
 private:
 	// check for overlapping rectangles
 	bool rectCheck(const SDL_Rect& rectA, const SDL_Rect& rectB) const;
+	// walks the leading edge (whole width or upper half of the height) of the unit
+	// pixel line by pixel line from start along the velocity on one axis and stops
+	// at the first line hitting the map, correction then moves the unit right in
+	// front of it
+	// returns false if the unit is not blocked or already in the first line, which
+	// might be a step or squashing and is left to the sampled check
+	bool sweepEdge(const Level* const level, const CollisionMap* const colMap, BaseUnit* const unit,
+			const Vector2df& start, const bool& horizontal, int& correction, std::vector<MapCollisionEntry>& hits) const;
+	// resolves the map collision of a single particle pixel by pixel
+	void particleMapCollision(const CollisionMap* const colMap, ParticlePool* const particles, const int& index) const;
 
 	std::vector<SimpleDirection> checkPointsX;
 	std::vector<SimpleDirection> checkPointsY;
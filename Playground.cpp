@@ -25,10 +25,10 @@
 #include "Playground.h"
 
 #include "LevelLoader.h"
+#include "GreySurfaceCache.h"
 #include "userStates.h"
 #include "BaseUnit.h"
 #include "ControlUnit.h"
-#include "PixelParticle.h"
 #include "Link.h"
 
 Playground::Playground()
@@ -45,6 +45,9 @@ Playground::~Playground()
 		delete (*curr);
 	}
 	mouseRects.clear();
+	// the level image might have been drawn on, so it must not be reused
+	if (levelImage)
+		SURFACE_CACHE->removeSurface(levelImage);
 }
 
 ///---public---
@@ -187,13 +190,21 @@ void Playground::render(SDL_Surface* screen)
 	src.w = min((int)GFX::getXResolution(),getWidth() - src.x);
 	src.h = min((int)GFX::getYResolution(),getHeight() - src.y);
 
-	for (vector<Rectangle*>::iterator curr = mouseRects.begin(); curr != mouseRects.end(); ++curr)
+	if (!mouseRects.empty())
 	{
-		(*curr)->render(collisionLayer);
-		(*curr)->render(levelImage);
-		delete (*curr);
+		for (vector<Rectangle*>::iterator curr = mouseRects.begin(); curr != mouseRects.end(); ++curr)
+		{
+			(*curr)->render(collisionLayer);
+			(*curr)->render(levelImage);
+			delete (*curr);
+		}
+		mouseRects.clear();
+
+		// drawing is rare, so just read back the whole level
+		SDL_Rect full = {0,0,getWidth(),getHeight()};
+		collisionMap.copyRect(collisionLayer,full);
+		collisionMap.copyBaseRect(levelImage,full);
 	}
-	mouseRects.clear();
 
 	SDL_BlitSurface(collisionLayer,&src,screen,&dst);
 
@@ -214,12 +225,7 @@ void Playground::render(SDL_Surface* screen)
 	}
 
 	// particles
-	for (vector<PixelParticle*>::iterator curr = effects.begin(); curr != effects.end(); ++curr)
-	{
-		(*curr)->updateScreenPosition(drawOffset);
-		(*curr)->render(screen);
-		GFX::renderPixelBuffer();
-	}
+	particles.render(screen,drawOffset);
 
 	// links
 	for (vector<Link*>::iterator I = links.begin(); I != links.end(); ++I)
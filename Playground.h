@@ -43,6 +43,9 @@ public:
 protected:
 	vector<Rectangle*> mouseRects;
 
+	// players are drawn directly to the screen, so always redraw everything
+	virtual bool canRenderPartial() const {return false;}
+
 #ifdef _DEBUG
 	bool mouseDraw; // switches between drawing and selecting objects
 #endif
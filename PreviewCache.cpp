@@ -0,0 +1,263 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "PreviewCache.h"
+
+#include <fstream>
+#include <string.h>
+#include <sys/stat.h>
+#include <SDL/SDL_image.h>
+
+#include "IMG_savepng.h"
+#include "AssetPack.h"
+
+// File layout, all numbers 32bit little endian, strings with their length first:
+// "GPVC", version, entry count, then for every entry the level filename,
+// modified, size, level name, width, height, PNG length and data
+
+#define CACHE_MAGIC "GPVC"
+#define CACHE_VERSION 1
+
+static void writeUint32(ofstream& file, const Uint32& value)
+{
+	char bytes[4] = {(char)(value & 0xFF),(char)((value >> 8) & 0xFF),(char)((value >> 16) & 0xFF),(char)((value >> 24) & 0xFF)};
+	file.write(bytes,4);
+}
+
+static void writeString(ofstream& file, CRstring value)
+{
+	writeUint32(file,value.length());
+	file.write(value.data(),value.length());
+}
+
+static bool readUint32(const vector<char>& buffer, size_t& pos, Uint32& value)
+{
+	if (pos + 4 > buffer.size())
+		return false;
+	const unsigned char* bytes = (const unsigned char*)&buffer[pos];
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+	pos += 4;
+	return true;
+}
+
+static bool readString(const vector<char>& buffer, size_t& pos, string& value)
+{
+	Uint32 length;
+	if (not readUint32(buffer,pos,length) || pos + length > buffer.size())
+		return false;
+	value.assign(&buffer[0] + pos,length);
+	pos += length;
+	return true;
+}
+
+PreviewCache::PreviewCache()
+{
+	mutex = SDL_CreateMutex();
+	loaded = false;
+	changed = false;
+}
+
+PreviewCache::~PreviewCache()
+{
+	SDL_DestroyMutex(mutex);
+}
+
+bool PreviewCache::load(CRstring filename)
+{
+	SDL_mutexP(mutex);
+	bool result = loadFile(filename);
+	SDL_mutexV(mutex);
+	return result;
+}
+
+bool PreviewCache::save()
+{
+	SDL_mutexP(mutex);
+	bool result = saveFile();
+	SDL_mutexV(mutex);
+	return result;
+}
+
+SDL_Surface* PreviewCache::getPreview(CRstring levelFile, CRint width, CRint height, string& name) const
+{
+	Uint32 modified, size;
+	if (not getFileInfo(levelFile,modified,size))
+		return NULL;
+
+	// copy the PNG data, so decoding does not block other threads
+	vector<char> image;
+	string entryName;
+	SDL_mutexP(mutex);
+	map<string,Entry>::const_iterator entry = entries.find(levelFile);
+	if (entry != entries.end() && entry->second.width == (Uint32)width && entry->second.height == (Uint32)height &&
+			entry->second.modified == modified && entry->second.size == size)
+	{
+		image = entry->second.image;
+		entryName = entry->second.name;
+	}
+	SDL_mutexV(mutex);
+	if (image.empty())
+		return NULL;
+
+	SDL_Surface* result = IMG_Load_RW(SDL_RWFromConstMem(&image[0],image.size()),1);
+	if (result)
+		name = entryName;
+	return result;
+}
+
+void PreviewCache::addPreview(CRstring levelFile, SDL_Surface* const preview, CRstring name)
+{
+	Entry entry;
+	if (not preview || not getFileInfo(levelFile,entry.modified,entry.size))
+		return;
+
+	// PNG output should never be much bigger than the raw pixels
+	vector<char> buffer(preview->w * preview->h * 4 + 1024);
+	SDL_RWops* data = SDL_RWFromMem(&buffer[0],buffer.size());
+	int result = IMG_SavePNG_RW(data,preview,IMG_COMPRESS_DEFAULT);
+	int length = SDL_RWtell(data);
+	SDL_RWclose(data);
+	if (result != 0 || length <= 0 || length >= (int)buffer.size())
+		return;
+
+	SDL_mutexP(mutex);
+	Entry& stored = entries[levelFile];
+	stored.modified = entry.modified;
+	stored.size = entry.size;
+	stored.name = name;
+	stored.width = preview->w;
+	stored.height = preview->h;
+	stored.image.assign(buffer.begin(),buffer.begin() + length);
+	changed = true;
+	SDL_mutexV(mutex);
+}
+
+/// ---private------------------------------------------------------------------
+
+bool PreviewCache::loadFile(CRstring filename)
+{
+	if (loaded)
+		return true;
+	loaded = true;
+	this->filename = filename;
+
+	ifstream file(filename.c_str(),ios::in | ios::binary);
+	if (file.fail())
+		return false;
+
+	file.seekg(0,ios::end);
+	streamoff length = file.tellg();
+	file.seekg(0,ios::beg);
+	if (length < 4)
+		return false;
+	vector<char> buffer(length);
+	file.read(&buffer[0],length);
+	if (file.gcount() != length)
+		return false;
+	file.close();
+
+	size_t pos = 4;
+	Uint32 version, count;
+	if (memcmp(&buffer[0],CACHE_MAGIC,4) != 0 || not readUint32(buffer,pos,version) ||
+			version != CACHE_VERSION || not readUint32(buffer,pos,count))
+	{
+		printf("WARNING: Preview cache \"%s\" is outdated or broken and will be rebuilt\n",filename.c_str());
+		return false;
+	}
+
+	for (Uint32 I = 0; I < count; ++I)
+	{
+		string key;
+		Entry entry;
+		Uint32 imageLength;
+		if (not readString(buffer,pos,key) || not readUint32(buffer,pos,entry.modified) ||
+				not readUint32(buffer,pos,entry.size) || not readString(buffer,pos,entry.name) ||
+				not readUint32(buffer,pos,entry.width) || not readUint32(buffer,pos,entry.height) ||
+				not readUint32(buffer,pos,imageLength) || pos + imageLength > buffer.size())
+		{
+			printf("WARNING: Preview cache \"%s\" is broken and will be rebuilt\n",filename.c_str());
+			entries.clear();
+			return false;
+		}
+		entry.image.assign(buffer.begin() + pos,buffer.begin() + pos + imageLength);
+		pos += imageLength;
+		entries[key] = entry;
+	}
+
+	printf("Loaded %i cached level previews\n",entries.size());
+	return true;
+}
+
+bool PreviewCache::saveFile()
+{
+	if (not changed || filename[0] == 0)
+		return true;
+
+	ofstream file(filename.c_str(),ios::out | ios::binary | ios::trunc);
+	if (file.fail())
+	{
+		printf("ERROR: Could not write preview cache \"%s\"\n",filename.c_str());
+		return false;
+	}
+
+	file.write(CACHE_MAGIC,4);
+	writeUint32(file,CACHE_VERSION);
+	writeUint32(file,entries.size());
+	for (map<string,Entry>::const_iterator I = entries.begin(); I != entries.end(); ++I)
+	{
+		writeString(file,I->first);
+		writeUint32(file,I->second.modified);
+		writeUint32(file,I->second.size);
+		writeString(file,I->second.name);
+		writeUint32(file,I->second.width);
+		writeUint32(file,I->second.height);
+		writeUint32(file,I->second.image.size());
+		if (not I->second.image.empty())
+			file.write(&I->second.image[0],I->second.image.size());
+	}
+	file.close();
+
+	changed = false;
+	return true;
+}
+
+bool PreviewCache::getFileInfo(CRstring filename, Uint32& modified, Uint32& size)
+{
+	const char* data;
+	size_t packedSize;
+	time_t packModified;
+	if (ASSET_PACK->find(filename,data,packedSize,packModified))
+	{
+		modified = packModified;
+		size = packedSize;
+		return true;
+	}
+
+	struct stat info;
+	if (stat(filename.c_str(),&info) != 0)
+		return false;
+	modified = info.st_mtime;
+	size = info.st_size;
+	return true;
+}
@@ -0,0 +1,88 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_mutex.h>
+#include <map>
+#include <vector>
+#include <string>
+
+#include "PenjinTypes.h"
+
+#define PREVIEW_CACHE_FILE "previews.dat"
+
+/**
+Keeps level preview images on disk between sessions, so the level select does
+not have to load and render every level again
+All previews are stored as PNG in a single file, keyed by the level filename
+Entries are only used if the level file's modification time and size and the
+preview size did not change
+All functions may be called from multiple threads
+**/
+
+class PreviewCache
+{
+public:
+	PreviewCache();
+	~PreviewCache();
+
+	// reads the cache file (once), returns false if it does not exist or is broken
+	bool load(CRstring filename);
+	// writes all entries to the file passed to load if new ones were added
+	bool save();
+
+	// returns a new surface (free after use) if an up-to-date preview of the
+	// passed size is cached, NULL otherwise, name is set to the level's name
+	SDL_Surface* getPreview(CRstring levelFile, CRint width, CRint height, string& name) const;
+	void addPreview(CRstring levelFile, SDL_Surface* const preview, CRstring name);
+
+private:
+	struct Entry
+	{
+		Uint32 modified;
+		Uint32 size;
+		string name;
+		Uint32 width;
+		Uint32 height;
+		vector<char> image; // PNG data
+	};
+
+	// load and save without locking
+	bool loadFile(CRstring filename);
+	bool saveFile();
+
+	// modification time and size of a loose or packed file
+	static bool getFileInfo(CRstring filename, Uint32& modified, Uint32& size);
+
+	SDL_mutex* mutex; // guards all members, PNG coding is done outside
+	string filename;
+	bool loaded;
+	bool changed;
+	map<string,Entry> entries;
+};
+
+#endif // PREVIEWCACHE_H
@@ -0,0 +1,253 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "Profiler.h"
+
+#include <SDL/SDL_thread.h>
+#include <fstream>
+#include <string.h>
+
+#include "Timing.h"
+#include "gameDefines.h"
+
+#define GRAPH_HEIGHT 48
+#define GRAPH_RANGE (2000000 / FRAME_RATE) // two frames, so the budget line is in the middle
+
+static const char* zoneNames[pzEOL] = {
+	"state management",
+	"user input",
+	"update",
+	"removal sweep",
+	"particle physics",
+	"unit physics",
+	"unit-unit collision",
+	"map collision",
+	"player update",
+	"dialogue",
+	"hollywood",
+	"render",
+	"render level",
+	"render particles",
+	"render edges and scaling",
+	"flip"
+};
+
+static const Uint8 zoneColours[pzEOL][3] = {
+	{255,255,255},
+	{128,128,128},
+	{0,96,0},
+	{0,160,160},
+	{255,128,0},
+	{0,192,0},
+	{255,0,0},
+	{255,255,0},
+	{0,128,255},
+	{192,128,255},
+	{255,0,255},
+	{0,0,160},
+	{64,64,255},
+	{255,192,128},
+	{128,255,255},
+	{96,96,96}
+};
+
+Profiler* Profiler::self = NULL;
+
+Profiler::Profiler()
+{
+	active = false;
+	thread = 0;
+	startTime = 0;
+	depth = 0;
+	historyPos = 0;
+	frames = 0;
+	memset(current,0,sizeof(current));
+	memset(history,0,sizeof(history));
+	memset(totals,0,sizeof(totals));
+	memset(peaks,0,sizeof(peaks));
+}
+
+Profiler::~Profiler()
+{
+	//
+}
+
+Profiler* Profiler::GetSingleton()
+{
+	if (not self)
+		self = new Profiler();
+	return self;
+}
+
+void Profiler::setActive(CRbool value)
+{
+	active = value;
+	if (not active)
+		return;
+
+	thread = SDL_ThreadID();
+	startTime = getMicroTicks();
+	depth = 0;
+	events.clear();
+	historyPos = 0;
+	frames = 0;
+	memset(current,0,sizeof(current));
+	memset(history,0,sizeof(history));
+	memset(totals,0,sizeof(totals));
+	memset(peaks,0,sizeof(peaks));
+}
+
+bool Profiler::startZone(const ProfileZoneID& zone)
+{
+	if (not active || depth >= PROFILER_MAX_DEPTH || SDL_ThreadID() != thread)
+		return false;
+
+	stack[depth].zone = zone;
+	stack[depth].children = 0;
+	stack[depth].start = getMicroTicks();
+	++depth;
+	return true;
+}
+
+void Profiler::endZone()
+{
+	Uint64 end = getMicroTicks();
+	if (depth <= 0)
+		return;
+	--depth;
+
+	const ZoneEntry& entry = stack[depth];
+	Uint64 duration = end - entry.start;
+	current[entry.zone] += duration - entry.children;
+	if (depth > 0)
+		stack[depth-1].children += duration;
+
+	if (traceFile[0] != 0 && events.size() < PROFILER_MAX_EVENTS)
+	{
+		TraceEvent event = {entry.zone,depth,entry.start - startTime,duration};
+		events.push_back(event);
+		if (events.size() == PROFILER_MAX_EVENTS)
+			printf("Warning: Profiler trace full, further zones will not be exported!\n");
+	}
+}
+
+void Profiler::newFrame()
+{
+	if (not active)
+		return;
+
+	for (int I = 0; I < pzEOL; ++I)
+	{
+		history[historyPos][I] = current[I];
+		totals[I] += current[I];
+		peaks[I] = max(peaks[I],current[I]);
+		current[I] = 0;
+	}
+	historyPos = (historyPos + 1) % PROFILER_HISTORY;
+	++frames;
+}
+
+SDL_Rect Profiler::render(SDL_Surface* const screen, CRint x, CRint y) const
+{
+	SDL_Rect area = {x,y,PROFILER_HISTORY,GRAPH_HEIGHT};
+	SDL_FillRect(screen,&area,SDL_MapRGB(screen->format,0,0,0));
+
+	Uint32 colours[pzEOL];
+	for (int I = 0; I < pzEOL; ++I)
+		colours[I] = SDL_MapRGB(screen->format,zoneColours[I][0],zoneColours[I][1],zoneColours[I][2]);
+
+	// one column per frame, oldest on the left, zones stacked bottom to top
+	for (int frame = 0; frame < PROFILER_HISTORY; ++frame)
+	{
+		const Uint32* times = history[(historyPos + frame) % PROFILER_HISTORY];
+		Uint32 sum = 0;
+		int bottom = GRAPH_HEIGHT;
+		for (int I = 0; I < pzEOL && bottom > 0; ++I)
+		{
+			if (times[I] == 0)
+				continue;
+			sum += times[I];
+			int top = max(GRAPH_HEIGHT - (int)((Uint64)sum * GRAPH_HEIGHT / GRAPH_RANGE),0);
+			if (top < bottom)
+			{
+				SDL_Rect bar = {x + frame,y + top,1,bottom - top};
+				SDL_FillRect(screen,&bar,colours[I]);
+				bottom = top;
+			}
+		}
+	}
+
+	// frame budget
+	SDL_Rect budget = {x,y + GRAPH_HEIGHT / 2,PROFILER_HISTORY,1};
+	SDL_FillRect(screen,&budget,SDL_MapRGB(screen->format,255,0,0));
+
+	return area;
+}
+
+void Profiler::printSummary() const
+{
+	if (frames == 0)
+		return;
+
+	printf("Profile of %i frames (self time in ms, budget %.2f):\n",frames,1000.0f / (float)FRAME_RATE);
+	printf("%-20s %8s %8s\n","zone","average","worst");
+	Uint64 total = 0;
+	for (int I = 0; I < pzEOL; ++I)
+	{
+		total += totals[I];
+		if (totals[I] == 0)
+			continue;
+		printf("%-20s %8.3f %8.3f\n",zoneNames[I],(double)totals[I] / (double)frames / 1000.0,
+				(double)peaks[I] / 1000.0);
+	}
+	printf("%-20s %8.3f\n","total",(double)total / (double)frames / 1000.0);
+}
+
+bool Profiler::writeTrace() const
+{
+	if (traceFile[0] == 0)
+		return true;
+
+	ofstream file(traceFile.c_str());
+	if (not file.is_open())
+	{
+		printf("ERROR: Could not open trace file \"%s\" for writing!\n",traceFile.c_str());
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (vector<TraceEvent>::const_iterator I = events.begin(); I != events.end(); ++I)
+	{
+		if (I != events.begin())
+			file << ",\n";
+		file << "{\"name\":\"" << zoneNames[I->zone] << "\",\"cat\":\"greyout\",\"ph\":\"X\",\"ts\":"
+				<< I->start << ",\"dur\":" << I->duration << ",\"pid\":1,\"tid\":1,\"args\":{\"depth\":"
+				<< I->depth << "}}";
+	}
+	file << "\n]}\n";
+	file.close();
+
+	printf("Wrote %i profiler events to \"%s\"\n",(int)events.size(),traceFile.c_str());
+	return true;
+}
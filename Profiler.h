@@ -0,0 +1,151 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SDL/SDL.h>
+#include <vector>
+#include <string>
+
+#include "PenjinTypes.h"
+
+#define PROFILER Profiler::GetSingleton()
+
+#define PROFILER_HISTORY 120 // frames shown in the graph
+#define PROFILER_MAX_DEPTH 16
+#define PROFILER_MAX_EVENTS 500000 // trace events kept for export (~12MB)
+
+enum ProfileZoneID
+{
+	pzStateManagement=0,
+	pzUserInput,
+	pzUpdate,
+	pzRemoval,
+	pzParticlePhysics,
+	pzUnitPhysics,
+	pzUnitCollision,
+	pzMapCollision,
+	pzPlayerUpdate,
+	pzDialogue,
+	pzHollywood,
+	pzRender,
+	pzRenderLevel,
+	pzRenderParticles,
+	pzRenderScaling,
+	pzFlip,
+	pzEOL
+};
+
+/**
+Measures the time spent in named parts (zones) of a frame
+Zones can be nested, the time of a zone does not include the time of zones
+started inside of it (self time), so the zones of a frame add up to the total
+Only zones on the thread which activated the profiler are recorded (the level
+select previews update and render levels in a separate thread)
+The last frames are shown as a stacked graph, all zones can be written to a
+file in Chrome's trace event format (open in chrome://tracing)
+**/
+
+class Profiler
+{
+private:
+	Profiler();
+	static Profiler* self;
+public:
+	~Profiler();
+	static Profiler* GetSingleton();
+
+	// activating also resets all data
+	void setActive(CRbool value);
+	bool isActive() const {return active;}
+	// file to write the trace to on writeTrace, no trace is recorded if empty
+	void setTraceFile(CRstring filename) {traceFile = filename;}
+
+	// returns false if the zone is not recorded (do not call endZone then)
+	bool startZone(const ProfileZoneID& zone);
+	void endZone();
+	// stores the times of the current frame in the history and starts a new one
+	void newFrame();
+
+	// draws the graph of the last frames with the top-left corner at (x,y)
+	// returns the area drawn to
+	SDL_Rect render(SDL_Surface* const screen, CRint x, CRint y) const;
+	// prints the average and worst time of every zone to stdout
+	void printSummary() const;
+	// returns false on error
+	bool writeTrace() const;
+
+private:
+	struct ZoneEntry
+	{
+		ProfileZoneID zone;
+		Uint64 start;
+		Uint64 children; // time spent in nested zones
+	};
+	struct TraceEvent
+	{
+		ProfileZoneID zone;
+		int depth;
+		Uint64 start; // relative to activation
+		Uint64 duration;
+	};
+
+	bool active;
+	Uint32 thread;
+	Uint64 startTime;
+	string traceFile;
+
+	ZoneEntry stack[PROFILER_MAX_DEPTH];
+	int depth;
+	vector<TraceEvent> events;
+
+	// all times in microseconds
+	Uint32 current[pzEOL];
+	Uint32 history[PROFILER_HISTORY][pzEOL];
+	int historyPos;
+	Uint64 totals[pzEOL];
+	Uint32 peaks[pzEOL];
+	int frames;
+};
+
+/**
+Records the enclosing scope as a zone
+next() ends the current zone and starts another one for sequential stages,
+stop() ends it early
+**/
+
+class ProfileZone
+{
+public:
+	ProfileZone(const ProfileZoneID& zone) {running = PROFILER->startZone(zone);}
+	~ProfileZone() {stop();}
+
+	void next(const ProfileZoneID& zone) {stop(); running = PROFILER->startZone(zone);}
+	void stop() {if (running) PROFILER->endZone(); running = false;}
+private:
+	bool running;
+};
+
+#endif // PROFILER_H
@@ -26,12 +26,16 @@
 
 #include "fileTypeDefines.h"
 #include "Level.h"
+#include "CollisionMap.h"
 #include "MusicCache.h"
 #include "BasePlayer.h"
 #include "MyGame.h"
 
 #define PUSHING_SPEED 1.0f
 
+const KeywordTable PushableBox::stringToOrder = KeywordTable(&BaseUnit::stringToOrder)
+	.add("size",boSize);
+
 PushableBox::PushableBox(Level* newParent) : BaseUnit(newParent)
 {
 	rect.w = 32;
@@ -48,8 +52,6 @@ PushableBox::PushableBox(Level* newParent) : BaseUnit(newParent)
 	}
 	pushSound.setVolume(MUSIC_CACHE->getSoundVolume());
 	//pushSound.setSimultaneousPlay(true);
-
-	stringToOrder["size"] = boSize;
 }
 
 PushableBox::~PushableBox()
@@ -158,6 +160,12 @@ void PushableBox::render(SDL_Surface* surf)
 	BaseUnit::render(surf);
 }
 
+void PushableBox::renderCollision(CollisionMap* const map, SDL_Surface* const surf)
+{
+	SDL_Rect temp = {position.x,position.y,rect.w,rect.h};
+	map->fillRect(temp,map->registerColour(col));
+}
+
 void PushableBox::hitUnit(const UnitCollisionEntry& entry)
 {
 	if (velocity.y < 4 && entry.unit->isPlayer) // if not falling
@@ -181,9 +189,9 @@ void PushableBox::hitUnit(const UnitCollisionEntry& entry)
 			else
 				entry.unit->collisionInfo.positionCorrection.x -= entry.unit->position.x - position.x - getWidth();
 			if (entry.unit->direction > 0)
-				entry.unit->setSpriteState("pushright");
+				entry.unit->setSpriteState(ssPushRight);
 			else
-				entry.unit->setSpriteState("pushleft");
+				entry.unit->setSpriteState(ssPushLeft);
 			if (!pushSound.isPlaying() || pushSound.isPaused())
 			{
 				pushSound.play();
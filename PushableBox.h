@@ -55,6 +55,8 @@ class PushableBox : public BaseUnit
 		virtual void update();
 		virtual void updateScreenPosition(const Vector2di& offset);
 		virtual void render(SDL_Surface* surf);
+		// a box is a solid rectangle, so no need to read pixels back
+		virtual void renderCollision(CollisionMap* const map, SDL_Surface* const surf);
 
 		// Also sets the unit's/player's velocity in this case (to slow it down and
 		// create the illusion of weight)
@@ -79,6 +81,8 @@ class PushableBox : public BaseUnit
 			boSize=BaseUnit::okEOL,
 			boEOL
 		};
+		static const KeywordTable stringToOrder;
+		virtual const KeywordTable& getOrderKeys() const {return stringToOrder;}
 	private:
 };
 
@@ -0,0 +1,241 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "RewindBuffer.h"
+
+#include <string.h>
+
+#include "BaseUnit.h"
+#include "gameDefines.h"
+
+#define END_OF_TICK -1 // in place of a unit index
+
+// the deltas only live in memory, so values are stored in native byte order
+static inline void append(vector<char>& buffer, const void* data, const int& size)
+{
+	const char* bytes = (const char*)data;
+	buffer.insert(buffer.end(),bytes,bytes + size);
+}
+
+static inline void extract(const vector<char>& buffer, int& pos, void* data, const int& size)
+{
+	memcpy(data,&buffer[pos],size);
+	pos += size;
+}
+
+RewindBuffer::RewindBuffer()
+{
+	first = 0;
+	count = 0;
+	setCapacity(REWIND_SECONDS * FRAME_RATE);
+}
+
+RewindBuffer::~RewindBuffer()
+{
+	ticks.clear();
+}
+
+///---public---
+
+void RewindBuffer::setCapacity(const int& ticks)
+{
+	this->ticks.clear();
+	this->ticks.resize(max(ticks,1));
+	clear();
+}
+
+void RewindBuffer::clear()
+{
+	first = 0;
+	count = 0;
+	tracked.clear();
+	current.clear();
+}
+
+void RewindBuffer::record(const vector<BaseUnit*>& units, const Vector2df& drawOffset)
+{
+	if (units != tracked)
+	{
+		// indices are not valid anymore, start over
+		clear();
+		tracked = units;
+		current.resize(units.size());
+		for (int I = 0; I < units.size(); ++I)
+			readState(units[I],current[I]);
+		lastOffset = drawOffset;
+		return;
+	}
+
+	// reuse the oldest slot when full
+	int slot = (first + count) % ticks.size();
+	if (count == ticks.size())
+		first = (first + 1) % ticks.size();
+	else
+		++count;
+	vector<char>& delta = ticks[slot];
+	delta.clear();
+
+	append(delta,&lastOffset,sizeof(lastOffset));
+	UnitState state;
+	for (int I = 0; I < units.size(); ++I)
+	{
+		readState(units[I],state);
+		Uint8 fields = compare(current[I],state);
+		if (fields == 0)
+			continue;
+
+		// the previous values of the changed fields
+		const UnitState& prev = current[I];
+		int index = I;
+		append(delta,&index,sizeof(index));
+		append(delta,&fields,sizeof(fields));
+		if (fields & sfPosition)
+			append(delta,&prev.position,sizeof(prev.position));
+		if (fields & sfVelocity)
+			append(delta,&prev.velocity,sizeof(prev.velocity));
+		if (fields & sfAcceleration)
+			append(delta,prev.acceleration,sizeof(prev.acceleration));
+		if (fields & sfDirection)
+			append(delta,&prev.direction,sizeof(prev.direction));
+		if (fields & sfFlags)
+			append(delta,&prev.flags,sizeof(prev.flags));
+		if (fields & sfOrder)
+		{
+			append(delta,&prev.currentOrder,sizeof(prev.currentOrder));
+			append(delta,&prev.orderTimer,sizeof(prev.orderTimer));
+			append(delta,&prev.orderRunning,sizeof(prev.orderRunning));
+		}
+		if (fields & sfColour)
+			append(delta,&prev.colour,sizeof(prev.colour));
+		current[I] = state;
+	}
+	int end = END_OF_TICK;
+	append(delta,&end,sizeof(end));
+	lastOffset = drawOffset;
+}
+
+bool RewindBuffer::stepBack(const vector<BaseUnit*>& units, Vector2df& drawOffset)
+{
+	if (count == 0)
+		return false;
+	if (units != tracked)
+	{
+		clear();
+		return false;
+	}
+
+	--count;
+	const vector<char>& delta = ticks[(first + count) % ticks.size()];
+	int pos = 0;
+	extract(delta,pos,&drawOffset,sizeof(drawOffset));
+	while (true)
+	{
+		int index;
+		extract(delta,pos,&index,sizeof(index));
+		if (index == END_OF_TICK)
+			break;
+
+		Uint8 fields;
+		extract(delta,pos,&fields,sizeof(fields));
+		UnitState& state = current[index];
+		if (fields & sfPosition)
+			extract(delta,pos,&state.position,sizeof(state.position));
+		if (fields & sfVelocity)
+			extract(delta,pos,&state.velocity,sizeof(state.velocity));
+		if (fields & sfAcceleration)
+			extract(delta,pos,state.acceleration,sizeof(state.acceleration));
+		if (fields & sfDirection)
+			extract(delta,pos,&state.direction,sizeof(state.direction));
+		if (fields & sfFlags)
+			extract(delta,pos,&state.flags,sizeof(state.flags));
+		if (fields & sfOrder)
+		{
+			extract(delta,pos,&state.currentOrder,sizeof(state.currentOrder));
+			extract(delta,pos,&state.orderTimer,sizeof(state.orderTimer));
+			extract(delta,pos,&state.orderRunning,sizeof(state.orderRunning));
+		}
+		if (fields & sfColour)
+			extract(delta,pos,&state.colour,sizeof(state.colour));
+		writeState(units[index],state);
+	}
+	lastOffset = drawOffset;
+	return true;
+}
+
+int RewindBuffer::getMemoryUsage() const
+{
+	int result = 0;
+	for (vector<vector<char> >::const_iterator I = ticks.begin(); I != ticks.end(); ++I)
+		result += I->capacity();
+	return result + current.capacity() * sizeof(UnitState);
+}
+
+///---private---
+
+void RewindBuffer::readState(const BaseUnit* const unit, UnitState& state)
+{
+	state.position = unit->position;
+	state.velocity = unit->velocity;
+	state.acceleration[0] = unit->acceleration[0];
+	state.acceleration[1] = unit->acceleration[1];
+	state.direction = unit->direction;
+	state.flags = unit->flags.flags;
+	unit->getOrderCursor(state.currentOrder,state.orderTimer);
+	state.orderRunning = unit->orderRunning;
+	state.colour = unit->col.getIntColour();
+}
+
+void RewindBuffer::writeState(BaseUnit* const unit, const UnitState& state)
+{
+	unit->position = state.position;
+	unit->velocity = state.velocity;
+	unit->acceleration[0] = state.acceleration[0];
+	unit->acceleration[1] = state.acceleration[1];
+	unit->direction = state.direction;
+	unit->flags.flags = state.flags;
+	unit->setOrderCursor(state.currentOrder,state.orderTimer);
+	unit->orderRunning = state.orderRunning;
+	if (unit->col.getIntColour() != state.colour)
+		unit->col = Colour(state.colour);
+}
+
+int RewindBuffer::compare(const UnitState& a, const UnitState& b)
+{
+	int result = 0;
+	if (a.position != b.position)
+		result |= sfPosition;
+	if (a.velocity != b.velocity)
+		result |= sfVelocity;
+	if (a.acceleration[0] != b.acceleration[0] || a.acceleration[1] != b.acceleration[1])
+		result |= sfAcceleration;
+	if (a.direction != b.direction)
+		result |= sfDirection;
+	if (a.flags != b.flags)
+		result |= sfFlags;
+	if (a.currentOrder != b.currentOrder || a.orderTimer != b.orderTimer || a.orderRunning != b.orderRunning)
+		result |= sfOrder;
+	if (a.colour != b.colour)
+		result |= sfColour;
+	return result;
+}
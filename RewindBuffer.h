@@ -0,0 +1,104 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef REWINDBUFFER_H
+#define REWINDBUFFER_H
+
+#include <SDL/SDL.h>
+#include <vector>
+
+#include "Vector2df.h"
+
+/**
+Ring buffer of per-tick changes to the simulation state of a level's units
+Every tick only the fields of units which changed are stored, with the value
+they had before the tick (so stepping back simply writes them back)
+Covers position, velocity, acceleration, direction, flags, order cursor and
+colour of units plus the camera, data of unit subclasses and sprites is not
+tracked, so rewinding past switches or keys being used is not exact
+The history is dropped whenever units get added or removed
+**/
+
+#define REWIND_SECONDS 10
+
+class BaseUnit;
+
+class RewindBuffer
+{
+public:
+	RewindBuffer();
+	~RewindBuffer();
+
+	// sets the number of ticks kept, older ones get overwritten (clears the buffer)
+	void setCapacity(const int& ticks);
+	void clear();
+
+	// stores the changes of the passed units since the last call, call after every tick
+	void record(const vector<BaseUnit*>& units, const Vector2df& drawOffset);
+	// reverts the units and drawOffset by one tick
+	// returns false if there is no more history (or the units have changed)
+	bool stepBack(const vector<BaseUnit*>& units, Vector2df& drawOffset);
+
+	int getLength() const {return count;} // ticks which can be rewound
+	int getMemoryUsage() const; // bytes used by the recorded ticks
+
+private:
+	struct UnitState
+	{
+		Vector2df position;
+		Vector2df velocity;
+		Vector2df acceleration[2];
+		int direction;
+		int flags;
+		int currentOrder;
+		int orderTimer;
+		bool orderRunning;
+		int colour;
+	};
+	enum StateField
+	{
+		sfPosition=1,
+		sfVelocity=2,
+		sfAcceleration=4,
+		sfDirection=8,
+		sfFlags=16,
+		sfOrder=32,
+		sfColour=64
+	};
+
+	static void readState(const BaseUnit* const unit, UnitState& state);
+	static void writeState(BaseUnit* const unit, const UnitState& state);
+	// returns the fields differing between the two states
+	static int compare(const UnitState& a, const UnitState& b);
+
+	vector<vector<char> > ticks; // ring of deltas, memory is kept when overwriting
+	int first; // oldest tick in the ring
+	int count;
+
+	vector<BaseUnit*> tracked; // units of the last record call
+	vector<UnitState> current; // their state after the last recorded tick
+	Vector2df lastOffset;
+};
+
+#endif // REWINDBUFFER_H
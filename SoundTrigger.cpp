@@ -27,11 +27,13 @@
 #include "MusicCache.h"
 #include "Level.h"
 
+const KeywordTable SoundTrigger::stringToProp = KeywordTable(&BaseTrigger::stringToProp)
+	.add("file",spFile)
+	.add("playcount",spPlayCount)
+	.add("loops",spLoops);
+
 SoundTrigger::SoundTrigger(Level* newParent) : BaseTrigger(newParent)
 {
-	stringToProp["file"] = spFile;
-	stringToProp["playcount"] = spPlayCount;
-	stringToProp["loops"] = spLoops;
 	filename = "";
 	playcount = 1;
 	count = 0;
@@ -46,6 +46,8 @@ protected:
 		spLoops,
 		spEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 
 	string filename;
 	int playcount;
@@ -0,0 +1,108 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "SpriteStates.h"
+
+map<string,int> StateNames::nameToID;
+vector<string> StateNames::names;
+
+///---public---
+
+int StateNames::intern(CRstring name)
+{
+	init();
+	map<string,int>::const_iterator I = nameToID.find(name);
+	if (I != nameToID.end())
+		return I->second;
+	names.push_back(name);
+	nameToID[name] = names.size() - 1;
+	return names.size() - 1;
+}
+
+int StateNames::find(CRstring name)
+{
+	init();
+	map<string,int>::const_iterator I = nameToID.find(name);
+	if (I != nameToID.end())
+		return I->second;
+	return STATE_NONE;
+}
+
+string StateNames::getName(CRint id)
+{
+	init();
+	if (id < 0 || id >= (int)names.size())
+		return "";
+	return names[id];
+}
+
+int StateNames::size()
+{
+	init();
+	return names.size();
+}
+
+void SpriteStateList::set(CRint id, AnimatedSprite* const sprite)
+{
+	if (id < 0)
+		return;
+	if (id >= (int)sprites.size())
+	{
+		sprites.resize(id + 1,NULL);
+		present.resize(id + 1,false);
+	}
+	if (sprites[id] != sprite)
+		delete sprites[id];
+	sprites[id] = sprite;
+	present[id] = true;
+}
+
+void SpriteStateList::clear()
+{
+	for (vector<AnimatedSprite*>::iterator I = sprites.begin(); I != sprites.end(); ++I)
+	{
+		delete (*I);
+	}
+	sprites.clear();
+	present.clear();
+}
+
+///---private---
+
+void StateNames::init()
+{
+	if (not names.empty())
+		return;
+
+	// same order as SpriteStateID
+	const char* builtIn[] = {"default","stand","wave","runleft","runright",
+		"turnleft","turnright","jumpleft","jumpright","fallleft","fallright",
+		"flyleft","flyright","pushleft","pushright","on","off","open","closed",
+		"linked","key","jump","swap","suicide"};
+	for (int I = 0; I < ssEOL; ++I)
+	{
+		names.push_back(builtIn[I]);
+		nameToID[builtIn[I]] = I;
+	}
+}
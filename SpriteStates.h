@@ -0,0 +1,121 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef SPRITESTATES_H
+#define SPRITESTATES_H
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "PenjinTypes.h"
+#include "AnimatedSprite.h"
+
+#define STATE_NONE -1
+
+/**
+Sprite state names are interned into small integer IDs when loading, so units
+can switch and compare states without string operations on every tick
+The states used in code are registered first, in the order of SpriteStateID
+Names are only added while loading (preview workers hold LevelLoader's lock then)
+**/
+
+enum SpriteStateID
+{
+	ssDefault=0,
+	ssStand,
+	ssWave,
+	ssRunLeft,
+	ssRunRight,
+	ssTurnLeft,
+	ssTurnRight,
+	ssJumpLeft,
+	ssJumpRight,
+	ssFallLeft,
+	ssFallRight,
+	ssFlyLeft,
+	ssFlyRight,
+	ssPushLeft,
+	ssPushRight,
+	ssOn,
+	ssOff,
+	ssOpen,
+	ssClosed,
+	ssLinked,
+	ssKey,
+	ssJump,
+	ssSwap,
+	ssSuicide,
+	ssEOL // end of list, states from level files start here
+};
+
+class StateNames
+{
+public:
+	// returns the ID of the passed state name, adding the name if it is new
+	static int intern(CRstring name);
+	// returns the ID of the passed state name or STATE_NONE if it was never interned
+	static int find(CRstring name);
+	// returns the name of the state or an empty string for STATE_NONE
+	static string getName(CRint id);
+	static int size();
+
+private:
+	static void init();
+	static map<string,int> nameToID;
+	static vector<string> names;
+};
+
+/**
+The sprites of a unit indexed by state ID
+A state can be present without a sprite (NULL), sprites are deleted on clear
+and destruction
+**/
+
+class SpriteStateList
+{
+public:
+	SpriteStateList() {}
+	~SpriteStateList() {clear();}
+
+	// whether the state has been set (the sprite might still be NULL)
+	inline bool has(CRint id) const
+	{
+		return id >= 0 && id < (int)present.size() && present[id];
+	}
+	inline AnimatedSprite* get(CRint id) const
+	{
+		return has(id) ? sprites[id] : NULL;
+	}
+	// sets the sprite of the state, a previous sprite of that state is deleted
+	void set(CRint id, AnimatedSprite* const sprite);
+	// deletes all sprites and removes all states
+	void clear();
+
+private:
+	vector<AnimatedSprite*> sprites;
+	vector<bool> present;
+};
+
+#endif // SPRITESTATES_H
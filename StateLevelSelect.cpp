@@ -73,6 +73,8 @@ struct VecComp
 };
 
 map<string, pair<string, SDL_Surface*> > StateLevelSelect::previewCache;
+SDL_mutex* StateLevelSelect::previewCacheLock = SDL_CreateMutex();
+PreviewCache StateLevelSelect::previewFileCache;
 Vector2di StateLevelSelect::saveChapterSel = Vector2di(0,0);
 map<Vector2di, Vector2di, VecComp> StateLevelSelect::saveLevelSel;
 
@@ -82,6 +84,7 @@ struct PreviewData
 	string name;
 	SDL_Surface* surface;
 	bool hasBeenLoaded;
+	bool started; // a worker has taken this item
 };
 StateLevelSelect::StateLevelSelect()
 {
@@ -150,11 +153,19 @@ StateLevelSelect::StateLevelSelect()
 
 	// thread stuff
 	levelLock = SDL_CreateMutex();
-	levelThread = NULL;
 	abortLevelLoading = false;
+	levelFocus = 0;
+	levelFirstVisible = 0;
+	maxUnlocked = 0;
 	chapterLock = SDL_CreateMutex();
-	chapterThread = NULL;
 	abortChapterLoading = false;
+	chapterFocus = 0;
+	chapterFirstVisible = 0;
+	for (int I = 0; I < PREVIEW_WORKERS; ++I)
+	{
+		levelThreads[I] = NULL;
+		chapterThreads[I] = NULL;
+	}
 
 	levelLister.addFilter("txt");
 	dirLister.addFilter("DIR");
@@ -196,12 +207,8 @@ void StateLevelSelect::clear()
 void StateLevelSelect::clearLevelListing()
 {
 	abortLevelLoading = true;
-	int* status = NULL;
-	if (levelThread)
-	{
-		SDL_WaitThread(levelThread,status);
-		levelThread = NULL;
-	}
+	waitForWorkers(levelThreads);
+	previewFileCache.save();
 
 	levelPreviews.clear();
 	delete exChapter;
@@ -211,12 +218,7 @@ void StateLevelSelect::clearLevelListing()
 void StateLevelSelect::clearChapterListing()
 {
 	abortChapterLoading = true;
-	int *status = NULL;
-	if (chapterThread)
-	{
-		SDL_WaitThread(chapterThread, status);
-		chapterThread = NULL;
-	}
+	waitForWorkers(chapterThreads);
 
 	chapterPreviews.clear();
 }
@@ -445,6 +447,21 @@ void StateLevelSelect::update()
 		cursor.setPosition(selection.x * size.x + (selection.x + 1) * spacing.x - CURSOR_BORDER,
 						   OFFSET_Y + (selection.y - gridOffset) * size.y + (selection.y - gridOffset + 1) * spacing.y - CURSOR_BORDER);
 
+		// let the workers generate previews around the selection first
+		if (state == lsLevel)
+		{
+			SDL_mutexP(levelLock);
+			levelFocus = selection.x + selection.y * PREVIEW_COUNT_X;
+			levelFirstVisible = gridOffset * PREVIEW_COUNT_X;
+			SDL_mutexV(levelLock);
+		}
+		else
+		{
+			SDL_mutexP(chapterLock);
+			chapterFocus = selection.x + selection.y * PREVIEW_COUNT_X;
+			chapterFirstVisible = gridOffset * PREVIEW_COUNT_X;
+			SDL_mutexV(chapterLock);
+		}
 	}
 	EFFECTS->update();
 }
@@ -664,20 +681,21 @@ void StateLevelSelect::setLevelDirectory(CRstring dir)
 	files.erase(files.begin()); // delete first element which is the current folder
 
 	//#ifdef _DEBUG
-	PreviewData bench = {BENCHMARK_LEVEL,"[BENCHMARK]",NULL,false};
+	PreviewData bench = {BENCHMARK_LEVEL,"[BENCHMARK]",NULL,false,false};
 	levelPreviews.push_back(bench);
 	//#endif
 
 	// initialize map
 	for (vector<string>::const_iterator file = files.begin(); file < files.end(); ++file)
 	{
-		PreviewData temp = {dir + (*file),"",NULL,false};
+		PreviewData temp = {dir + (*file),"",NULL,false,false};
 		levelPreviews.push_back(temp);
 	}
 	printf("%i files found in level directory\n",levelPreviews.size());
 
+	maxUnlocked = 0;
 	abortLevelLoading = false;
-	levelThread = SDL_CreateThread(StateLevelSelect::loadLevelPreviews, this);
+	startWorkers(levelThreads, StateLevelSelect::levelPreviewWorker);
 
 	files.clear();
 }
@@ -709,20 +727,20 @@ void StateLevelSelect::setChapterDirectory(CRstring dir)
 		// remove image from cache to prevent double freeing
 		SURFACE_CACHE->removeSurface("images/general/levelfolder.png",false);
 	}
-	PreviewData temp = {DEFAULT_LEVEL_FOLDER,"[SINGLE LEVELS]",img,true};
+	PreviewData temp = {DEFAULT_LEVEL_FOLDER,"[SINGLE LEVELS]",img,true,true};
 	chapterPreviews.push_back(temp);
 
 	// set paths to info.txt files and initialize map
 	for (vector<string>::iterator item = files.begin(); item < files.end(); ++item)
 	{
 		(*item) = dir + (*item) + "/" + DEFAULT_CHAPTER_INFO_FILE;
-		PreviewData temp2 = {(*item),"",NULL,false};
+		PreviewData temp2 = {(*item),"",NULL,false,false};
 		chapterPreviews.push_back(temp2);
 	}
 	printf("%i chapters found\n",chapterPreviews.size()-1);
 
 	abortChapterLoading = false;
-	chapterThread = SDL_CreateThread(StateLevelSelect::loadChapterPreviews,this);
+	startWorkers(chapterThreads, StateLevelSelect::chapterPreviewWorker);
 }
 
 void StateLevelSelect::exploreChapter(CRstring filename)
@@ -738,13 +756,14 @@ void StateLevelSelect::exploreChapter(CRstring filename)
 
 	for (vector<string>::const_iterator file = exChapter->levels.begin(); file != exChapter->levels.end(); ++file)
 	{
-		PreviewData temp = {exChapter->path + (*file),"",NULL,false};
+		PreviewData temp = {exChapter->path + (*file),"",NULL,false,false};
 		levelPreviews.push_back(temp);
 	}
 	printf("Chapter has %i levels\n",levelPreviews.size());
 
+	maxUnlocked = exChapter->getProgress();
 	abortLevelLoading = false;
-	levelThread = SDL_CreateThread(StateLevelSelect::loadLevelPreviews,this);
+	startWorkers(levelThreads, StateLevelSelect::levelPreviewWorker);
 }
 
 /// ---protected---
@@ -802,7 +821,10 @@ void StateLevelSelect::switchState(const LevelSelectState& toState)
 void StateLevelSelect::doSelection()
 {
 	if ( returnToMenu )
+	{
+		stopWorkers();
 		setNextState(STATE_MAIN);
+	}
 	int value = selection.y * PREVIEW_COUNT_X + selection.x;
 	if ( state == lsIntermediate )
 	{
@@ -812,6 +834,7 @@ void StateLevelSelect::doSelection()
 			if (fadeTimer < 0)
 				MUSIC_CACHE->playSound("sounds/level_play.wav");
 			if ( fadeOut() ) return;
+			stopWorkers();
 			ENGINE->playChapter(chapterPreviews[value].filename);
 			break;
 		case 1: // explore
@@ -822,6 +845,7 @@ void StateLevelSelect::doSelection()
 			if (fadeTimer < 0)
 				MUSIC_CACHE->playSound("sounds/level_play.wav");
 			if ( fadeOut() ) return;
+			stopWorkers();
 			ENGINE->startChapterTrial();
 			ENGINE->playChapter(chapterPreviews[value].filename,0);
 			break;
@@ -841,6 +865,7 @@ void StateLevelSelect::doSelection()
 			abortLevelLoading = true;
 			abortChapterLoading = true;
 			if ( fadeOut() ) return;
+			stopWorkers();
 			ENGINE->playSingleLevel(levelPreviews[value].filename,STATE_LEVELSELECT);
 		}
 		else // exploring chapter -> start chapter at selected level
@@ -850,6 +875,7 @@ void StateLevelSelect::doSelection()
 				abortLevelLoading = true;
 				abortChapterLoading = true;
 				if ( fadeOut() ) return;
+				stopWorkers();
 				ENGINE->playChapter(exChapter->filename,value);
 			}
 		}
@@ -870,6 +896,7 @@ void StateLevelSelect::doSelection()
 				abortLevelLoading = true;
 				abortChapterLoading = true;
 				if ( fadeOut() ) return;
+				stopWorkers();
 				ENGINE->playSingleLevel(levelPreviews[value].filename,STATE_LEVELSELECT);
 			}
 			else // exploring chapter -> start chapter at selected level
@@ -879,6 +906,7 @@ void StateLevelSelect::doSelection()
 					abortLevelLoading = true;
 					abortChapterLoading = true;
 					if ( fadeOut() ) return;
+					stopWorkers();
 					ENGINE->playChapter(exChapter->filename,value);
 				}
 			}
@@ -957,163 +985,261 @@ void StateLevelSelect::checkGridOffset(const vector<PreviewData>& data, int& off
 }
 
 
-int StateLevelSelect::loadLevelPreviews(void* data)
+void StateLevelSelect::startWorkers(SDL_Thread** threads, int (*function)(void*))
 {
-	printf("Generating level previews images\n");
-	StateLevelSelect* self = (StateLevelSelect*)data;
-	vector<PreviewData>::iterator iter = self->levelPreviews.begin();
-	int levelNumber = 0;
-	int maxUnlocked = 0;
-	if (self->exChapter)
-		maxUnlocked = self->exChapter->getProgress();
+	for (int I = 0; I < PREVIEW_WORKERS; ++I)
+		threads[I] = SDL_CreateThread(function, this);
+}
 
-	while (not self->abortLevelLoading && iter != self->levelPreviews.end())
+void StateLevelSelect::waitForWorkers(SDL_Thread** threads)
+{
+	int* status = NULL;
+	for (int I = 0; I < PREVIEW_WORKERS; ++I)
 	{
-		// look for cached images by level filename
-		map<string,pair<string,SDL_Surface*> > ::iterator cachedData = self->previewCache.find( (*iter).filename );
-
-		if ( cachedData != self->previewCache.end() ) // found cached image
+		if (threads[I])
 		{
-			SDL_mutexP(self->levelLock);
-			(*iter).name = cachedData->second.first;
-			(*iter).surface = cachedData->second.second;
-			(*iter).hasBeenLoaded = true;
-			SDL_mutexV(self->levelLock);
+			SDL_WaitThread(threads[I], status);
+			threads[I] = NULL;
 		}
-		else
-		{
-			Level* level;
-			if (self->exChapter) // we are browsing a chapter
-			{
-				// check whether the level has been unlocked, else don't load
-				if (levelNumber <= maxUnlocked)
-					level = LEVEL_LOADER->loadLevelFromFile(iter->filename,self->exChapter->path);
-				else
-					level = NULL;
-			}
-			else
-				level = LEVEL_LOADER->loadLevelFromFile(iter->filename);
-
-			SDL_Surface* surf = NULL;
-			string levelName = "";
-			if (level)
-			{
-				levelName = level->name;
-				SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE,GFX::getXResolution(),GFX::getYResolution(),GFX::getVideoSurface()->format->BitsPerPixel,0,0,0,0);
-				level->init();
-				level->update(); // update once to properly position units
-				level->render(temp); // render at full resolution
-				// scale down, then delete full resolution copy
-				surf = zoomSurface(temp,(float)self->size.x / GFX::getXResolution(), (float)self->size.y / GFX::getYResolution(), SMOOTHING_OFF);
-				SDL_FreeSurface(temp);
-				self->previewCache[iter->filename] = make_pair(levelName, surf);
-			}
-			else // error on load
-			{
-				if (LEVEL_LOADER->errorString[0] != 0)
-					printf("ERROR: %s\n",LEVEL_LOADER->errorString.c_str());
-			}
-			SDL_mutexP(self->levelLock);
-			(*iter).surface = surf;
-			(*iter).name = levelName;
-			(*iter).hasBeenLoaded = true;
-			SDL_mutexV(self->levelLock);
-			delete level;
-		}
-		++iter;
-		++levelNumber;
 	}
-	if (self->abortLevelLoading)
+}
+
+void StateLevelSelect::stopWorkers()
+{
+	abortLevelLoading = true;
+	abortChapterLoading = true;
+	waitForWorkers(levelThreads);
+	waitForWorkers(chapterThreads);
+}
+
+int StateLevelSelect::nextPreview(vector<PreviewData>& data, SDL_mutex* const lock, CRint focus, CRint firstVisible)
+{
+	int lastVisible = firstVisible + PREVIEW_COUNT_X * PREVIEW_COUNT_Y;
+	int result = -1;
+	int bestDistance = INT_MAX;
+
+	SDL_mutexP(lock);
+	for (int I = 0; I < data.size(); ++I)
 	{
-		printf("Aborted level preview generation\n");
-		self->abortLevelLoading = false;
+		if (data[I].started)
+			continue;
+		int distance = abs(I - focus);
+		if (I < firstVisible || I >= lastVisible) // off-screen items come last
+			distance += data.size();
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			result = I;
+		}
 	}
-	else
-		printf("Finished generating level preview images\n");
-	return 0;
+	if (result >= 0)
+		data[result].started = true;
+	SDL_mutexV(lock);
+
+	return result;
 }
 
-int StateLevelSelect::loadChapterPreviews(void* data)
+int StateLevelSelect::levelPreviewWorker(void* data)
 {
 	StateLevelSelect* self = (StateLevelSelect*)data;
+	self->previewFileCache.load(PREVIEW_CACHE_FILE);
 
-	printf("Loading chapter preview images\n");
-	vector<PreviewData>::iterator iter = self->chapterPreviews.begin();
-	++iter; // skip level folder
-	Chapter chapter;
+	while (not self->abortLevelLoading)
+	{
+		SDL_mutexP(self->levelLock);
+		int focus = self->levelFocus;
+		int firstVisible = self->levelFirstVisible;
+		SDL_mutexV(self->levelLock);
+
+		int index = self->nextPreview(self->levelPreviews, self->levelLock, focus, firstVisible);
+		if (index < 0)
+			break;
+		self->loadLevelPreview(index);
+	}
+	if (self->abortLevelLoading)
+		printf("Aborted level preview generation\n");
+	self->previewFileCache.save();
+	return 0;
+}
 
-	while (not self->abortChapterLoading && iter != self->chapterPreviews.end())
+void StateLevelSelect::loadLevelPreview(CRint index)
+{
+	// the listing is only changed after all workers have finished
+	string filename = levelPreviews[index].filename;
+	string levelName = "";
+	SDL_Surface* surf = NULL;
+
+	// look for cached images by level filename
+	SDL_mutexP(previewCacheLock);
+	map<string,pair<string,SDL_Surface*> >::iterator cachedData = previewCache.find(filename);
+	bool cached = (cachedData != previewCache.end());
+	if (cached)
 	{
-		// look for cached images by chapter filename
-		map<string,pair<string, SDL_Surface*> >::iterator cachedData = self->previewCache.find( iter->filename );
+		levelName = cachedData->second.first;
+		surf = cachedData->second.second;
+	}
+	SDL_mutexV(previewCacheLock);
 
-		if ( cachedData != self->previewCache.end() ) // found cached image
+	// check whether the level has been unlocked, else don't load
+	if (not cached && (not exChapter || index <= maxUnlocked))
+	{
+		// previews from previous sessions
+		surf = previewFileCache.getPreview(filename,size.x,size.y,levelName);
+		if (not surf)
+			surf = renderLevelPreview(filename,levelName);
+		if (surf)
 		{
-			SDL_mutexP(self->chapterLock);
-			(*iter).name = cachedData->second.first;
-			(*iter).surface = cachedData->second.second;
-			(*iter).hasBeenLoaded = true;
-			SDL_mutexV(self->chapterLock);
+			SDL_mutexP(previewCacheLock);
+			previewCache[filename] = make_pair(levelName, surf);
+			SDL_mutexV(previewCacheLock);
 		}
+	}
+
+	SDL_mutexP(levelLock);
+	levelPreviews[index].surface = surf;
+	levelPreviews[index].name = levelName;
+	levelPreviews[index].hasBeenLoaded = true;
+	SDL_mutexV(levelLock);
+}
+
+SDL_Surface* StateLevelSelect::renderLevelPreview(CRstring filename, string& name)
+{
+	// loading and updating a level touches global state (physics parameters,
+	// surface cache, etc.), so only one worker at a time may do that
+	Level* level = NULL;
+	LEVEL_LOADER->lock();
+	if (not abortLevelLoading)
+	{
+		if (exChapter) // we are browsing a chapter
+			level = LEVEL_LOADER->loadLevelFromFile(filename,exChapter->path);
 		else
+			level = LEVEL_LOADER->loadLevelFromFile(filename);
+
+		if (not level && LEVEL_LOADER->errorString[0] != 0) // error on load
+			printf("ERROR: %s\n",LEVEL_LOADER->errorString.c_str());
+	}
+	SDL_Surface* temp = NULL;
+	if (level && not abortLevelLoading)
+	{
+		level->init();
+		level->update(); // update once to properly position units
+
+		// the level's sprites are shared with other levels through the surface
+		// cache, so blitting them has to happen under the lock, too
+		name = level->name;
+		temp = SDL_CreateRGBSurface(SDL_SWSURFACE,GFX::getXResolution(),GFX::getYResolution(),GFX::getVideoSurface()->format->BitsPerPixel,0,0,0,0);
+		level->render(temp); // render at full resolution
+	}
+	LEVEL_LOADER->unlock();
+
+	// scaling works on this worker's surface only
+	SDL_Surface* surf = NULL;
+	if (temp)
+	{
+		if (not abortLevelLoading)
 		{
-			if (not chapter.loadFromFile(iter->filename))
-			{
-				// oops, we have error
-				SDL_mutexP(self->chapterLock);
-				(*iter).hasBeenLoaded = true;
-				SDL_mutexV(self->chapterLock);
-				printf("ERROR: %s\n",chapter.errorString.c_str());
-				++iter;
-				continue;
-			}
+			// scale down, then delete full resolution copy
+			surf = zoomSurface(temp,(float)size.x / GFX::getXResolution(), (float)size.y / GFX::getYResolution(), SMOOTHING_OFF);
+			previewFileCache.addPreview(filename, surf, name);
+		}
+		SDL_FreeSurface(temp);
+	}
 
+	LEVEL_LOADER->lock();
+	delete level;
+	LEVEL_LOADER->unlock();
+	return surf;
+}
 
-			SDL_mutexP(self->chapterLock);
-			(*iter).name = chapter.name;
-			SDL_mutexV(self->chapterLock);
+int StateLevelSelect::chapterPreviewWorker(void* data)
+{
+	StateLevelSelect* self = (StateLevelSelect*)data;
 
+	while (not self->abortChapterLoading)
+	{
+		SDL_mutexP(self->chapterLock);
+		int focus = self->chapterFocus;
+		int firstVisible = self->chapterFirstVisible;
+		SDL_mutexV(self->chapterLock);
 
-			// loaded chapter file
-			if (chapter.imageFile[0] != 0) // we have an image file
-			{
-				SDL_Surface* img = SURFACE_CACHE->loadSurface(chapter.imageFile,chapter.path,true);
-				if (img) // load successful
-				{
-					if (img->w != self->size.x || img->h != self->size.y) // scale if needed
-					{
-						img = zoomSurface(img,(float)self->size.x / (float)img->w , (float)self->size.y / (float)img->h, SMOOTHING_OFF);
-					}
-					else // remove the surface from the cache to prevent double freeing
-					{
-						SURFACE_CACHE->removeSurface(chapter.imageFile,false);
-						SURFACE_CACHE->removeSurface(chapter.path + chapter.imageFile,false);
-					}
-					self->previewCache[iter->filename] = make_pair((*iter).name, img);
-					SDL_mutexP(self->chapterLock);
-					(*iter).surface = img;
-					(*iter).hasBeenLoaded = true;
-					SDL_mutexV(self->chapterLock);
-					++iter;
-					continue;
-				}
-			}
-			// reaching here we either have no image file or loading it resulted in an error
-			// render text instead
-			SDL_Surface* surf = SDL_CreateRGBSurface(SDL_SWSURFACE,self->size.x,self->size.y,GFX::getVideoSurface()->format->BitsPerPixel,0,0,0,0);
-			SDL_FillRect(surf, NULL, SDL_MapRGB(surf->format,0,0,0));
-			self->imageText.print(surf,(*iter).name);
-			self->previewCache[iter->filename] = make_pair((*iter).name, surf);
-			SDL_mutexP(self->chapterLock);
-			(*iter).surface = surf;
-			(*iter).hasBeenLoaded = true;
-			SDL_mutexV(self->chapterLock);
-		}
-		++iter;
+		int index = self->nextPreview(self->chapterPreviews, self->chapterLock, focus, firstVisible);
+		if (index < 0)
+			break;
+		self->loadChapterPreview(index);
 	}
 	if (self->abortChapterLoading)
 		printf("Aborted chapter preview generation\n");
-	else
-		printf("Finished generating chapter preview images\n");
 	return 0;
 }
+
+void StateLevelSelect::loadChapterPreview(CRint index)
+{
+	string filename = chapterPreviews[index].filename;
+
+	// look for cached images by chapter filename
+	SDL_mutexP(previewCacheLock);
+	map<string,pair<string, SDL_Surface*> >::iterator cachedData = previewCache.find(filename);
+	if (cachedData != previewCache.end()) // found cached image
+	{
+		SDL_mutexP(chapterLock);
+		chapterPreviews[index].name = cachedData->second.first;
+		chapterPreviews[index].surface = cachedData->second.second;
+		chapterPreviews[index].hasBeenLoaded = true;
+		SDL_mutexV(chapterLock);
+		SDL_mutexV(previewCacheLock);
+		return;
+	}
+	SDL_mutexV(previewCacheLock);
+
+	Chapter chapter;
+	if (not chapter.loadFromFile(filename))
+	{
+		// oops, we have error
+		SDL_mutexP(chapterLock);
+		chapterPreviews[index].hasBeenLoaded = true;
+		SDL_mutexV(chapterLock);
+		printf("ERROR: %s\n",chapter.errorString.c_str());
+		return;
+	}
+
+	SDL_mutexP(chapterLock);
+	chapterPreviews[index].name = chapter.name;
+	SDL_mutexV(chapterLock);
+
+	SDL_Surface* surf = NULL;
+	if (chapter.imageFile[0] != 0 && not abortChapterLoading) // we have an image file
+	{
+		// not optimized, SDL_DisplayFormat may only be called from the main thread
+		surf = SURFACE_CACHE->loadSurface(chapter.imageFile,chapter.path,false);
+		if (surf) // load successful
+		{
+			if (surf->w != size.x || surf->h != size.y) // scale if needed
+			{
+				surf = zoomSurface(surf,(float)size.x / (float)surf->w , (float)size.y / (float)surf->h, SMOOTHING_OFF);
+			}
+			else // remove the surface from the cache to prevent double freeing
+			{
+				SURFACE_CACHE->removeSurface(chapter.imageFile,false);
+				SURFACE_CACHE->removeSurface(chapter.path + chapter.imageFile,false);
+			}
+		}
+	}
+	if (not surf)
+	{
+		// reaching here we either have no image file or loading it resulted in an error
+		// render text instead (the text object is shared by all workers)
+		surf = SDL_CreateRGBSurface(SDL_SWSURFACE,size.x,size.y,GFX::getVideoSurface()->format->BitsPerPixel,0,0,0,0);
+		SDL_FillRect(surf, NULL, SDL_MapRGB(surf->format,0,0,0));
+		SDL_mutexP(chapterLock);
+		imageText.print(surf,chapter.name);
+		SDL_mutexV(chapterLock);
+	}
+
+	SDL_mutexP(previewCacheLock);
+	previewCache[filename] = make_pair(chapter.name, surf);
+	SDL_mutexV(previewCacheLock);
+	SDL_mutexP(chapterLock);
+	chapterPreviews[index].surface = surf;
+	chapterPreviews[index].hasBeenLoaded = true;
+	SDL_mutexV(chapterLock);
+}
@@ -37,6 +37,11 @@
 #include "Text.h"
 
 #include "Chapter.h"
+#include "PreviewCache.h"
+
+// number of threads generating preview images concurrently
+// loading and simulating levels is serialized, rendering and scaling is not
+#define PREVIEW_WORKERS 3
 
 /**
 Displays chapters and levels graphically
@@ -104,10 +109,24 @@ protected:
 	// and makes sure the selection is visible on screen with the passed display offset
 	void checkGridOffset( const vector<PreviewData> &data, int &offset );
 
-	// Thread functions, which load SDL_Surfaces* from chapter or level
+	// Worker thread functions, which load SDL_Surfaces* from chapter or level
 	// data to display the preview images and save them in the vectors
-	static int loadLevelPreviews( void *data );
-	static int loadChapterPreviews( void *data );
+	// every worker takes the next item closest to the selection until none is left
+	static int levelPreviewWorker( void *data );
+	static int chapterPreviewWorker( void *data );
+	// returns the index of the next item to load (and marks it as started) or -1
+	// items on screen come first, ordered by their distance to the passed focus
+	int nextPreview( vector<PreviewData> &data, SDL_mutex *const lock, CRint focus, CRint firstVisible );
+	// load a single preview image, these are called by the workers
+	void loadLevelPreview( CRint index );
+	void loadChapterPreview( CRint index );
+	// loads, simulates and renders a level to a preview image, returns NULL on error or abort
+	SDL_Surface* renderLevelPreview( CRstring filename, string &name );
+	void startWorkers( SDL_Thread **threads, int (*function)(void*) );
+	void waitForWorkers( SDL_Thread **threads );
+	// aborts and joins all workers, has to be called before leaving the state
+	// or changing the chapter (which unmounts the chapter's pack)
+	void stopWorkers();
 
 	AnimatedSprite bg;
 	AnimatedSprite error;
@@ -132,15 +151,24 @@ protected:
 	vector<PreviewData> levelPreviews;
 	vector<PreviewData> chapterPreviews;
 	static map<string, pair<string, SDL_Surface*> > previewCache;
+	static SDL_mutex *previewCacheLock; // previewCache is shared by all workers
+	// previews of previous sessions (saved after generating previews)
+	static PreviewCache previewFileCache;
 
-	// mutex to prevent sharing violations between main and loading thread
+	// mutex to prevent sharing violations between main and loading threads
+	// also guards the focus variables, which are set by the main thread
 	SDL_mutex *levelLock;
-	SDL_Thread *levelThread;
+	SDL_Thread *levelThreads[PREVIEW_WORKERS];
 	bool abortLevelLoading; // if true level preview generation will exit
+	int levelFocus; // index of the selected level
+	int levelFirstVisible; // index of the first level on screen
+	int maxUnlocked; // index of the last unlocked level of exChapter
 
 	SDL_mutex *chapterLock;
-	SDL_Thread *chapterThread;
+	SDL_Thread *chapterThreads[PREVIEW_WORKERS];
 	bool abortChapterLoading; // if true chapter preview generation will exit
+	int chapterFocus;
+	int chapterFirstVisible;
 
 	bool returnToMenu;
 
@@ -0,0 +1,168 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "SurfaceScaler.h"
+
+#include <cmath>
+#include <cstring>
+
+// 24bit pixels are copied as a whole using this
+struct Pixel24
+{
+	Uint8 bytes[3];
+};
+
+// copies the pixels from src to dst using the index tables, pixel size is the size of T
+template <typename T>
+static void scalePixels(const SDL_Surface* const src, SDL_Surface* const dst, const vector<int>& rows,
+						const vector<int>& cols, CRint firstRow, CRint firstCol)
+{
+	const int colCount = cols.size();
+	const int rowCount = rows.size();
+	int lastRow = -1;
+	const T* lastLine = NULL;
+	for (int Y = 0; Y < rowCount; ++Y)
+	{
+		T* dstLine = (T*)((Uint8*)dst->pixels + (firstRow + Y) * dst->pitch) + firstCol;
+		// scaling up repeats source rows, so just copy the row above
+		if (rows[Y] == lastRow)
+		{
+			memcpy(dstLine,lastLine,colCount * sizeof(T));
+			continue;
+		}
+		const T* srcLine = (const T*)((const Uint8*)src->pixels + rows[Y] * src->pitch);
+		for (int X = 0; X < colCount; ++X)
+			dstLine[X] = srcLine[cols[X]];
+		lastRow = rows[Y];
+		lastLine = dstLine;
+	}
+}
+
+SurfaceScaler::SurfaceScaler()
+{
+	buffer = NULL;
+	firstRow = 0;
+	firstCol = 0;
+	lastFactorX = 0.0f;
+	lastFactorY = 0.0f;
+	lastOffsetX = 0;
+	lastOffsetY = 0;
+	lastWidth = 0;
+	lastHeight = 0;
+}
+
+SurfaceScaler::~SurfaceScaler()
+{
+	clear();
+}
+
+void SurfaceScaler::setup(const SDL_Surface* const surface, const float& factorX, const float& factorY, CRint offsetX, CRint offsetY)
+{
+	if (factorX == lastFactorX && factorY == lastFactorY && offsetX == lastOffsetX &&
+			offsetY == lastOffsetY && surface->w == lastWidth && surface->h == lastHeight)
+		return;
+
+	buildTable(cols,firstCol,surface->w,factorX,offsetX);
+	buildTable(rows,firstRow,surface->h,factorY,offsetY);
+	lastFactorX = factorX;
+	lastFactorY = factorY;
+	lastOffsetX = offsetX;
+	lastOffsetY = offsetY;
+	lastWidth = surface->w;
+	lastHeight = surface->h;
+}
+
+void SurfaceScaler::scale(SDL_Surface* const surface)
+{
+	if (rows.empty() || cols.empty() || surface->w != lastWidth || surface->h != lastHeight)
+		return;
+
+	if (not buffer || buffer->w != surface->w || buffer->h != surface->h ||
+			buffer->format->BitsPerPixel != surface->format->BitsPerPixel)
+	{
+		SDL_FreeSurface(buffer);
+		buffer = SDL_CreateRGBSurface(SDL_SWSURFACE,surface->w,surface->h,surface->format->BitsPerPixel,
+				surface->format->Rmask,surface->format->Gmask,surface->format->Bmask,surface->format->Amask);
+		if (not buffer)
+		{
+			printf("ERROR: Could not create buffer for scaling: %s\n",SDL_GetError());
+			return;
+		}
+	}
+	SDL_BlitSurface(surface,NULL,buffer,NULL);
+
+	if (SDL_MUSTLOCK(surface))
+		SDL_LockSurface(surface);
+	switch (surface->format->BytesPerPixel)
+	{
+	case 1:
+		scalePixels<Uint8>(buffer,surface,rows,cols,firstRow,firstCol);
+		break;
+	case 2:
+		scalePixels<Uint16>(buffer,surface,rows,cols,firstRow,firstCol);
+		break;
+	case 3:
+		scalePixels<Pixel24>(buffer,surface,rows,cols,firstRow,firstCol);
+		break;
+	case 4:
+		scalePixels<Uint32>(buffer,surface,rows,cols,firstRow,firstCol);
+		break;
+	}
+	if (SDL_MUSTLOCK(surface))
+		SDL_UnlockSurface(surface);
+}
+
+void SurfaceScaler::clear()
+{
+	SDL_FreeSurface(buffer);
+	buffer = NULL;
+	rows.clear();
+	cols.clear();
+	lastWidth = 0;
+	lastHeight = 0;
+}
+
+/// ---protected----------------------------------------------------------------
+
+void SurfaceScaler::buildTable(vector<int>& table, int& first, CRint size, const float& factor, CRint offset) const
+{
+	table.clear();
+	first = 0;
+	if (factor <= 0.0f)
+		return;
+
+	// the mapping is monotonic, so valid source indices form one range
+	for (int I = 0; I < size; ++I)
+	{
+		int src = floor((float)(I + offset) / factor);
+		if (src < 0)
+		{
+			first = I + 1;
+			continue;
+		}
+		if (src >= size)
+			break;
+		table.push_back(src);
+	}
+}
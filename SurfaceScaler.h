@@ -0,0 +1,75 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef SURFACESCALER_H
+#define SURFACESCALER_H
+
+#include <SDL/SDL.h>
+#include <vector>
+
+#include "PenjinTypes.h"
+
+/**
+Nearest-neighbour scaling of a surface onto itself, used for levels with the
+scale flags set
+Index tables mapping every target row and column to its source are only
+rebuilt when factor, offset or surface size change and the copy of the source
+is kept between frames, so scaling a frame does not allocate anything
+**/
+
+class SurfaceScaler
+{
+public:
+	SurfaceScaler();
+	~SurfaceScaler();
+
+	// target pixel (X,Y) will show source pixel ((X + offsetX) / factorX, (Y + offsetY) / factorY)
+	// pixels mapping outside the surface are left untouched
+	void setup(const SDL_Surface* const surface, const float& factorX, const float& factorY, CRint offsetX, CRint offsetY);
+	// scales the surface passed to setup using the current tables
+	void scale(SDL_Surface* const surface);
+
+	// frees the copy of the surface and the tables
+	void clear();
+
+protected:
+	// fills table with the source index of every target index in [0,size)
+	// first is set to the first target index with a valid source
+	void buildTable(vector<int>& table, int& first, CRint size, const float& factor, CRint offset) const;
+
+	SDL_Surface* buffer; // copy of the unscaled frame
+	vector<int> rows;
+	vector<int> cols;
+	int firstRow;
+	int firstCol;
+
+	float lastFactorX;
+	float lastFactorY;
+	int lastOffsetX;
+	int lastOffsetY;
+	int lastWidth;
+	int lastHeight;
+};
+
+#endif // SURFACESCALER_H
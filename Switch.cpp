@@ -30,7 +30,14 @@
 
 #define SWITCH_TIMEOUT 30
 
-map<string,int> Switch::stringToFunc;
+const KeywordTable Switch::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("function",spFunction);
+
+const KeywordTable Switch::stringToFunc = KeywordTable()
+	.add("movement",sfMovement)
+	.add("parameter",sfParameter)
+	.add("parameteron",sfParameterOn)
+	.add("parameteroff",sfParameterOff);
 
 Switch::Switch(Level* newParent) : BaseUnit(newParent)
 {
@@ -44,15 +51,12 @@ Switch::Switch(Level* newParent) : BaseUnit(newParent)
 	switchTimer = 0;
 	switchOn = NULL;
 	switchOff = NULL;
+	paramOnKey = upUnknown;
+	paramOffKey = upUnknown;
+	paramOnState = STATE_NONE;
+	paramOffState = STATE_NONE;
 
 	linkTimer = 0;
-
-	stringToProp["function"] = spFunction;
-
-	stringToFunc["movement"] = sfMovement;
-	stringToFunc["parameter"] = sfParameter;
-	stringToFunc["parameteron"] = sfParameterOn;
-	stringToFunc["parameteroff"] = sfParameterOff;
 }
 
 Switch::~Switch()
@@ -73,23 +77,19 @@ bool Switch::load(list<PARAMETER_TYPE >& params)
 	}
 	else // clear sprites loaded by BaseUnit
 	{
-		for (map<string,AnimatedSprite*>::iterator I = states.begin(); I != states.end(); ++I)
-		{
-			delete I->second;
-		}
 		states.clear();
 	}
 	AnimatedSprite* temp = new AnimatedSprite;
 	temp->loadFrames(getSurface(imageOverwrite),2,1,0,1);
 	temp->setTransparentColour(MAGENTA);
-	states["off"] = temp;
+	states.set(ssOff,temp);
 	temp = new AnimatedSprite;
 	temp->loadFrames(getSurface(imageOverwrite),2,1,1,1);
 	temp->setTransparentColour(MAGENTA);
-	states["on"] = temp;
+	states.set(ssOn,temp);
 
-	if (startingState[0] == 0 || startingState == "default")
-		startingState = "off";
+	if (startingState == STATE_NONE || startingState == ssDefault)
+		startingState = ssOff;
 	setSpriteState(startingState,true);
 
 	if (!switchOn || !switchOff)
@@ -174,6 +174,12 @@ bool Switch::processParameter(const PARAMETER_TYPE& value)
 		default:
 			printf("Unknown function parameter for switch \"%s\"\n",id.c_str());
 		}
+		paramOnKey = stringToProp[paramOn.first];
+		paramOffKey = stringToProp[paramOff.first];
+		if (paramOnKey == upState)
+			paramOnState = StateNames::intern(paramOn.second);
+		if (paramOffKey == upState)
+			paramOffState = StateNames::intern(paramOff.second);
 		break;
 	}
 	case BaseUnit::upTarget:
@@ -190,7 +196,7 @@ bool Switch::processParameter(const PARAMETER_TYPE& value)
 
 void Switch::reset()
 {
-	if (startingState == "off" && switchOff)
+	if (startingState == ssOff && switchOff)
 		for (vector<BaseUnit*>::iterator I = targets.begin(); I != targets.end(); ++I)
 			(this->*switchOff)(*I);
 	else if (switchOn)
@@ -208,7 +214,7 @@ void Switch::update()
 		targets.clear();
 		parent->getUnitsByID(targetIDs,targets);
 
-		if (startingState == "off" && switchOff)
+		if (startingState == ssOff && switchOff)
 			for (vector<BaseUnit*>::iterator I = targets.begin(); I != targets.end(); ++I)
 				(this->*switchOff)(*I);
 		else if (switchOn)
@@ -237,9 +243,9 @@ void Switch::hitUnit(const UnitCollisionEntry& entry)
 	{
 		if (parent->getInput()->isUp() && switchTimer == 0)
 		{
-			if (currentState == "off")
+			if (currentState == ssOff)
 			{
-				setSpriteState("on",true);
+				setSpriteState(ssOn,true);
 				if (switchOn)
 					for (vector<BaseUnit*>::iterator I = targets.begin(); I != targets.end(); ++I)
 						(this->*switchOn)(*I);
@@ -247,7 +253,7 @@ void Switch::hitUnit(const UnitCollisionEntry& entry)
 			}
 			else
 			{
-				setSpriteState("off",true);
+				setSpriteState(ssOff,true);
 				if (switchOff)
 					for (vector<BaseUnit*>::iterator I = targets.begin(); I != targets.end(); ++I)
 						(this->*switchOff)(*I);
@@ -280,29 +286,29 @@ void Switch::movementOff(BaseUnit* unit)
 
 void Switch::parameterOn(BaseUnit* unit)
 {
-	if (paramOn.first == "state")
+	if (paramOnKey == upState)
 	{
-		unit->setSpriteState(paramOn.second,true);
+		unit->setSpriteState(paramOnState,true);
 		return;
 	}
-	if (paramOn.first == "order")
+	if (paramOnKey == upOrder)
 		unit->resetOrder(true);
 	unit->processParameter(paramOn);
-	if (paramOn.first == "order")
+	if (paramOnKey == upOrder)
 		unit->resetOrder(false);
 }
 
 void Switch::parameterOff(BaseUnit* unit)
 {
-	if (paramOff.first == "state")
+	if (paramOffKey == upState)
 	{
-		unit->setSpriteState(paramOff.second,true);
+		unit->setSpriteState(paramOffState,true);
 		return;
 	}
-	if (paramOff.first == "order")
+	if (paramOffKey == upOrder)
 		unit->resetOrder(true);
 	unit->processParameter(paramOff);
-	if (paramOff.first == "order")
+	if (paramOffKey == upOrder)
 		unit->resetOrder(false);
 }
 
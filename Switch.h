@@ -47,6 +47,12 @@ protected:
 	FuncPtr switchOff;
 	PARAMETER_TYPE paramOn;
 	PARAMETER_TYPE paramOff;
+	// UnitProp of paramOn/paramOff and the interned state for upState,
+	// converted on loading
+	int paramOnKey;
+	int paramOffKey;
+	int paramOnState;
+	int paramOffState;
 	void movementOn(BaseUnit* unit);
 	void movementOff(BaseUnit* unit);
 	void parameterOn(BaseUnit* unit);
@@ -63,6 +69,8 @@ protected:
 		spFunction=BaseUnit::upEOL,
 		bpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 
 	enum SwitchFunction
 	{
@@ -72,7 +80,7 @@ protected:
 		sfParameterOn,
 		sfParameterOff
 	};
-	static map<string,int> stringToFunc;
+	static const KeywordTable stringToFunc;
 private:
 };
 
@@ -29,12 +29,13 @@
 #include "MusicCache.h"
 #include "MyGame.h"
 
+const KeywordTable TextObject::stringToProp = KeywordTable(&BaseUnit::stringToProp)
+	.add("font",tpFont)
+	.add("fontsize",tpFontSize)
+	.add("text",tpText);
+
 TextObject::TextObject(Level* newParent) : BaseUnit(newParent)
 {
-	stringToProp["font"] = tpFont;
-	stringToProp["fontsize"] =tpFontSize;
-	stringToProp["text"] = tpText;
-
 	flags.addFlag(ufNoMapCollision);
 	flags.addFlag(ufNoGravity);
 	unitCollisionMode = 0;
@@ -58,6 +58,8 @@ protected:
 		tpText,
 		bpEOL
 	};
+	static const KeywordTable stringToProp;
+	virtual const KeywordTable& getPropKeys() const {return stringToProp;}
 private:
 
 };
@@ -22,48 +22,29 @@
 	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
 */
 
-#include "PixelParticle.h"
+#include "Timing.h"
 
-PixelParticle::PixelParticle(Level* const parent, CRint lifeTime) : BaseUnit(parent)
-{
-	toBeRemoved = false;
-	counter = lifeTime;
-	offset = Vector2di(0,0);
-}
-
-PixelParticle::~PixelParticle()
-{
-	//
-}
-
-void PixelParticle::update()
-{
-	if ( counter > 0 )
-		--counter;
-	else
-		toBeRemoved = true;
-
-	position += velocity;
-}
-
-void PixelParticle::updateScreenPosition(const Vector2di& offset)
-{
-	this->offset = offset;
-}
-
-void PixelParticle::render(SDL_Surface* screen)
-{
-	GFX::setPixel(screen,position.x-offset.x,position.y-offset.y,col);
-}
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 
-void PixelParticle::hitMap(const Vector2df& correction)
+Uint64 getMicroTicks()
 {
-	if (abs(correction.x) > abs(correction.y))
-	{
-		velocity.x *= -1;
-	}
-	else if (correction.y != 0)
-	{
-		velocity.y *= -0.5;
-	}
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = {0};
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	// split to avoid overflowing on long uptimes
+	Uint64 seconds = count.QuadPart / frequency.QuadPart;
+	Uint64 rest = count.QuadPart % frequency.QuadPart;
+	return seconds * 1000000 + rest * 1000000 / frequency.QuadPart;
+#else
+	timeval time;
+	gettimeofday(&time,NULL);
+	return (Uint64)time.tv_sec * 1000000 + time.tv_usec;
+#endif
 }
@@ -22,36 +22,18 @@
 	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
 */
 
-#ifndef PIXELPARTICLE_H
-#define PIXELPARTICLE_H
+#ifndef TIMING_H
+#define TIMING_H
 
-#include "BaseUnit.h"
+#include <SDL/SDL.h>
 
 /**
-A single pixel bouncing around the map, created from a dying unit making it look
-like the unit exploded into pixels
+High resolution time stamps for profiling
+SDL_GetTicks only has millisecond resolution, which is not enough to time the
+parts of a single frame
 **/
 
-class PixelParticle : public BaseUnit
-{
-	public:
-		PixelParticle(Level* const parent, CRint lifeTime);
-		virtual ~PixelParticle();
-
-		virtual void update();
-		virtual void updateScreenPosition(const Vector2di& offset);
-		virtual void render(SDL_Surface* screen);
-
-		virtual void hitMap(const Vector2df& correction);
-
-	protected:
-
-		int counter;
-		Vector2di offset;
-	private:
-
-};
-
-
-#endif // PIXELPARTICLE_H
+// returns the current time in microseconds (arbitrary starting point)
+Uint64 getMicroTicks();
 
+#endif // TIMING_H
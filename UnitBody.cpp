@@ -0,0 +1,71 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "UnitBody.h"
+
+UnitBodyPool::UnitBodyPool()
+{
+	//
+}
+
+UnitBodyPool::~UnitBodyPool()
+{
+	for (vector<UnitBody*>::iterator I = blocks.begin(); I != blocks.end(); ++I)
+	{
+		delete [] (*I);
+	}
+	blocks.clear();
+	freeBodies.clear();
+}
+
+UnitBody* UnitBodyPool::allocate()
+{
+	if (freeBodies.empty())
+	{
+		UnitBody* block = new UnitBody[UNIT_BODY_BLOCK_SIZE];
+		blocks.push_back(block);
+		// push in reverse, so bodies get handed out in memory order
+		for (int I = UNIT_BODY_BLOCK_SIZE - 1; I >= 0; --I)
+		{
+			block[I].simulated = false;
+			freeBodies.push_back(block + I);
+		}
+	}
+
+	UnitBody* body = freeBodies.back();
+	freeBodies.pop_back();
+	body->position = Vector2df(0.0f,0.0f);
+	body->velocity = Vector2df(0.0f,0.0f);
+	body->acceleration[0] = Vector2df(0.0f,0.0f);
+	body->acceleration[1] = Vector2df(0.0f,0.0f);
+	body->flags.clear();
+	body->simulated = true;
+	return body;
+}
+
+void UnitBodyPool::release(UnitBody* const body)
+{
+	body->simulated = false;
+	freeBodies.push_back(body);
+}
@@ -0,0 +1,78 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef UNITBODY_H
+#define UNITBODY_H
+
+#include <vector>
+
+#include "PenjinTypes.h"
+#include "Vector2df.h"
+
+#include "SimpleFlags.h"
+
+#define UNIT_BODY_BLOCK_SIZE 64
+
+/**
+The physics state of a unit (everything touched by Physics::applyPhysics)
+BaseUnit keeps references to the fields of its body, so units use them like
+normal members while the level can run over all bodies in one go
+**/
+
+struct UnitBody
+{
+	Vector2df position;
+	Vector2df velocity;
+	Vector2df acceleration[2]; // 0 - increment, 1 - maximum
+	SimpleFlags flags;
+	// physics are applied to this body by Level::update directly, false for
+	// players (updated separately), removed units and unused bodies
+	bool simulated;
+};
+
+/**
+Storage for the bodies of all units of a level
+Bodies are allocated in fixed blocks, so they stay at the same address for the
+lifetime of the unit, released bodies are reused by the next allocation
+**/
+
+class UnitBodyPool
+{
+public:
+	UnitBodyPool();
+	~UnitBodyPool();
+
+	// returns a reset body with simulated set to true
+	UnitBody* allocate();
+	void release(UnitBody* const body);
+
+	// bodies in use
+	int size() const {return blocks.size() * UNIT_BODY_BLOCK_SIZE - freeBodies.size();}
+	int capacity() const {return blocks.size() * UNIT_BODY_BLOCK_SIZE;}
+
+	vector<UnitBody*> blocks; // UNIT_BODY_BLOCK_SIZE bodies each
+	vector<UnitBody*> freeBodies;
+};
+
+#endif // UNITBODY_H
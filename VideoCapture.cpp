@@ -0,0 +1,265 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#include "VideoCapture.h"
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define MEMORY_BARRIER() MemoryBarrier()
+#else
+#define MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+#define VIDEO_MAGIC "GVID"
+#define VIDEO_VERSION 1
+#define ENCODING_RAW 0
+#define ENCODING_DELTA 1
+
+#define MAX_LITERAL_RUN 0x8000
+#define MAX_ZERO_RUN 0x8000
+// shorter unchanged runs are kept in literal runs (a control word costs two bytes)
+#define MIN_ZERO_RUN 4
+
+VideoCapture::VideoCapture()
+{
+	file = NULL;
+	encoder = NULL;
+	queued = SDL_CreateSemaphore(0);
+	running = false;
+	stopping = false;
+	failed = false;
+	compress = true;
+	writeIndex = 0;
+	readIndex = 0;
+	width = 0;
+	height = 0;
+	bytesPerPixel = 0;
+	frameCount = 0;
+	droppedCount = 0;
+	startTicks = 0;
+}
+
+VideoCapture::~VideoCapture()
+{
+	stop();
+	SDL_DestroySemaphore(queued);
+}
+
+///---public---
+
+bool VideoCapture::start(CRstring filename, SDL_Surface* const format, CRbool compress)
+{
+	if (running)
+		return false;
+
+	file = fopen(filename.c_str(),"wb");
+	if (not file)
+	{
+		printf("ERROR: Could not create video file \"%s\"\n",filename.c_str());
+		return false;
+	}
+
+	width = format->w;
+	height = format->h;
+	bytesPerPixel = format->format->BytesPerPixel;
+	this->compress = compress;
+	writeIndex = 0;
+	readIndex = 0;
+	frameCount = 0;
+	droppedCount = 0;
+	stopping = false;
+	failed = false;
+	startTicks = SDL_GetTicks();
+
+	size_t frameSize = width * height * bytesPerPixel;
+	for (int I = 0; I < VIDEO_CAPTURE_SLOTS; ++I)
+		slots[I].pixels.resize(frameSize);
+	previous.assign(frameSize,0); // the first frame is a delta to black
+	encoded.resize(frameSize + frameSize / 1024 + 16); // worst case of the run length encoding
+
+	fwrite(VIDEO_MAGIC,1,4,file);
+	writeUint32(VIDEO_VERSION);
+	writeUint32(width);
+	writeUint32(height);
+	writeUint32(bytesPerPixel);
+	writeUint32(format->format->Rmask);
+	writeUint32(format->format->Gmask);
+	writeUint32(format->format->Bmask);
+
+	running = true;
+	encoder = SDL_CreateThread(VideoCapture::encode,this);
+	return true;
+}
+
+void VideoCapture::stop()
+{
+	if (not running)
+		return;
+
+	// wake the encoder, it writes the remaining frames before exiting
+	stopping = true;
+	SDL_SemPost(queued);
+	int* status = NULL;
+	SDL_WaitThread(encoder,status);
+	encoder = NULL;
+	while (SDL_SemTryWait(queued) == 0); // reset for the next capture
+
+	fclose(file);
+	file = NULL;
+	running = false;
+
+	Uint32 time = max(SDL_GetTicks() - startTicks,(Uint32)1);
+	printf("Stopping video capture. Recorded %i frames in %.1f seconds (%.2f fps), dropped %i frames.\n",
+			frameCount, (float)time / 1000.0f, (float)frameCount * 1000.0f / (float)time, droppedCount);
+}
+
+bool VideoCapture::addFrame(SDL_Surface* const surface)
+{
+	if (not running || surface->w != width || surface->h != height ||
+			surface->format->BytesPerPixel != bytesPerPixel)
+		return false;
+
+	Uint32 number = frameCount + droppedCount;
+	if (writeIndex - readIndex >= VIDEO_CAPTURE_SLOTS) // encoder is behind
+	{
+		++droppedCount;
+		return false;
+	}
+
+	// copy line by line to get rid of the pitch
+	Frame& frame = slots[writeIndex % VIDEO_CAPTURE_SLOTS];
+	frame.number = number;
+	frame.ticks = SDL_GetTicks() - startTicks;
+	int lineSize = width * bytesPerPixel;
+	if (SDL_MUSTLOCK(surface))
+		SDL_LockSurface(surface);
+	for (int y = 0; y < height; ++y)
+		memcpy(&frame.pixels[y * lineSize],(Uint8*)surface->pixels + y * surface->pitch,lineSize);
+	if (SDL_MUSTLOCK(surface))
+		SDL_UnlockSurface(surface);
+
+	// publish the frame only after it has been written completely
+	MEMORY_BARRIER();
+	++writeIndex;
+	++frameCount;
+	SDL_SemPost(queued);
+	return true;
+}
+
+///---private---
+
+int VideoCapture::encode(void* data)
+{
+	VideoCapture* self = (VideoCapture*)data;
+
+	while (true)
+	{
+		SDL_SemWait(self->queued);
+		// drain everything queued (also after being told to stop)
+		while (self->readIndex != self->writeIndex)
+		{
+			MEMORY_BARRIER();
+			if (not self->failed && not self->writeFrame(self->slots[self->readIndex % VIDEO_CAPTURE_SLOTS]))
+			{
+				printf("ERROR: Writing video frame failed, stop capturing!\n");
+				self->failed = true;
+			}
+			// hand the slot back to the capture side
+			MEMORY_BARRIER();
+			++self->readIndex;
+		}
+		if (self->stopping)
+			break;
+	}
+	return 0;
+}
+
+bool VideoCapture::writeFrame(const Frame& frame)
+{
+	writeUint32(frame.number);
+	writeUint32(frame.ticks);
+	if (compress)
+	{
+		size_t length = deltaEncode(frame.pixels,previous,encoded);
+		writeUint32(ENCODING_DELTA);
+		writeUint32(length);
+		fwrite(&encoded[0],1,length,file);
+		previous = frame.pixels;
+	}
+	else
+	{
+		writeUint32(ENCODING_RAW);
+		writeUint32(frame.pixels.size());
+		fwrite(&frame.pixels[0],1,frame.pixels.size(),file);
+	}
+	return ferror(file) == 0;
+}
+
+size_t VideoCapture::deltaEncode(const vector<Uint8>& current, const vector<Uint8>& previous, vector<Uint8>& output)
+{
+	size_t size = current.size();
+	size_t pos = 0;
+	size_t out = 0;
+	while (pos < size)
+	{
+		// unchanged bytes
+		size_t run = 0;
+		while (pos + run < size && run < MAX_ZERO_RUN && current[pos + run] == previous[pos + run])
+			++run;
+		if (run >= MIN_ZERO_RUN || pos + run == size)
+		{
+			Uint16 control = 0x7FFF + run;
+			output[out++] = control & 0xFF;
+			output[out++] = control >> 8;
+			pos += run;
+			continue;
+		}
+
+		// changed bytes up to the next long unchanged run
+		run = 0;
+		size_t unchanged = 0;
+		while (pos + run < size && run < MAX_LITERAL_RUN && unchanged < MIN_ZERO_RUN)
+		{
+			unchanged = (current[pos + run] == previous[pos + run]) ? unchanged + 1 : 0;
+			++run;
+		}
+		if (unchanged >= MIN_ZERO_RUN)
+			run -= unchanged; // these start the next zero run
+		Uint16 control = run - 1;
+		output[out++] = control & 0xFF;
+		output[out++] = control >> 8;
+		for (size_t I = pos; I < pos + run; ++I)
+			output[out++] = current[I] ^ previous[I];
+		pos += run;
+	}
+	return out;
+}
+
+void VideoCapture::writeUint32(const Uint32& value)
+{
+	Uint8 bytes[4] = {(Uint8)(value & 0xFF),(Uint8)((value >> 8) & 0xFF),(Uint8)((value >> 16) & 0xFF),(Uint8)((value >> 24) & 0xFF)};
+	fwrite(bytes,1,4,file);
+}
@@ -0,0 +1,117 @@
+/*
+	Greyout - a colourful platformer about love
+
+	Greyout is Copyright (c)2011-2014 Janek Schäfer
+
+	This file is part of Greyout.
+
+	Greyout is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Greyout is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	Please direct any feedback, questions or comments to
+	Janek Schäfer (foxblock), foxblock_at_gmail_dot_com
+*/
+
+#ifndef VIDEOCAPTURE_H
+#define VIDEOCAPTURE_H
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "PenjinTypes.h"
+
+// number of frames which can wait for the encoder, further ones are dropped
+#define VIDEO_CAPTURE_SLOTS 8
+
+/**
+Records the screen to a single video file without stalling the game
+Frames are copied into a ring buffer (one producer, one consumer, no locks)
+and written by a separate encoder thread, if the encoder falls behind new
+frames are dropped and counted
+File layout (all numbers 32bit little endian):
+"GVID", version, width, height, bytes per pixel, red, green and blue mask,
+then for every frame its number (gaps are dropped frames), SDL ticks,
+encoding (0 raw, 1 delta) and data length followed by the data
+Delta frames are XORed with the previous frame and run length encoded in
+16bit little endian control words: values below 0x8000 are followed by
+that many + 1 literal bytes, others stand for (value - 0x7FFF) zero bytes
+**/
+
+class VideoCapture
+{
+public:
+	VideoCapture();
+	~VideoCapture();
+
+	// creates the file and starts the encoder, frames are expected in the
+	// size and format of the passed surface, returns false on error
+	// if compress is false frames are stored raw (faster, but huge)
+	bool start(CRstring filename, SDL_Surface* const format, CRbool compress = true);
+	// waits for all queued frames to be written, then closes the file
+	void stop();
+	bool isRunning() const {return running;}
+
+	// copies the surface into the ring buffer, returns false if the frame was
+	// dropped (buffer full), the surface has to match the one passed to start
+	bool addFrame(SDL_Surface* const surface);
+
+	int getFrameCount() const {return frameCount;}
+	int getDroppedCount() const {return droppedCount;}
+	// true if writing to the file failed (capture should be stopped then)
+	bool hasFailed() const {return failed;}
+
+private:
+	struct Frame
+	{
+		Uint32 number;
+		Uint32 ticks;
+		vector<Uint8> pixels;
+	};
+
+	static int encode(void* data);
+	// writes a single frame and remembers it for the next delta
+	bool writeFrame(const Frame& frame);
+	// encodes the XOR of both frames to output, returns its length
+	static size_t deltaEncode(const vector<Uint8>& current, const vector<Uint8>& previous, vector<Uint8>& output);
+	void writeUint32(const Uint32& value);
+
+	FILE* file;
+	SDL_Thread* encoder;
+	SDL_sem* queued; // number of frames waiting for the encoder
+	bool running;
+	volatile bool stopping;
+	volatile bool failed;
+	bool compress;
+
+	Frame slots[VIDEO_CAPTURE_SLOTS];
+	// slot indices, each only written by one side (capture writes, encoder reads)
+	volatile Uint32 writeIndex;
+	volatile Uint32 readIndex;
+
+	int width;
+	int height;
+	int bytesPerPixel;
+	int frameCount;
+	int droppedCount;
+	Uint32 startTicks;
+
+	// encoder side
+	vector<Uint8> previous;
+	vector<Uint8> encoded;
+};
+
+#endif // VIDEOCAPTURE_H
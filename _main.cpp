@@ -94,6 +94,7 @@ int main(int argc, char** argv)
 {
 	Engine* game = NULL;
 	ErrorHandler error;
+	int result = 0;
 
 	//	Setup game engine
 	game = new MyGame;
@@ -103,9 +104,16 @@ int main(int argc, char** argv)
 		cout << error.getErrorString(game->argHandler(argc,argv));
 		cout << error.getErrorString(game->penjinInit());
 
-		GFX::showCursor(true);
+		if (ENGINE->isHeadless())
+			result = ENGINE->runHeadless();
+		else if (ENGINE->isPacking())
+			result = ENGINE->createAssetPack();
+		else
+		{
+			GFX::showCursor(true);
 
-		while(game->stateLoop());	//	Perform main loop until shutdown
+			while(game->stateLoop());	//	Perform main loop until shutdown
+		}
 
 		cout << error.getErrorString(PENJIN_SHUTDOWN);
 
@@ -121,5 +129,5 @@ int main(int argc, char** argv)
 
 	cout << error.getErrorString(PENJIN_GOODBYE);
 	SDL_Quit();		//	Shut down SDL tidyly
-	return 0;	//	Normal program termination.
+	return result;	//	Normal program termination (or number of failed headless levels)
 }
@@ -50,6 +50,8 @@ public:
 
 	// state checking
 	bool hasFinished(CRint index=-1);
+	// true if no effect is running or waiting to be removed
+	bool isIdle() const {return effects.empty();}
 
 	// time always in FRAMES (!!!)
 	/// fading
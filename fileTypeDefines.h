@@ -31,6 +31,9 @@
 #define DELIMIT_STRING ((string)",")
 #define CLASS_STRING ((string)"class")
 
+// pre-parsed level files written next to the text version on first load
+#define COMPILED_LEVEL_EXTENSION ((string)".lvc")
+
 #define PARAMETER_TYPE pair<string,string>
 
 #endif // FILETYPEDEFINES_H